@@ -77,6 +77,18 @@ struct dyn_share_modified
 	bool satu_check[6];
 };
 
+// upper triangular square-root information R of a covariance P (R^T * R = P^-1), i.e. the factor
+// LLT(P.inverse()).matrixL().transpose(). With J the exchange matrix and J * P * J = L * L^T, R = J * L^-1 * J,
+// so a Cholesky and a triangular solve take the place of the dense inverse.
+template<typename scalar_type, int n>
+Matrix<scalar_type, n, n> sqrt_information(const Matrix<scalar_type, n, n> &P)
+{
+	LLT<Matrix<scalar_type, n, n>> llt(P.reverse());
+	Matrix<scalar_type, n, n> L_inv = Matrix<scalar_type, n, n>::Identity();
+	llt.matrixL().solveInPlace(L_inv);
+	return L_inv.reverse();
+}
+
 template<typename state, int process_noise_dof, typename input = state, typename measurement=state, int measurement_noise_dof=0>
 class esekf{
 
@@ -95,6 +107,7 @@ public:
 	typedef Matrix<scalar_type, m, 1> flatted_state;
 	typedef flatted_state processModel(state &, const input &);
 	typedef Eigen::Matrix<scalar_type, n, n> processMatrix1(state &, const input &, double dt);
+	typedef void processCovariance(state &, const input &, double dt, cov &P);
 	typedef Eigen::Matrix<scalar_type, m, process_noise_dof> processMatrix2(state &, const input &);
 	typedef Eigen::Matrix<scalar_type, process_noise_dof, process_noise_dof> processnoisecovariance;
 
@@ -140,6 +153,12 @@ public:
 		x_.build_SEN_state();
 	}
 
+	// optional structure-aware replacement of f_x * P * f_x^T in predict, it has to match f_x
+	void init_cov_propagation(processCovariance f_P_in)
+	{
+		f_P = f_P_in;
+	}
+
 	// iterated error state EKF propogation
 	void predict(double &dt, processnoisecovariance &Q, const input &i_in, bool predict_state, bool prop_cov){
 		if (predict_state)
@@ -150,8 +169,16 @@ public:
 
 		if (prop_cov)
 		{
-			cov f_x_ = f_x(x_, i_in, dt);
-			P_ = f_x_ * P_ * (f_x_).transpose() + Q * (dt * dt);
+			if (f_P != nullptr)
+			{
+				f_P(x_, i_in, dt, P_);
+				P_ += Q * (dt * dt);
+			}
+			else
+			{
+				cov f_x_ = f_x(x_, i_in, dt);
+				P_ = f_x_ * P_ * (f_x_).transpose() + Q * (dt * dt);
+			}
 		}
 	}
 
@@ -189,11 +216,13 @@ public:
 			}
 			else
 			{
+				// (P^-1 + E * HTH * E^T)^-1 * E = P * E * (I - (I + HTH * P_66)^-1 * HTH * P_66), E the first 6 columns
+				// of the identity: only a 6x6 system instead of two 24x24 inverses
 				Matrix<scalar_type, 6, 6> HTH = m_noise * h_x.transpose() * h_x; // 
-				Matrix<scalar_type, n, n> P_inv = P_.inverse();
-				P_inv.template block<6, 6>(0, 0) += HTH;
-				P_inv = P_inv.inverse();
-				K_ = P_inv.template block<n, 6>(0, 0) * h_x.transpose() * m_noise;
+				Matrix<scalar_type, 6, 6> P_66 = P_.template block<6, 6>(0, 0);
+				Matrix<scalar_type, 6, 6> X = (Matrix<scalar_type, 6, 6>::Identity() + HTH * P_66).partialPivLu().solve(HTH);
+				Matrix<scalar_type, n, 6> P_post = P_.template block<n, 6>(0, 0) * (Matrix<scalar_type, 6, 6>::Identity() - X * P_66);
+				K_ = P_post * h_x.transpose() * m_noise;
 			}
 			Matrix<scalar_type, n, 1> dx_ = K_ * z; // - h) + (K_x - Matrix<scalar_type, n, n>::Identity()) * dx_new; 
 			// state x_before = x_;
@@ -226,48 +255,26 @@ public:
 			dyn_share.valid = true;
 			h_dyn_share_modified_2(x_, dyn_share);
 
-			Matrix<scalar_type, 6, 1> z = dyn_share.z_IMU;
-
-			Matrix<double, 24, 6> PHT;
-            Matrix<double, 6, 24> HP;
-            Matrix<double, 6, 6> HPHT;
-			PHT.setZero();
-			HP.setZero();
-			HPHT.setZero();
+			// saturated axes carry no information, their rows are dropped instead of zeroed
+			int rows[6];
+			int num_rows = 0;
 			for (int l_ = 0; l_ < 6; l_++)
 			{
 				if (!dyn_share.satu_check[l_])
 				{
-					PHT.col(l_) = P_.col(9+l_) + P_.col(18+l_);
-					HP.row(l_) = P_.row(9+l_) + P_.row(18+l_);
+					rows[num_rows++] = l_;
 				}
 			}
-			for (int l_ = 0; l_ < 6; l_++)
+			switch (num_rows)
 			{
-				if (!dyn_share.satu_check[l_])
-				{
-					HPHT.col(l_) = HP.col(9+l_) + HP.col(18+l_);
-				}
-				HPHT(l_, l_) += dyn_share.R_IMU(l_); //, l);
+				case 6: update_IMU_rows<6>(rows, dyn_share); break;
+				case 5: update_IMU_rows<5>(rows, dyn_share); break;
+				case 4: update_IMU_rows<4>(rows, dyn_share); break;
+				case 3: update_IMU_rows<3>(rows, dyn_share); break;
+				case 2: update_IMU_rows<2>(rows, dyn_share); break;
+				case 1: update_IMU_rows<1>(rows, dyn_share); break;
+				default: break;
 			}
-        	Eigen::Matrix<double, 24, 6> K = PHT * HPHT.inverse(); 
-                                    
-            Matrix<scalar_type, n, 1> dx_ = K * z; 
-
-            P_ -= K * HP;
-
-			// Eigen::Matrix3d L_ = Eigen::Matrix3d::Identity();
-			// {
-			// 	Eigen::MatrixXd RJ;
-			// 	Eigen::VectorXd JV = dx_.template block<3, 1>(3, 0);
-			// 	x_.rot.Jacob_right(JV, RJ);
-			// 	L_ = RJ; //.template block<1, 2>(0, 1) = Rr.transpose() * LJ * B_new_r;
-			// }
-
-			x_.boxplus(dx_);
-
-			// P_.template block<3, n>(3, 0) = L_ * P_.template block<3, n>(3, 0);
-			// P_.template block<n, 3>(0, 3) = P_.template block<n, 3>(0, 3) * L_.transpose();
 		}
 		return;
 	}
@@ -428,9 +435,41 @@ public:
 	const cov& get_P() const {
 		return P_;
 	}
+
 	cov P_;
 	state x_;
 private:
+	// IMU update with m unsaturated rows: row j of H selects omg + bg (rows 0-2) or acc + ba (rows 3-5) of the
+	// axis rows[j], so P * H^T is a sum of two columns of P, and H * P * H^T a sum of two of its rows
+	template<int m>
+	void update_IMU_rows(const int (&rows)[6], const dyn_share_modified<scalar_type> &dyn_share)
+	{
+		Matrix<scalar_type, n, m> PHT;
+		Matrix<scalar_type, m, m> HPHT;
+		Matrix<scalar_type, m, 1> z;
+		for (int j = 0; j < m; j++)
+		{
+			PHT.col(j) = P_.col(9 + rows[j]) + P_.col(18 + rows[j]);
+			z(j) = dyn_share.z_IMU(rows[j]);
+		}
+		for (int j = 0; j < m; j++)
+		{
+			HPHT.row(j) = PHT.row(9 + rows[j]) + PHT.row(18 + rows[j]);
+			HPHT(j, j) += dyn_share.R_IMU(rows[j]);
+		}
+		// HPHT = L * L^T is positive definite (R_IMU > 0), with W = P * H^T * L^-T the gain is K = W * L^-1 and
+		// K * H * P = W * W^T, a symmetric rank-m downdate
+		const LLT<Matrix<scalar_type, m, m>> llt(HPHT);
+		Matrix<scalar_type, n, m> &W = PHT;
+		llt.matrixU().template solveInPlace<OnTheRight>(W);
+		llt.matrixL().solveInPlace(z);
+
+		Matrix<scalar_type, n, 1> dx_;
+		dx_.noalias() = W * z;
+		P_.noalias() -= W * W.transpose();
+		x_.boxplus(dx_);
+	}
+
 	measurement m_;
 	spMt l_;
 	spMt f_x_1;
@@ -441,6 +480,7 @@ private:
 
 	processModel *f;
 	processMatrix1 *f_x;
+	processCovariance *f_P = nullptr;
 	processMatrix2 *f_w;
 
 	measurementMatrix1 *h_x;
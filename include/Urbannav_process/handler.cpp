@@ -186,7 +186,7 @@ void rtklibOdomHandler(const nav_msgs::Odometry::ConstPtr& odomIn) {//, Eigen::V
 }
 
 /* subscribe the gnss range/doppler measurements from rover */
-void rtklib_gnss_meas_callback(const nlosExclusion::GNSS_Raw_ArrayConstPtr &meas_msg, std::queue<std::vector<ObsPtr>> &gnss_meas_vec) //
+void rtklib_gnss_meas_callback(const nlosExclusion::GNSS_Raw_ArrayConstPtr &meas_msg, SpscRingBuffer<std::vector<ObsPtr>> &gnss_meas_vec) //
 {
     // nlosExclusion::GNSS_Raw_Array meas_msg_valid;
     /* calculate the integer GNSS second to find station GNSS measurements */
@@ -325,7 +325,7 @@ void rtklib_gnss_meas_callback(const nlosExclusion::GNSS_Raw_ArrayConstPtr &meas
     /* make sure the order of GNSS data is correct */
     if (latest_gnss_time_u > last_gnss_time)
     {
-        gnss_meas_vec.push(gnss_meas);
+        gnss_meas_vec.push_back(std::move(gnss_meas), latest_gnss_time_u);
     }
     else
     {
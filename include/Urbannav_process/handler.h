@@ -52,6 +52,7 @@
 #include <deque>
 #include <queue>
 #include "gnss_tools.h"
+#include <utils/ring_buffer.h>
 #include <fstream>
 #include <sstream>
 // #include <iostream>
@@ -153,7 +154,7 @@ extern std::vector<Eigen::Vector3d> sat_vel;
 
 void rtklibOdomHandler(const nav_msgs::Odometry::ConstPtr& odomIn); //, Eigen::Vector3d &first_lla_pvt, Eigen::Vector3d &first_xyz_ecef_pvt, std::vector<double> &pvt_time, 
                         // std::vector<Eigen::Vector3d> &pvt_holder, std::vector<int> &diff_holder, std::vector<int> &float_holder);
-void rtklib_gnss_meas_callback(const nlosExclusion::GNSS_Raw_ArrayConstPtr &meas_msg, std::queue<std::vector<ObsPtr>> &gnss_meas_vec);
+void rtklib_gnss_meas_callback(const nlosExclusion::GNSS_Raw_ArrayConstPtr &meas_msg, SpscRingBuffer<std::vector<ObsPtr>> &gnss_meas_vec);
 bool gnssRawArray2map(nlosExclusion::GNSS_Raw_Array gnss_data, std::map<int, nlosExclusion::GNSS_Raw> &epochGnssMap);
 bool calVar(ObsPtr &obs);
 double eleSRNVarCal(double ele, double snr);
@@ -1,4 +1,5 @@
 #pragma once
+#include <functional>
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
 #include <pcl/io/pcd_io.h>
@@ -65,6 +66,14 @@ public:
             return false;
         }
 
+        const std::string database_file = (fs::path(path) / scd_database_name).string();
+        if (fs::exists(database_file))
+        {
+            if (sc_manager->loadSCDDatabase(database_file, trajectory_poses->size()))
+                return true;
+            LOG_WARN("load descriptor database failed, fall back to scd files! path = %s", database_file.c_str());
+        }
+
         int scd_file_count = 0, num_digits = 0;
         scd_file_count = FileOperation::getFilesNumByExtension(path, ".scd");
 
@@ -77,6 +86,10 @@ public:
         num_digits = FileOperation::getOneFilenameByExtension(path, ".scd").length() - std::string(".scd").length();
 
         sc_manager->loadPriorSCD(path, num_digits, trajectory_poses->size());
+
+        // convert once, later starts load the binary database
+        if (!sc_manager->saveSCDDatabase(database_file))
+            LOG_WARN("save descriptor database failed! path = %s", database_file.c_str());
         return true;
     }
 
@@ -241,6 +254,12 @@ public:
             sc_manager->saveCurrentSCD(path);
     }
 
+    // writes the descriptors added by add_keyframe_descriptor into the binary database of the map at path
+    bool save_keyframe_descriptor_database(const std::string &path)
+    {
+        return sc_manager->saveSCDDatabase((fs::path(path) / scd_database_name).string());
+    }
+
     std::string algorithm_type = "UNKNOW";
     BnbOptions bnb_option;
     Pose manual_pose, lidar_extrinsic, rough_pose;
@@ -249,6 +268,12 @@ public:
     pcl::PointCloud<PointXYZIRPYT>::Ptr trajectory_poses;
     std::shared_ptr<ScanContext::SCManager> sc_manager; // scan context
 
+    // tiled map: the prior map of bnb/ndt/gicp is loaded around the rough pose instead of given at start
+    std::function<PointCloudType::Ptr(const Pose &)> prior_map_loader;
+    double prior_map_radius = 100;
+    V3D prior_map_center;
+    const std::string scd_database_name = "descriptors.scdb";
+
     GnssPose gnss_pose;
     Eigen::Matrix4d extrinsic_imu2gnss;
 
@@ -357,6 +382,9 @@ private:
         LOG_WARN("gnss relocalization success! pose = (%.2lf,%.2lf,%.2lf,%.2lf,%.2lf,%.2lf)!",
                  rough_pose.x, rough_pose.y, rough_pose.z, RAD2DEG(rough_pose.roll), RAD2DEG(rough_pose.pitch), RAD2DEG(rough_pose.yaw));
 
+        if (!prepare_prior_map(rough_pose))
+            return false;
+
         bool bnb_success = true;
         auto bnb_opt_tmp = bnb_option;
         bnb_opt_tmp.min_score = 0.1;
@@ -414,6 +442,9 @@ private:
             LOG_WARN("scan context success! res index = %d, pose = (%.2lf,%.2lf,%.2lf,%.2lf,%.2lf,%.2lf)!", sc_res.first,
                      rough_pose.x, rough_pose.y, rough_pose.z, RAD2DEG(rough_pose.roll), RAD2DEG(rough_pose.pitch), RAD2DEG(rough_pose.yaw));
 
+            if (!prepare_prior_map(rough_pose))
+                return false;
+
             bool bnb_success = true;
             auto bnb_opt_tmp = bnb_option;
             bnb_opt_tmp.min_score = 0.1;
@@ -452,6 +483,9 @@ private:
             return false;
         }
 
+        if (!prepare_prior_map(manual_pose))
+            return false;
+
         Timer timer;
         bool bnb_success = true;
         if (!bnb3d->MatchWithMatchOptions(manual_pose, rough_pose, scan, bnb_option, lidar_ext, score))
@@ -476,6 +510,27 @@ private:
         return true;
     }
 
+    // load the prior map around a rough pose, only if prior_map_loader is set (tiled map)
+    bool prepare_prior_map(const Pose &pose)
+    {
+        if (!prior_map_loader)
+            return true;
+        if (bnb3d && std::hypot(pose.x - prior_map_center.x(), pose.y - prior_map_center.y()) < prior_map_radius / 2)
+            return true;
+
+        Timer timer;
+        PointCloudType::Ptr prior_map = prior_map_loader(pose);
+        if (prior_map->points.size() < 5000)
+        {
+            LOG_ERROR("Too few prior map points around (%.2lf, %.2lf)!", pose.x, pose.y);
+            return false;
+        }
+        load_prior_map(prior_map);
+        prior_map_center = V3D(pose.x, pose.y, pose.z);
+        LOG_WARN("Load prior map around (%.2lf, %.2lf), %lu points, cost time %.1fms.", pose.x, pose.y, prior_map->points.size(), timer.elapsedLast());
+        return true;
+    }
+
     bool prior_pose_inited = false;
 
     // ndt
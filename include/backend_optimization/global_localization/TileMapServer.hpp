@@ -0,0 +1,333 @@
+#pragma once
+#include <map>
+#include <set>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+#include <pcl/io/pcd_io.h>
+#include "../Header.h"
+
+/*
+ * Tiled global map: the map is split into fixed-size XY tiles, each stored as a binary pcd file
+ * "tile_<x>_<y>.pcd", and an index file "tile_index.txt":
+ *     tile_size <meter>
+ *     <x> <y> <num_points>   (one line per tile)
+ */
+struct TileKey
+{
+    int x;
+    int y;
+
+    bool operator<(const TileKey &other) const { return x < other.x || (x == other.x && y < other.y); }
+    bool operator==(const TileKey &other) const { return x == other.x && y == other.y; }
+};
+
+class TileMapIndex
+{
+public:
+    static std::string indexFile(const std::string &dir)
+    {
+        return (fs::path(dir) / "tile_index.txt").string();
+    }
+
+    static std::string tileFile(const std::string &dir, const TileKey &key)
+    {
+        return (fs::path(dir) / ("tile_" + std::to_string(key.x) + "_" + std::to_string(key.y) + ".pcd")).string();
+    }
+
+    static bool exists(const std::string &dir)
+    {
+        return fs::exists(indexFile(dir));
+    }
+
+    /// split a global map into tiles, done once for an untiled map
+    static bool build(const PointCloudType::Ptr &map, double tile_size, const std::string &dir)
+    {
+        std::map<TileKey, PointCloudType> tiles;
+        for (const auto &point : map->points)
+            tiles[toKey(point.x, point.y, tile_size)].push_back(point);
+
+        if (!FileOperation::createDirectoryOrRecreate(dir))
+            return false;
+
+        std::ofstream index(indexFile(dir));
+        if (!index.is_open())
+            return false;
+        index << "tile_size " << tile_size << "\n";
+        for (auto &tile : tiles)
+        {
+            if (pcl::io::savePCDFileBinary(tileFile(dir, tile.first), tile.second) != 0)
+                return false;
+            index << tile.first.x << " " << tile.first.y << " " << tile.second.size() << "\n";
+        }
+        return true;
+    }
+
+    bool load(const std::string &dir)
+    {
+        std::ifstream index(indexFile(dir));
+        std::string tag;
+        if (!index.is_open() || !(index >> tag >> tile_size) || tag != "tile_size" || tile_size <= 0)
+            return false;
+
+        TileKey key;
+        size_t num_points;
+        while (index >> key.x >> key.y >> num_points)
+            tiles[key] = num_points;
+        return !tiles.empty();
+    }
+
+    static TileKey toKey(double x, double y, double tile_size)
+    {
+        return TileKey{(int)std::floor(x / tile_size), (int)std::floor(y / tile_size)};
+    }
+
+    TileKey toKey(double x, double y) const { return toKey(x, y, tile_size); }
+
+    /// tiles intersecting the circle, nearest first
+    std::vector<TileKey> tilesInRadius(double x, double y, double radius) const
+    {
+        std::vector<std::pair<double, TileKey>> found;
+        const TileKey min_key = toKey(x - radius, y - radius), max_key = toKey(x + radius, y + radius);
+        for (int i = min_key.x; i <= max_key.x; ++i)
+        {
+            for (int j = min_key.y; j <= max_key.y; ++j)
+            {
+                const TileKey key{i, j};
+                if (tiles.count(key) == 0)
+                    continue;
+                const double dist = distanceToTile(x, y, key);
+                if (dist <= radius)
+                    found.emplace_back(dist, key);
+            }
+        }
+        std::sort(found.begin(), found.end(), [](const std::pair<double, TileKey> &a, const std::pair<double, TileKey> &b)
+                  { return a.first < b.first; });
+
+        std::vector<TileKey> keys;
+        keys.reserve(found.size());
+        for (const auto &tile : found)
+            keys.push_back(tile.second);
+        return keys;
+    }
+
+    double distanceToTile(double x, double y, const TileKey &key) const
+    {
+        const double dx = std::max({key.x * tile_size - x, 0., x - (key.x + 1) * tile_size});
+        const double dy = std::max({key.y * tile_size - y, 0., y - (key.y + 1) * tile_size});
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
+    double tile_size = 0;
+    std::map<TileKey, size_t> tiles; // tile -> number of points
+};
+
+/*
+ * Pages the tiles around the current position into the ivox maps. Tiles are read from disk in a
+ * background thread, the main thread (which owns the ivox) only inserts the loaded points. When a
+ * tile leaves the load radius its voxels are removed from the maps, so the maps hold the tiles in
+ * range only. A tile whose voxels were lost otherwise (LRU eviction, rollback) is loaded again.
+ */
+class TileMapServer
+{
+public:
+    TileMapServer(const std::string &dir, double load_radius)
+        : dir_(dir), load_radius_(load_radius)
+    {
+    }
+
+    ~TileMapServer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            exit_ = true;
+        }
+        cv_.notify_all();
+        if (worker_.joinable())
+            worker_.join();
+    }
+
+    bool init()
+    {
+        if (!index_.load(dir_))
+            return false;
+        worker_ = std::thread(&TileMapServer::loadThread, this);
+        return true;
+    }
+
+    /// blocking load of all tiles around a position, e.g. as prior map of the relocalization
+    PointCloudType::Ptr loadTilesNear(double x, double y, double radius) const
+    {
+        PointCloudType::Ptr cloud(new PointCloudType());
+        for (const auto &key : index_.tilesInRadius(x, y, radius))
+            *cloud += *loadTile(key);
+        return cloud;
+    }
+
+    /**
+     * called by the main thread once per frame: inserts the tiles loaded in the background into the maps,
+     * and requests the tiles in range which are not resident. The first call loads synchronously.
+     */
+    template <typename MapType>
+    void update(const V3D &pos, std::initializer_list<MapType *> maps)
+    {
+        const std::vector<TileKey> tiles_in_range = index_.tilesInRadius(pos.x(), pos.y(), load_radius_);
+        if (resident_.empty() && pending_.empty())
+        {
+            Timer timer;
+            for (const auto &key : tiles_in_range)
+                insertTile(key, loadTile(key), maps);
+            LOG_WARN("load %lu map tiles around (%.1lf, %.1lf), cost time %.1fms.", tiles_in_range.size(), pos.x(), pos.y(), timer.elapsedLast());
+            return;
+        }
+
+        // at most one tile per frame, to bound the latency of the frame
+        std::pair<TileKey, PointCloudType::Ptr> loaded;
+        bool has_loaded = false;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (!loaded_.empty())
+            {
+                loaded = std::move(loaded_.front());
+                loaded_.pop_front();
+                has_loaded = true;
+            }
+        }
+        if (has_loaded)
+        {
+            pending_.erase(loaded.first);
+            if (index_.distanceToTile(pos.x(), pos.y(), loaded.first) <= load_radius_)
+                insertTile(loaded.first, loaded.second, maps);
+        }
+
+        // unload tiles out of range
+        bool unload = false;
+        for (auto iter = resident_.begin(); iter != resident_.end();)
+        {
+            if (index_.distanceToTile(pos.x(), pos.y(), iter->first) > load_radius_)
+            {
+                iter = resident_.erase(iter);
+                unload = true;
+            }
+            else
+                ++iter;
+        }
+        if (unload)
+        {
+            // a voxel on a tile border stays as long as one of the tiles it overlaps is in range
+            Timer timer;
+            size_t num_removed = 0;
+            for (auto map : maps)
+                num_removed += map->RemoveGridsIf([this, &pos](const auto &box_min, const auto &box_max)
+                                                  { return !boxInRange(pos, box_min.x(), box_min.y(), box_max.x(), box_max.y()); });
+            LOG_INFO("unload map tiles out of range, %lu voxels removed, cost time %.1fms.", num_removed, timer.elapsedLast());
+        }
+
+        std::vector<TileKey> requests;
+        for (const auto &key : tiles_in_range)
+        {
+            if (pending_.count(key))
+                continue;
+            auto iter = resident_.find(key);
+            if (iter != resident_.end() && isResident(iter->second, maps))
+                continue;
+            resident_.erase(key);
+            pending_.insert(key);
+            requests.push_back(key);
+        }
+        if (!requests.empty())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                requests_.insert(requests_.end(), requests.begin(), requests.end());
+            }
+            cv_.notify_one();
+        }
+    }
+
+    size_t numResidentTiles() const { return resident_.size(); }
+
+private:
+    static constexpr int kNumProbes = 8;
+
+    PointCloudType::Ptr loadTile(const TileKey &key) const
+    {
+        PointCloudType::Ptr cloud(new PointCloudType());
+        if (pcl::io::loadPCDFile(TileMapIndex::tileFile(dir_, key), *cloud) != 0)
+            LOG_ERROR("load map tile (%d, %d) failed!", key.x, key.y);
+        return cloud;
+    }
+
+    template <typename MapType>
+    void insertTile(const TileKey &key, const PointCloudType::Ptr &cloud, std::initializer_list<MapType *> maps)
+    {
+        for (auto map : maps)
+            map->AddPointsToNewGrids(cloud->points);
+
+        // a few points of the tile, to detect later whether its voxels are still in the maps
+        auto &probes = resident_[key];
+        probes.clear();
+        const size_t step = std::max<size_t>(cloud->size() / kNumProbes, 1);
+        for (size_t i = 0; i < cloud->size() && probes.size() < kNumProbes; i += step)
+            probes.push_back(cloud->points[i]);
+    }
+
+    /// whether a voxel box overlaps a tile within the load radius
+    bool boxInRange(const V3D &pos, double min_x, double min_y, double max_x, double max_y) const
+    {
+        const TileKey min_key = index_.toKey(min_x, min_y), max_key = index_.toKey(max_x, max_y);
+        for (int i = min_key.x; i <= max_key.x; ++i)
+            for (int j = min_key.y; j <= max_key.y; ++j)
+                if (index_.distanceToTile(pos.x(), pos.y(), TileKey{i, j}) <= load_radius_)
+                    return true;
+        return false;
+    }
+
+    /// the voxels of all probes must still exist, a tile which lost some of them is loaded again
+    template <typename MapType>
+    bool isResident(const std::vector<PointType> &probes, std::initializer_list<MapType *> maps) const
+    {
+        for (auto map : maps)
+            for (const auto &probe : probes)
+                if (!map->HasGrid(probe))
+                    return false;
+        return true;
+    }
+
+    void loadThread()
+    {
+        while (true)
+        {
+            TileKey key;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_.wait(lock, [this]
+                         { return exit_ || !requests_.empty(); });
+                if (exit_)
+                    return;
+                key = requests_.front();
+                requests_.pop_front();
+            }
+
+            PointCloudType::Ptr cloud = loadTile(key);
+            std::lock_guard<std::mutex> lock(mtx_);
+            loaded_.emplace_back(key, cloud);
+        }
+    }
+
+    std::string dir_;
+    double load_radius_;
+    TileMapIndex index_;
+
+    // main thread only
+    std::map<TileKey, std::vector<PointType>> resident_; // inserted tiles -> probe points
+    std::set<TileKey> pending_;                           // requested, not inserted yet
+
+    // shared with the load thread
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<TileKey> requests_;
+    std::deque<std::pair<TileKey, PointCloudType::Ptr>> loaded_;
+    bool exit_ = false;
+    std::thread worker_;
+};
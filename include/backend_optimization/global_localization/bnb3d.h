@@ -4,8 +4,6 @@
 #include <pcl/io/pcd_io.h>
 #include <pcl/point_types.h>
 #include <pcl/filters/voxel_grid.h>
-#include <pcl/octree/octree.h>
-#include <pcl/common/transforms.h>
 #include <omp.h>
 #include "../Header.h"
 
@@ -37,6 +35,119 @@ struct BnbOptions
     // int full_resolution_depth = 3;
 };
 
+/*
+ * Flat occupancy grid of one resolution level, replaces the octree for occupancy queries.
+ * Voxel index = (int)((p - origin) / resolution), the origin is one voxel below the map bounds,
+ * so the truncating float->int conversion used by the scoring kernel never hits a valid voxel
+ * for points below the map. Small maps use a bitset, large ones an open-addressing hash set.
+ */
+class OccupancyGrid3D
+{
+public:
+    OccupancyGrid3D(const PointCloudType::Ptr &map, double resolution)
+        : inv_resolution_(1.0 / resolution)
+    {
+        Eigen::Vector3f min_pt = Eigen::Vector3f::Constant(std::numeric_limits<float>::max());
+        Eigen::Vector3f max_pt = Eigen::Vector3f::Constant(std::numeric_limits<float>::lowest());
+        for (const auto &point : map->points)
+        {
+            min_pt = min_pt.cwiseMin(point.getVector3fMap());
+            max_pt = max_pt.cwiseMax(point.getVector3fMap());
+        }
+        if (map->points.empty())
+        {
+            min_pt.setZero();
+            max_pt.setZero();
+        }
+
+        uint64_t volume = 1;
+        for (auto i = 0; i < 3; ++i)
+        {
+            origin_[i] = min_pt(i) - resolution;
+            dims_[i] = static_cast<int>((max_pt(i) - origin_[i]) * inv_resolution_) + 2;
+            volume *= dims_[i];
+        }
+
+        use_bitset_ = volume <= kMaxBitsetVoxels;
+        if (use_bitset_)
+            bitset_.assign((volume + 63) / 64, 0);
+        else
+        {
+            size_t table_size = 16;
+            while (table_size < 2 * map->points.size())
+                table_size <<= 1;
+            table_mask_ = table_size - 1;
+            table_.assign(table_size, kEmptyKey);
+        }
+
+        for (const auto &point : map->points)
+        {
+            const int ix = static_cast<int>((point.x - origin_[0]) * inv_resolution_);
+            const int iy = static_cast<int>((point.y - origin_[1]) * inv_resolution_);
+            const int iz = static_cast<int>((point.z - origin_[2]) * inv_resolution_);
+            insert(voxelKey(ix, iy, iz));
+        }
+    }
+
+    /// @return false if the voxel is outside the map bounds or empty
+    inline bool isOccupied(int ix, int iy, int iz) const
+    {
+        if ((unsigned)ix >= (unsigned)dims_[0] || (unsigned)iy >= (unsigned)dims_[1] || (unsigned)iz >= (unsigned)dims_[2])
+            return false;
+        const uint64_t key = voxelKey(ix, iy, iz);
+        if (use_bitset_)
+            return (bitset_[key >> 6] >> (key & 63)) & 1;
+
+        for (size_t slot = hashKey(key);; slot = (slot + 1) & table_mask_)
+        {
+            const uint64_t value = table_[slot];
+            if (value == key)
+                return true;
+            if (value == kEmptyKey)
+                return false;
+        }
+    }
+
+    float resolution() const { return 1.0 / inv_resolution_; }
+    float inv_resolution() const { return inv_resolution_; }
+    const float *origin() const { return origin_; }
+
+private:
+    static constexpr uint64_t kMaxBitsetVoxels = uint64_t(1) << 28; // 32MB
+    static constexpr uint64_t kEmptyKey = std::numeric_limits<uint64_t>::max();
+
+    inline uint64_t voxelKey(int ix, int iy, int iz) const
+    {
+        return ((uint64_t)ix * dims_[1] + iy) * dims_[2] + iz;
+    }
+
+    inline size_t hashKey(uint64_t key) const
+    {
+        return (key * 0x9E3779B97F4A7C15ull >> 32) & table_mask_;
+    }
+
+    void insert(uint64_t key)
+    {
+        if (use_bitset_)
+        {
+            bitset_[key >> 6] |= uint64_t(1) << (key & 63);
+            return;
+        }
+        size_t slot = hashKey(key);
+        while (table_[slot] != kEmptyKey && table_[slot] != key)
+            slot = (slot + 1) & table_mask_;
+        table_[slot] = key;
+    }
+
+    float inv_resolution_;
+    float origin_[3];
+    int dims_[3];
+    bool use_bitset_ = false;
+    std::vector<uint64_t> bitset_;
+    std::vector<uint64_t> table_;
+    size_t table_mask_ = 0;
+};
+
 class PrecomputationGridStack3D
 {
 public:
@@ -48,14 +159,11 @@ public:
         precomputation_grids_.reserve(match_option.bnb_depth);
         for (auto i = 0; i < match_option.bnb_depth; ++i)
         {
-            precomputation_grids_.emplace_back(match_option.pc_resolutions[i]);
-            auto& octree = precomputation_grids_.back();
-            octree.setInputCloud(map);
-            octree.addPointsFromInputCloud();
+            precomputation_grids_.emplace_back(map, match_option.pc_resolutions[i]);
         }
     }
 
-    const pcl::octree::OctreePointCloudSearch<PointType> &Get(int depth) const
+    const OccupancyGrid3D &Get(int depth) const
     {
         return precomputation_grids_.at(depth);
     }
@@ -63,7 +171,30 @@ public:
     int max_depth() const { return precomputation_grids_.size() - 1; }
 
 private:
-    std::vector<pcl::octree::OctreePointCloudSearch<PointType>> precomputation_grids_;
+    std::vector<OccupancyGrid3D> precomputation_grids_;
+};
+
+// scan points as separate coordinate arrays, so that the transform loop vectorizes
+struct ScanSoA
+{
+    explicit ScanSoA(const PointCloudType::Ptr &scan)
+    {
+        x.reserve(scan->points.size());
+        y.reserve(scan->points.size());
+        z.reserve(scan->points.size());
+        for (const auto &point : scan->points)
+        {
+            x.push_back(point.x);
+            y.push_back(point.y);
+            z.push_back(point.z);
+        }
+    }
+
+    int size() const { return x.size(); }
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
 };
 
 struct Pose
@@ -201,42 +332,70 @@ public:
     }
 
     // 计算当前位姿点云在地图中的占据分数
-    double calculateOccupancyScore(const int depth, const PointCloudType::Ptr &pointCloud)
+    float calculateOccupancyScore(const int depth, const ScanSoA &scan, const Eigen::Matrix4d &pose) const
     {
         assert(depth <= precomputation_grid_stack_.max_depth());
-        double score = 0;
-        auto& octree = precomputation_grid_stack_.Get(depth);
+        const auto &grid = precomputation_grid_stack_.Get(depth);
+        const int num = scan.size();
+        if (num == 0)
+            return 0;
+
+        // per-thread scratch, grows to the largest scan and is reused by all candidates
+        thread_local std::vector<int> voxel_x, voxel_y, voxel_z;
+        if (voxel_x.size() < num)
+        {
+            voxel_x.resize(num);
+            voxel_y.resize(num);
+            voxel_z.resize(num);
+        }
 
-        // 查询给定点是否在八叉树网格中
-        for (const auto &point : pointCloud->points)
+        // fold the grid origin and resolution into the transform: voxel = R' * p + t'
+        const float inv_res = grid.inv_resolution();
+        const float *origin = grid.origin();
+        float r[3][3], t[3];
+        for (auto row = 0; row < 3; ++row)
         {
-            if (octree.isVoxelOccupiedAtPoint(point))
-            {
-                ++score;
-            }
+            for (auto col = 0; col < 3; ++col)
+                r[row][col] = pose(row, col) * inv_res;
+            t[row] = (pose(row, 3) - origin[row]) * inv_res;
+        }
+
+        const float *px = scan.x.data(), *py = scan.y.data(), *pz = scan.z.data();
+        int *vx = voxel_x.data(), *vy = voxel_y.data(), *vz = voxel_z.data();
+#pragma omp simd
+        for (auto i = 0; i < num; ++i)
+        {
+            vx[i] = static_cast<int>(r[0][0] * px[i] + r[0][1] * py[i] + r[0][2] * pz[i] + t[0]);
+            vy[i] = static_cast<int>(r[1][0] * px[i] + r[1][1] * py[i] + r[1][2] * pz[i] + t[1]);
+            vz[i] = static_cast<int>(r[2][0] * px[i] + r[2][1] * py[i] + r[2][2] * pz[i] + t[2]);
+        }
+
+        int score = 0;
+        for (auto i = 0; i < num; ++i)
+        {
+            score += grid.isOccupied(vx[i], vy[i], vz[i]);
         }
-        return score / pointCloud->points.size();
+        return static_cast<float>(score) / num;
     }
 
-    void ScoreCandidates(const int depth, const PointCloudType::Ptr &pointCloud,
+    void ScoreCandidates(const int depth, const ScanSoA &scan,
                          const DiscretePose3D &discrete_candidate_pose, std::vector<Candidate3D> &candidates)
     {
 #pragma omp parallel for num_threads(BNB_PROC_NUM)
         // omp mustn't use '!=' / 'range for'
         for (auto i = 0; i < candidates.size(); ++i)
         {
-            PointCloudType::Ptr trans_pc(new PointCloudType(pointCloud->points.size(), 1));
             auto candidate_pose = discrete_candidate_pose.discrete_pose[candidates[i].discrete_index];
             candidate_pose += candidates[i].offset;
             const Eigen::Matrix4d &candidate_lidar_pose = candidate_pose.toMatrix4d() * init_lidar_orientation_;
-            pcl::transformPointCloud(*pointCloud, *trans_pc, candidate_lidar_pose);
-            candidates[i].score = calculateOccupancyScore(depth, trans_pc);
+            candidates[i].score = calculateOccupancyScore(depth, scan, candidate_lidar_pose);
         }
         sort_cnt++;
+        score_cnt += candidates.size();
         std::sort(candidates.begin(), candidates.end(), std::greater<Candidate3D>());
     }
 
-    Candidate3D BranchAndBound(const BnbOptions &match_option, const PointCloudType::Ptr &scan,
+    Candidate3D BranchAndBound(const BnbOptions &match_option, const ScanSoA &scan,
                                DiscretePose3D &discrete_candidate_pose, const std::vector<Candidate3D> &candidates,
                                const int candidate_depth, float min_score)
     {
@@ -312,9 +471,11 @@ public:
                                const Eigen::Matrix4d &lidar_ext,
                                double &score)
     {
+        Timer timer;
         sort_cnt = 0;
+        score_cnt = 0;
         init_lidar_orientation_ = lidar_ext;
-        auto filter_scan = filterScan(scan, match_option);
+        const ScanSoA filter_scan(filterScan(scan, match_option));
         DiscretePose3D discrete_candidate_pose(init_pose, match_option);
         std::vector<Candidate3D> lowest_resolution_candidates = ComputeLowestResolutionCandidates(discrete_candidate_pose);
         ScoreCandidates(precomputation_grid_stack_.max_depth(), filter_scan, discrete_candidate_pose, lowest_resolution_candidates);
@@ -322,9 +483,13 @@ public:
         const Candidate3D best_candidate = BranchAndBound(match_option, filter_scan, discrete_candidate_pose, lowest_resolution_candidates,
                                                           precomputation_grid_stack_.max_depth(), match_option.min_score);
 
+        const double match_time = timer.elapsedLast();
         printf("xy_step = %d, z_step = %d, angular_step = %d, init_candidates_num = %lu, best_score = %f\n",
                discrete_candidate_pose.candidate_xy_part, discrete_candidate_pose.candidate_z_part, discrete_candidate_pose.candidate_angular_part,
                lowest_resolution_candidates.size(), best_candidate.score);
+        if (match_option.debug_mode)
+            printf("scored_candidates = %lu, scan_points = %d, match_time = %.2f ms, candidates_per_second = %.0f\n",
+                   score_cnt, filter_scan.size(), match_time, score_cnt / std::max(match_time, 1e-3) * 1000);
         if (best_candidate.score > match_option.min_score + 1e-6)
         {
             res_pose = discrete_candidate_pose.discrete_pose[best_candidate.discrete_index];
@@ -337,6 +502,7 @@ public:
 
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
     int sort_cnt = 0;
+    size_t score_cnt = 0;
 private:
     Eigen::Matrix4d init_lidar_orientation_;
     PrecomputationGridStack3D precomputation_grid_stack_;
@@ -66,6 +66,17 @@ struct KDTreeVectorOfVectorsAdaptor
 		index->buildIndex();
 	}
 
+	/// Constructor: restores an index previously written by index->saveIndex() for the same data points, instead of building it
+	KDTreeVectorOfVectorsAdaptor(const size_t /* dimensionality */, const VectorOfVectorsType &mat, FILE *index_stream, const int leaf_max_size = 10) : m_data(mat)
+	{
+		assert(mat.size() != 0 && mat[0].size() != 0);
+		const size_t dims = mat[0].size();
+		if (DIM>0 && static_cast<int>(dims) != DIM)
+			throw std::runtime_error("Data set dimensionality does not match the 'DIM' template argument");
+		index = new index_t( static_cast<int>(dims), *this /* adaptor */, nanoflann::KDTreeSingleIndexAdaptorParams(leaf_max_size ) );
+		index->loadIndex(index_stream);
+	}
+
 	~KDTreeVectorOfVectorsAdaptor() {
 		delete index;
 	}
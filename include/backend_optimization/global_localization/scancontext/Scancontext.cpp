@@ -1,6 +1,8 @@
 #include "Scancontext.h"
 #include <fstream>
 #include <iomanip>
+#include <cstdio>
+#include <cstring>
 
 namespace ScanContext
 {
@@ -338,8 +340,9 @@ namespace ScanContext
         }
 
         // Step 2. 经过一段时间之后，就重新构造 ring-key的kdtree
-        // tree_ reconstruction (not mandatory to make everytime)
-        if (tree_making_period_conter % TREE_MAKING_PERIOD_ == 0) // to save computation cost
+        // tree_ reconstruction (not mandatory to make everytime), skipped if the tree already holds all keys (e.g. loaded from database)
+        bool tree_up_to_date = polarcontext_tree_ && polarcontext_invkeys_to_search_.size() + num_exclude_recent == polarcontext_invkeys_mat_.size();
+        if (tree_making_period_conter % TREE_MAKING_PERIOD_ == 0 && !tree_up_to_date) // to save computation cost
         {
             // TicToc t_tree_construction;
 
@@ -380,7 +383,7 @@ namespace ScanContext
         for (int candidate_iter_idx = 0; candidate_iter_idx < NUM_CANDIDATES_FROM_TREE; candidate_iter_idx++)
         {
             // 每个相似候选帧的SC矩阵
-            MatrixXd polarcontext_candidate = polarcontexts_[candidate_indexes[candidate_iter_idx]];
+            MatrixXd polarcontext_candidate = getDescriptor(candidate_indexes[candidate_iter_idx]);
             // 当前帧和SC矩阵计算相似得分，返回结果是 <最近的sc距离， _sc2右移的列数>
             std::pair<double, int> sc_dist_result = distanceBtnScanContext(curr_desc, polarcontext_candidate);
 
@@ -406,13 +409,13 @@ namespace ScanContext
             loop_id = nn_idx;
 
             // std::cout.precision(3);
-            cout << "[Loop found] Nearest distance: " << min_dist << " btn " << polarcontexts_.size() - 1 << " and " << nn_idx << "." << endl;
+            cout << "[Loop found] Nearest distance: " << min_dist << " btn " << numDescriptors() - 1 << " and " << nn_idx << "." << endl;
             cout << "[Loop found] yaw diff: " << nn_align * PC_UNIT_SECTORANGLE << " deg." << endl;
         }
         else
         {
             // std::cout.precision(3);
-            // cout << "[Not loop] Nearest distance: " << min_dist << " btn " << polarcontexts_.size() - 1 << " and " << nn_idx << "." << endl;
+            // cout << "[Not loop] Nearest distance: " << min_dist << " btn " << numDescriptors() - 1 << " and " << nn_idx << "." << endl;
             // cout << "[Not loop] yaw diff: " << nn_align * PC_UNIT_SECTORANGLE << " deg." << endl;
         }
 
@@ -440,7 +443,7 @@ namespace ScanContext
     {
         const auto &curr_scd = polarcontexts_.back();
         std::ostringstream out;
-        out << std::internal << std::setfill('0') << std::setw(num_digits) << polarcontexts_.size() - 1;
+        out << std::internal << std::setfill('0') << std::setw(num_digits) << numDescriptors() - 1;
         std::string curr_scd_node_idx = out.str();
 
         // delimiter: ", " or " " etc.
@@ -486,9 +489,155 @@ namespace ScanContext
         }
     }
 
+    /**
+     * @brief 把所有描述子、ring-key、sector-key以及ring-key的kdtree写入一个二进制数据库文件
+     *
+     * @param[in] file_path
+     * @return bool
+     */
+    bool SCManager::saveSCDDatabase(const std::string &file_path)
+    {
+        if (numDescriptors() == 0)
+            return false;
+
+        FILE *file = fopen(file_path.c_str(), "wb");
+        if (file == nullptr)
+            return false;
+
+        const uint64_t num = numDescriptors();
+        SCDHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "SCDB", 4);
+        header.version = 1;
+        header.num_ring = PC_NUM_RING;
+        header.num_sector = PC_NUM_SECTOR;
+        header.num_descriptors = num;
+        header.descriptor_offset = sizeof(SCDHeader);
+        header.ringkey_offset = header.descriptor_offset + num * PC_NUM_RING * PC_NUM_SECTOR * sizeof(float);
+        header.sectorkey_offset = header.ringkey_offset + num * PC_NUM_RING * sizeof(float);
+        header.tree_offset = header.sectorkey_offset + num * PC_NUM_SECTOR * sizeof(float);
+        fwrite(&header, sizeof(header), 1, file);
+
+        using RowMajorMatrixXf = Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+        RowMajorMatrixXf desc(PC_NUM_RING, PC_NUM_SECTOR);
+        for (uint64_t i = 0; i < num; ++i)
+        {
+            desc = getDescriptor(i).cast<float>();
+            fwrite(desc.data(), sizeof(float), desc.size(), file);
+        }
+        for (const auto &ringkey : polarcontext_invkeys_mat_)
+            fwrite(ringkey.data(), sizeof(float), PC_NUM_RING, file);
+        for (uint64_t i = 0; i < num; ++i)
+        {
+            Eigen::VectorXf key = getSectorkey(i).transpose().cast<float>();
+            fwrite(key.data(), sizeof(float), PC_NUM_SECTOR, file);
+        }
+
+        // the tree over all keys, which is what relocalize() searches
+        InvKeyTree tree(PC_NUM_RING, polarcontext_invkeys_mat_, 10);
+        tree.index->saveIndex(file);
+        header.tree_size = ftell(file) - header.tree_offset;
+        fseek(file, 0, SEEK_SET);
+        fwrite(&header, sizeof(header), 1, file);
+
+        bool success = !ferror(file);
+        fclose(file);
+        return success;
+    }
+
+    /**
+     * @brief 内存映射二进制数据库文件，描述子和sector-key保留在映射中按需读取，不需要解析文本和重新计算key
+     *        ring-key复制一份给kdtree使用，数据库只能加载到空的SCManager中
+     *
+     * @param[in] file_path
+     * @param[in] num_keyframe 期望的关键帧数量，-1表示不检查
+     * @return bool
+     */
+    bool SCManager::loadSCDDatabase(const std::string &file_path, int num_keyframe)
+    {
+        if (numDescriptors() != 0)
+            return false;
+
+        auto database = std::make_shared<MappedFile>(file_path);
+        if (!database->valid() || database->size() < sizeof(SCDHeader))
+            return false;
+
+        const char *base = database->data();
+        const SCDHeader &header = *reinterpret_cast<const SCDHeader *>(base);
+        const uint64_t num = header.num_descriptors;
+        if (memcmp(header.magic, "SCDB", 4) != 0 || header.version != 1 ||
+            header.num_ring != PC_NUM_RING || header.num_sector != PC_NUM_SECTOR || num == 0 ||
+            (num_keyframe >= 0 && num != (uint64_t)num_keyframe))
+            return false;
+        // every section at its place in the fixed layout and inside the file, num is bounded first so the offsets
+        // do not overflow
+        const uint64_t descriptor_bytes = PC_NUM_RING * PC_NUM_SECTOR * sizeof(float);
+        const uint64_t ringkey_bytes = PC_NUM_RING * sizeof(float);
+        const uint64_t sectorkey_bytes = PC_NUM_SECTOR * sizeof(float);
+        const uint64_t file_size = database->size();
+        if (num > (file_size - sizeof(SCDHeader)) / (descriptor_bytes + ringkey_bytes + sectorkey_bytes) ||
+            header.descriptor_offset != sizeof(SCDHeader) ||
+            header.ringkey_offset != header.descriptor_offset + num * descriptor_bytes ||
+            header.sectorkey_offset != header.ringkey_offset + num * ringkey_bytes ||
+            header.tree_offset != header.sectorkey_offset + num * sectorkey_bytes ||
+            header.tree_size > file_size - header.tree_offset)
+            return false;
+        // candidates are read at random during relocalization
+        madvise(const_cast<char *>(base), database->size(), MADV_RANDOM);
+
+        const float *ringkeys = reinterpret_cast<const float *>(base + header.ringkey_offset);
+        polarcontext_invkeys_mat_.reserve(num);
+        for (uint64_t i = 0; i < num; ++i)
+            polarcontext_invkeys_mat_.emplace_back(ringkeys + i * PC_NUM_RING, ringkeys + (i + 1) * PC_NUM_RING);
+
+        if (header.tree_size > 0)
+        {
+            FILE *tree_stream = fmemopen(const_cast<char *>(base + header.tree_offset), header.tree_size, "rb");
+            if (tree_stream != nullptr)
+            {
+                polarcontext_invkeys_to_search_ = polarcontext_invkeys_mat_;
+                polarcontext_tree_ = std::make_shared<InvKeyTree>(PC_NUM_RING, polarcontext_invkeys_to_search_, tree_stream, 10);
+                fclose(tree_stream);
+            }
+        }
+
+        mapped_descs_ = reinterpret_cast<const float *>(base + header.descriptor_offset);
+        mapped_sectorkeys_ = reinterpret_cast<const float *>(base + header.sectorkey_offset);
+        num_mapped_ = num;
+        database_ = database;
+        return true;
+    }
+
+    /**
+     * @brief 把目录下的.scd文本描述子转换为二进制数据库文件，用于离线转换已有的地图
+     */
+    bool SCManager::convertSCDDirectory(const std::string &path, int num_digits, int num_keyframe, const std::string &file_path)
+    {
+        SCManager sc_manager;
+        sc_manager.loadPriorSCD(path, num_digits, num_keyframe);
+        return sc_manager.saveSCDDatabase(file_path);
+    }
+
+    Eigen::MatrixXd SCManager::getDescriptor(size_t idx) const
+    {
+        if (idx >= num_mapped_)
+            return polarcontexts_[idx - num_mapped_];
+
+        using RowMajorMatrixXf = Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+        return Eigen::Map<const RowMajorMatrixXf>(mapped_descs_ + idx * PC_NUM_RING * PC_NUM_SECTOR, PC_NUM_RING, PC_NUM_SECTOR).cast<double>();
+    }
+
+    Eigen::MatrixXd SCManager::getSectorkey(size_t idx) const
+    {
+        if (idx >= num_mapped_)
+            return polarcontext_vkeys_[idx - num_mapped_];
+
+        return Eigen::Map<const Eigen::RowVectorXf>(mapped_sectorkeys_ + idx * PC_NUM_SECTOR, PC_NUM_SECTOR).cast<double>();
+    }
+
     std::pair<int, float> SCManager::relocalize(pcl::PointCloud<SCPointType> &scan_down)
     {
-        if (polarcontexts_.empty())
+        if (numDescriptors() == 0)
         {
             std::pair<int, float> result{-1, 0.0};
             return result;
@@ -9,6 +9,7 @@
 #include <cstdlib>
 #include <memory>
 #include <iostream>
+#include <cstdint>
 
 #include <Eigen/Dense>
 
@@ -18,6 +19,7 @@
 
 #include "nanoflann.hpp"
 #include "KDTreeVectorOfVectorsAdaptor.h"
+#include <utils/mapped_file.h>
 
 // #include "tictoc.h"
 
@@ -48,6 +50,25 @@ float xy2theta( const float & _x, const float & _y );
 MatrixXd circshift( MatrixXd &_mat, int _num_shift );
 std::vector<float> eig2stdvec( MatrixXd _eigmat );
 
+/*
+ * Layout of the binary descriptor database (little-endian):
+ * [SCDHeader][descriptors: num x ring x sector float32, row-major][ring keys: num x ring float32]
+ * [sector keys: num x sector float32][ring-key tree: nanoflann saveIndex]
+ */
+struct SCDHeader
+{
+    char magic[4];         // "SCDB"
+    uint32_t version;
+    uint32_t num_ring;
+    uint32_t num_sector;
+    uint64_t num_descriptors;
+    uint64_t descriptor_offset;
+    uint64_t ringkey_offset;
+    uint64_t sectorkey_offset;
+    uint64_t tree_offset;
+    uint64_t tree_size;    // 0 if the tree is not stored
+};
+
 
 class SCManager
 {
@@ -69,6 +90,14 @@ public:
 
     void saveCurrentSCD(const std::string &fileName, int num_digits = 6, const std::string &delimiter = " ");
     void loadPriorSCD(const std::string &path, int num_digits, int num_keyframe);
+
+    // binary descriptor database: descriptors, ring/sector keys and ring-key tree in one memory-mapped file
+    bool saveSCDDatabase(const std::string &file_path);
+    bool loadSCDDatabase(const std::string &file_path, int num_keyframe = -1);
+    static bool convertSCDDirectory(const std::string &path, int num_digits, int num_keyframe, const std::string &file_path);
+    size_t numDescriptors() const { return num_mapped_ + polarcontexts_.size(); }
+    Eigen::MatrixXd getDescriptor(size_t idx) const;
+    Eigen::MatrixXd getSectorkey(size_t idx) const;
     std::pair<int, float> relocalize(pcl::PointCloud<SCPointType> &_scan_down);
 
 public:
@@ -94,6 +123,12 @@ public:
     int          tree_making_period_conter = 0;
 
     // data 
+    // descriptors of a loaded database stay in the mapping and take indices [0, num_mapped_), the ones below follow them
+    std::shared_ptr<MappedFile> database_;
+    const float *mapped_descs_ = nullptr;
+    const float *mapped_sectorkeys_ = nullptr;
+    size_t num_mapped_ = 0;
+
     std::vector<double> polarcontexts_timestamp_; // optional.
     std::vector<Eigen::MatrixXd> polarcontexts_;
     std::vector<Eigen::MatrixXd> polarcontext_invkeys_;
@@ -101,6 +101,8 @@ extern double G_m_s2;
 #define LIDAR_SP_LEN    (2)
 #define INIT_COV   (0.0001)
 #define NUM_MATCH_POINTS    (5)
+#define PLANE_BATCH_SIZE    (8)
+#define KNN_BATCH_SIZE      (64)
 #define MAX_MEAS_DIM        (10000)
 
 #define VEC_FROM_ARRAY(v)        v[0],v[1],v[2]
@@ -221,29 +223,62 @@ bool esti_normvector(Matrix<T, 3, 1> &normvec, const PointVector &point, const T
     return true;
 }
 
+/*
+ * Least squares plane n^T * p + 1 = 0 through the NUM_MATCH_POINTS neighbours, the same problem as
+ * A.colPivHouseholderQr().solve(-1) but solved in closed form. With the centroid c and the centered
+ * scatter S, the normal equations are (S + N * c * c^T) * n = -N * c, whose solution is
+ * n = -N * adj(S) * c / (det(S) + N * c^T * adj(S) * c) (matrix determinant lemma). Working on the
+ * centered points keeps it well conditioned far from the origin.
+ */
 template<typename T>
-bool esti_plane(Matrix<T, 4, 1> &pca_result, const PointVector &point, const T &threshold)
+inline bool solve_plane_normal(double sxx, double sxy, double sxz, double syy, double syz, double szz,
+                               double cx, double cy, double cz, Matrix<T, 4, 1> &pca_result)
 {
-    Matrix<T, NUM_MATCH_POINTS, 3> A;
-    Matrix<T, NUM_MATCH_POINTS, 1> b;
-    A.setZero();
-    b.setOnes();
-    b *= -1.0f;
+    // adjugate of the symmetric S
+    const double c00 = syy * szz - syz * syz, c01 = sxz * syz - sxy * szz, c02 = sxy * syz - sxz * syy;
+    const double c11 = sxx * szz - sxz * sxz, c12 = sxy * sxz - sxx * syz, c22 = sxx * syy - sxy * sxy;
+    const double trace = sxx + syy + szz;
+    // (nearly) collinear neighbours do not define a plane
+    if (!(c00 + c11 + c22 > 1e-12 * trace * trace))
+        return false;
+
+    const double ax = c00 * cx + c01 * cy + c02 * cz;
+    const double ay = c01 * cx + c11 * cy + c12 * cz;
+    const double az = c02 * cx + c12 * cy + c22 * cz;
+    const double norm_a = std::sqrt(ax * ax + ay * ay + az * az);
+    if (!(norm_a > 0))
+        return false;
+    const double g = sxx * c00 + sxy * c01 + sxz * c02 + NUM_MATCH_POINTS * (cx * ax + cy * ay + cz * az);
 
+    // n = -N * a / g
+    const double sign = g < 0 ? 1.0 : -1.0;
+    pca_result(0) = sign * ax / norm_a;
+    pca_result(1) = sign * ay / norm_a;
+    pca_result(2) = sign * az / norm_a;
+    pca_result(3) = std::fabs(g) / (NUM_MATCH_POINTS * norm_a);
+    return true;
+}
+
+template<typename T>
+bool esti_plane(Matrix<T, 4, 1> &pca_result, const PointVector &point, const T &threshold)
+{
+    double cx = 0, cy = 0, cz = 0;
     for (int j = 0; j < NUM_MATCH_POINTS; j++)
     {
-        A(j,0) = point[j].x;
-        A(j,1) = point[j].y;
-        A(j,2) = point[j].z;
+        cx += point[j].x; cy += point[j].y; cz += point[j].z;
     }
+    cx /= NUM_MATCH_POINTS; cy /= NUM_MATCH_POINTS; cz /= NUM_MATCH_POINTS;
 
-    Matrix<T, 3, 1> normvec = A.colPivHouseholderQr().solve(b);
+    double sxx = 0, sxy = 0, sxz = 0, syy = 0, syz = 0, szz = 0;
+    for (int j = 0; j < NUM_MATCH_POINTS; j++)
+    {
+        const double x = point[j].x - cx, y = point[j].y - cy, z = point[j].z - cz;
+        sxx += x * x; sxy += x * y; sxz += x * z;
+        syy += y * y; syz += y * z; szz += z * z;
+    }
 
-    T n = normvec.norm();
-    pca_result(0) = normvec(0) / n;
-    pca_result(1) = normvec(1) / n;
-    pca_result(2) = normvec(2) / n;
-    pca_result(3) = 1.0 / n;
+    if (!solve_plane_normal(sxx, sxy, sxz, syy, syz, szz, cx, cy, cz, pca_result))
+        return false;
 
     for (int j = 0; j < NUM_MATCH_POINTS; j++)
     {
@@ -254,6 +289,79 @@ bool esti_plane(Matrix<T, 4, 1> &pca_result, const PointVector &point, const T &
     }
     return true;
 }
+
+/*
+ * esti_plane for up to PLANE_BATCH_SIZE neighbourhoods at once. The neighbours are gathered lane-wise
+ * (structure of arrays), so the accumulation, the solve and the threshold check run over independent
+ * lanes without branches. No instruction set is assumed; gathering the neighbours dominates, the cost
+ * per fit is about that of esti_plane (test/benchmark/bench_esti_plane.cpp).
+ * Neighbourhoods with less than NUM_MATCH_POINTS points are reported invalid.
+ */
+template<typename T>
+void esti_plane_batch(Matrix<T, 4, 1> *pca_result, bool *valid, const PointVector *const *points, int num, const T &threshold)
+{
+    double px[NUM_MATCH_POINTS][PLANE_BATCH_SIZE], py[NUM_MATCH_POINTS][PLANE_BATCH_SIZE], pz[NUM_MATCH_POINTS][PLANE_BATCH_SIZE];
+    bool full[PLANE_BATCH_SIZE];
+    for (int l = 0; l < PLANE_BATCH_SIZE; l++)
+    {
+        full[l] = l < num && points[l]->size() >= NUM_MATCH_POINTS;
+        for (int j = 0; j < NUM_MATCH_POINTS; j++)
+        {
+            // unused lanes get a dummy plane, they are masked out below
+            px[j][l] = full[l] ? (*points[l])[j].x : (j == 0);
+            py[j][l] = full[l] ? (*points[l])[j].y : (j == 1);
+            pz[j][l] = full[l] ? (*points[l])[j].z : (j == 2);
+        }
+    }
+
+    double nx[PLANE_BATCH_SIZE], ny[PLANE_BATCH_SIZE], nz[PLANE_BATCH_SIZE], nd[PLANE_BATCH_SIZE];
+    bool ok[PLANE_BATCH_SIZE];
+#pragma omp simd
+    for (int l = 0; l < PLANE_BATCH_SIZE; l++)
+    {
+        double cx = 0, cy = 0, cz = 0;
+        for (int j = 0; j < NUM_MATCH_POINTS; j++)
+        {
+            cx += px[j][l]; cy += py[j][l]; cz += pz[j][l];
+        }
+        cx /= NUM_MATCH_POINTS; cy /= NUM_MATCH_POINTS; cz /= NUM_MATCH_POINTS;
+
+        double sxx = 0, sxy = 0, sxz = 0, syy = 0, syz = 0, szz = 0;
+        for (int j = 0; j < NUM_MATCH_POINTS; j++)
+        {
+            const double x = px[j][l] - cx, y = py[j][l] - cy, z = pz[j][l] - cz;
+            sxx += x * x; sxy += x * y; sxz += x * z;
+            syy += y * y; syz += y * z; szz += z * z;
+        }
+
+        // same as solve_plane_normal, branch free
+        const double c00 = syy * szz - syz * syz, c01 = sxz * syz - sxy * szz, c02 = sxy * syz - sxz * syy;
+        const double c11 = sxx * szz - sxz * sxz, c12 = sxy * sxz - sxx * syz, c22 = sxx * syy - sxy * sxy;
+        const double trace = sxx + syy + szz;
+        const double ax = c00 * cx + c01 * cy + c02 * cz;
+        const double ay = c01 * cx + c11 * cy + c12 * cz;
+        const double az = c02 * cx + c12 * cy + c22 * cz;
+        const double norm_a = std::sqrt(ax * ax + ay * ay + az * az);
+        const double g = sxx * c00 + sxy * c01 + sxz * c02 + NUM_MATCH_POINTS * (cx * ax + cy * ay + cz * az);
+        const double scale = (g < 0 ? 1.0 : -1.0) / (norm_a + 1e-300);
+        nx[l] = ax * scale;
+        ny[l] = ay * scale;
+        nz[l] = az * scale;
+        nd[l] = std::fabs(g) / (NUM_MATCH_POINTS * norm_a + 1e-300);
+
+        bool fit = c00 + c11 + c22 > 1e-12 * trace * trace && norm_a > 0;
+        for (int j = 0; j < NUM_MATCH_POINTS; j++)
+            fit = fit && std::fabs(nx[l] * px[j][l] + ny[l] * py[j][l] + nz[l] * pz[j][l] + nd[l]) <= threshold;
+        ok[l] = fit;
+    }
+
+    for (int l = 0; l < num; l++)
+    {
+        valid[l] = full[l] && ok[l];
+        pca_result[l] << nx[l], ny[l], nz[l], nd[l];
+    }
+}
+
 // const bool time_list(PointType &x, PointType &y); // {return (x.curvature < y.curvature);};
 // template<typename T>
 // const bool time_list(PointType &x, PointType &y) {return (x.curvature < y.curvature);};
@@ -0,0 +1,96 @@
+/*
+ * BSD 3-Clause License
+
+ *  Copyright (c) 2025, Dongjiao He
+ *  All rights reserved.
+ *
+ *  Author: Dongjiao HE <hdj65822@connect.hku.hk>
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Universitaet Bremen nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GNSS_ATMOS_DELAY_H_
+#define GNSS_ATMOS_DELAY_H_
+
+#include <memory>
+#include <vector>
+#include <Eigen/Dense>
+#include <gnss_comm/gnss_utility.hpp>
+#include <gnss_comm/gnss_spp.hpp>
+
+namespace ligo {
+
+// broadcast ionospheric parameters, shared by all the factors added with the same parameters
+struct AtmosParams
+{
+    std::vector<double> iono_params;
+    double update_thres; // delays are recomputed once the receiver moved farther than this (m)
+};
+typedef std::shared_ptr<const AtmosParams> AtmosParamsPtr;
+
+/*
+ * Azimuth/elevation and tropospheric/ionospheric delays of one measurement. They change by far less
+ * than the measurement noise over the updates of a relinearization, so the values of the last
+ * receiver position are reused until the receiver moved more than update_thres.
+ */
+class AtmosDelayCache
+{
+    public:
+        void evaluate(const Eigen::Vector3d &P_ecef, const Eigen::Vector3d &sv_pos, double time_current, const AtmosParams &params,
+            double azel[2], double &ion_delay, double &tro_delay)
+        {
+            if (!valid || (P_ecef - rcv_pos).norm() > params.update_thres)
+            {
+                cached_azel[0] = 0;
+                cached_azel[1] = M_PI/2.0;
+                cached_ion_delay = 0;
+                cached_tro_delay = 0;
+                if (P_ecef.norm() > 0)
+                {
+                    gnss_comm::sat_azel(P_ecef, sv_pos, cached_azel);
+                    Eigen::Vector3d rcv_lla = gnss_comm::ecef2geo(P_ecef);
+                    cached_tro_delay = gnss_comm::calculate_trop_delay(gnss_comm::sec2time(time_current), rcv_lla, cached_azel);
+                    cached_ion_delay = gnss_comm::calculate_ion_delay(gnss_comm::sec2time(time_current), params.iono_params, rcv_lla, cached_azel); // rely on local pose
+                }
+                rcv_pos = P_ecef;
+                valid = true;
+            }
+            azel[0] = cached_azel[0];
+            azel[1] = cached_azel[1];
+            ion_delay = cached_ion_delay;
+            tro_delay = cached_tro_delay;
+        }
+
+    private:
+        bool valid = false;
+        Eigen::Vector3d rcv_pos;
+        double cached_azel[2], cached_ion_delay, cached_tro_delay;
+};
+}
+
+#endif
@@ -0,0 +1,238 @@
+/*
+ * BSD 3-Clause License
+
+ *  Copyright (c) 2025, Dongjiao He
+ *  All rights reserved.
+ *
+ *  Author: Dongjiao HE <hdj65822@connect.hku.hk>
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Universitaet Bremen nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GNSS_PSR_DOPP_EPOCH_FACTOR_H_
+#define GNSS_PSR_DOPP_EPOCH_FACTOR_H_
+
+#include <vector>
+#include <Eigen/Dense>
+#include <gtsam/nonlinear/Marginals.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/base/Vector.h>
+#include <gtsam/config.h>
+#include <gnss_factor/gnss_atmos_delay.hpp>
+#include <gnss_factor/gnss_psr_dopp_factor_nor.hpp>
+using namespace gnss_comm;
+
+namespace ligo {
+
+// pseudo-range and doppler measurements of all satellites of one epoch, one array per field
+struct GnssEpochMeas
+{
+    Eigen::Vector3d Tex_imu_r = Eigen::Vector3d::Zero(); // rotated lever arm, the same for all satellites
+    double time_current = 0;
+    std::vector<Eigen::Vector3d> sv_pos, sv_vel;
+    std::vector<double> svdt, tgd, svddt, pr_uura, dp_uura, relative_sqrt_info, freq, psr_measured, dopp_measured;
+    std::vector<int> sys_idx;
+    std::vector<char> invalid_lidar;
+
+    size_t size() const { return sys_idx.size(); }
+    bool empty() const { return sys_idx.empty(); }
+
+    // values_ has the layout of GnssPsrDoppFactorNoR
+    void push_back(const double values_[27], int sys_idx_, bool invalid_lidar_)
+    {
+        Tex_imu_r << values_[0], values_[1], values_[2];
+        time_current = values_[23];
+        sv_pos.emplace_back(values_[3], values_[4], values_[5]);
+        sv_vel.emplace_back(values_[6], values_[7], values_[8]);
+        svdt.push_back(values_[9]);
+        tgd.push_back(values_[10]);
+        svddt.push_back(values_[11]);
+        pr_uura.push_back(values_[12]);
+        dp_uura.push_back(values_[13]);
+        relative_sqrt_info.push_back(values_[14]);
+        freq.push_back(values_[24]);
+        psr_measured.push_back(values_[25]);
+        dopp_measured.push_back(values_[26]);
+        sys_idx.push_back(sys_idx_);
+        invalid_lidar.push_back(invalid_lidar_);
+    }
+};
+
+/*
+ * All GnssPsrDoppFactorNoR of one epoch in a single factor: they share the keys, so ISAM2 handles one
+ * factor of 2N rows instead of N factors of 2 rows. Every satellite keeps its own noise model,
+ * the rows of satellite i are whitened (and reweighted if the model is robust) by meas_model as the
+ * single factor would do; the factor itself has a unit noise model. error() is the sum of the costs of
+ * the single factors, i.e. the robust cost of every satellite, not the squared reweighted residual.
+ */
+class GnssPsrDoppEpochFactorNoR : public gtsam::NoiseModelFactor5<gtsam::Vector6, gtsam::Vector4, gtsam::Vector1, gtsam::Vector3, gtsam::Rot3>
+{
+    public:
+        GnssPsrDoppEpochFactorNoR(gtsam::Key j1, gtsam::Key j2, gtsam::Key j3, gtsam::Key j4, gtsam::Key j5, const GnssEpochMeas &meas_, AtmosParamsPtr atmos_params_,
+        Eigen::Vector3d hat_omg_T_, const gtsam::SharedNoiseModel& meas_model_) :
+        gtsam::NoiseModelFactor5<gtsam::Vector6, gtsam::Vector4, gtsam::Vector1, gtsam::Vector3, gtsam::Rot3>(gtsam::noiseModel::Unit::Create(2 * meas_.size()), j1, j2, j3, j4, j5),
+        meas(meas_), atmos_params(atmos_params_), hat_omg_T(hat_omg_T_), meas_model(meas_model_), atmos_cache(meas_.size()) {}
+
+        virtual ~GnssPsrDoppEpochFactorNoR() {}
+
+        gtsam::Vector evaluateError(const gtsam::Vector6 &pos_vel_bias, const gtsam::Vector4 &dt, const gtsam::Vector1 &ddt, const gtsam::Vector3 &ext_p, const gtsam::Rot3 &ext_R,
+            boost::optional<gtsam::Matrix&> H1 = boost::none, boost::optional<gtsam::Matrix&> H2 = boost::none, boost::optional<gtsam::Matrix&> H3 = boost::none, 
+            boost::optional<gtsam::Matrix&> H4 = boost::none, boost::optional<gtsam::Matrix&> H5 = boost::none) const
+        {
+            return evaluate(true, pos_vel_bias, dt, ddt, ext_p, ext_R, H1, H2, H3, H4, H5);
+        }
+
+        double error(const gtsam::Values &c) const override
+        {
+            if (!active(c))
+                return 0.0;
+            const gtsam::Vector residual = evaluate(false, c.at<gtsam::Vector6>(key1()), c.at<gtsam::Vector4>(key2()), c.at<gtsam::Vector1>(key3()),
+                c.at<gtsam::Vector3>(key4()), c.at<gtsam::Rot3>(key5()));
+            double cost = 0;
+            for (size_t i = 0; i < meas.size(); ++i)
+                cost += satelliteError(residual.segment<2>(2*i));
+            return cost;
+        }
+
+    private:
+        // the cost gtsam gives a single factor with meas_model for the unwhitened residual of one satellite
+        double satelliteError(const gtsam::Vector &residual_i) const
+        {
+            if (!meas_model)
+                return 0.5 * residual_i.squaredNorm();
+#if GTSAM_VERSION_NUMERIC >= 40100
+            return meas_model->loss(meas_model->squaredMahalanobisDistance(residual_i));
+#else
+            return 0.5 * meas_model->distance(residual_i);
+#endif
+        }
+
+        // residuals of all satellites, whitened per satellite by meas_model if whiten
+        gtsam::Vector evaluate(bool whiten, const gtsam::Vector6 &pos_vel_bias, const gtsam::Vector4 &dt, const gtsam::Vector1 &ddt, const gtsam::Vector3 &ext_p, const gtsam::Rot3 &ext_R,
+            boost::optional<gtsam::Matrix&> H1 = boost::none, boost::optional<gtsam::Matrix&> H2 = boost::none, boost::optional<gtsam::Matrix&> H3 = boost::none, 
+            boost::optional<gtsam::Matrix&> H4 = boost::none, boost::optional<gtsam::Matrix&> H5 = boost::none) const
+        {
+            const size_t num = meas.size();
+            const Eigen::Vector3d local_pos = meas.Tex_imu_r + pos_vel_bias.segment<3>(0);
+            const Eigen::Vector3d local_vel = pos_vel_bias.segment<3>(3) + hat_omg_T;
+            const Eigen::Matrix3d R_ecef_local = ext_R.matrix();
+            const Eigen::Vector3d P_ecef = R_ecef_local * local_pos + ext_p;
+            const Eigen::Vector3d V_ecef = R_ecef_local * local_vel;
+
+            Eigen::Matrix3d d_pos, d_vel;
+            d_pos << 0.0, -local_pos[2], local_pos[1], 
+                        local_pos[2], 0.0, -local_pos[0], 
+                        -local_pos[1], local_pos[0], 0.0;
+            d_vel << 0.0, -local_vel[2], local_vel[1], 
+                        local_vel[2], 0.0, -local_vel[0], 
+                        -local_vel[1], local_vel[0], 0.0;
+            const Eigen::Matrix3d R_d_pos = R_ecef_local * d_pos, R_d_vel = R_ecef_local * d_vel;
+
+            const bool jacobian = H1 || H2 || H3 || H4 || H5;
+            if (H1) *H1 = gtsam::Matrix::Zero(2*num, 6);
+            if (H2) *H2 = gtsam::Matrix::Zero(2*num, 4);
+            if (H3) *H3 = gtsam::Matrix::Zero(2*num, 1);
+            if (H4) *H4 = gtsam::Matrix::Zero(2*num, 3);
+            if (H5) *H5 = gtsam::Matrix::Zero(2*num, 3);
+
+            // the jacobian blocks of one satellite, in the order of the keys
+            std::vector<gtsam::Matrix> blocks;
+            if (jacobian)
+            {
+                blocks.push_back(gtsam::Matrix::Zero(2, 6));
+                blocks.push_back(gtsam::Matrix::Zero(2, 4));
+                blocks.push_back(gtsam::Matrix::Zero(2, 1));
+                blocks.push_back(gtsam::Matrix::Zero(2, 3));
+                blocks.push_back(gtsam::Matrix::Zero(2, 3));
+            }
+            gtsam::Vector residual(2*num), residual_i(2);
+            for (size_t i = 0; i < num; ++i)
+            {
+                const Eigen::Vector3d &sv_pos = meas.sv_pos[i], &sv_vel = meas.sv_vel[i];
+                double ion_delay = 0, tro_delay = 0;
+                double azel[2];
+                atmos_cache[i].evaluate(P_ecef, sv_pos, meas.time_current, *atmos_params, azel, ion_delay, tro_delay);
+                double sin_el = sin(azel[1]);
+                double sin_el_2 = sin_el*sin_el;
+                double pr_weight = sin_el_2 / meas.pr_uura[i] * meas.relative_sqrt_info[i];
+                if (meas.invalid_lidar[i]) pr_weight *= -1.0;
+                double dp_weight = sin_el_2 / meas.dp_uura[i] * meas.relative_sqrt_info[i] * PSR_TO_DOPP_RATIO;
+
+                const Eigen::Vector3d rcv2sat_ecef = sv_pos - P_ecef;
+                const double norm = rcv2sat_ecef.norm();
+                const Eigen::Vector3d rcv2sat_unit = rcv2sat_ecef / norm;
+                const double wavelength = LIGHT_SPEED / meas.freq[i];
+                const double psr_sagnac = EARTH_OMG_GPS*(sv_pos(0)*P_ecef(1)-sv_pos(1)*P_ecef(0))/LIGHT_SPEED;
+                const double psr_estimated = norm + psr_sagnac + dt[meas.sys_idx[i]] - meas.svdt[i]*LIGHT_SPEED + 
+                                        ion_delay + tro_delay + meas.tgd[i]*LIGHT_SPEED;
+                const double dopp_sagnac = EARTH_OMG_GPS/LIGHT_SPEED*(sv_vel(0)*P_ecef(1)+
+                        sv_pos(0)*V_ecef(1) - sv_vel(1)*P_ecef(0) - sv_pos(1)*V_ecef(0));
+                const double dopp_estimated = (sv_vel - V_ecef).dot(rcv2sat_unit) + ddt[0] + dopp_sagnac - meas.svddt[i]*LIGHT_SPEED;
+                residual_i[0] = (psr_estimated - meas.psr_measured[i]) * pr_weight;
+                residual_i[1] = (dopp_estimated + meas.dopp_measured[i]*wavelength) * dp_weight;
+
+                if (jacobian)
+                {
+                    const Eigen::Matrix3d unit2rcv_pos = (rcv2sat_ecef * rcv2sat_ecef.transpose() - Eigen::Matrix3d::Identity() * norm * norm) / (norm * norm * norm);
+                    const Eigen::RowVector3d dopp_pos = (sv_vel-V_ecef).transpose() * unit2rcv_pos;
+
+                    blocks[0].block<1,3>(0,0) = -rcv2sat_unit.transpose() * R_ecef_local * pr_weight;
+                    blocks[0].block<1,3>(1,0) = dopp_pos * R_ecef_local * dp_weight;
+                    blocks[0].block<1,3>(1,3) = -rcv2sat_unit.transpose() * R_ecef_local * dp_weight;
+                    blocks[1].setZero();
+                    blocks[1](0, meas.sys_idx[i]) = pr_weight;
+                    blocks[2](0,0) = 0.0;
+                    blocks[2](1,0) = dp_weight;
+                    blocks[3].block<1,3>(0,0) = -rcv2sat_unit.transpose() * pr_weight;
+                    blocks[3].block<1,3>(1,0) = dopp_pos * dp_weight;
+                    blocks[4].block<1,3>(0,0) = rcv2sat_unit.transpose() * R_d_pos * pr_weight;
+                    blocks[4].block<1,3>(1,0) = rcv2sat_unit.transpose() * R_d_vel * dp_weight - dopp_pos * R_d_pos * dp_weight;
+                }
+                if (whiten && meas_model)
+                    meas_model->WhitenSystem(blocks, residual_i);
+
+                residual.segment<2>(2*i) = residual_i;
+                if (H1) H1->middleRows<2>(2*i) = blocks[0];
+                if (H2) H2->middleRows<2>(2*i) = blocks[1];
+                if (H3) H3->middleRows<2>(2*i) = blocks[2];
+                if (H4) H4->middleRows<2>(2*i) = blocks[3];
+                if (H5) H5->middleRows<2>(2*i) = blocks[4];
+            }
+            return residual;
+        }
+
+        GnssEpochMeas meas;
+        AtmosParamsPtr atmos_params;
+        Eigen::Vector3d hat_omg_T;
+        gtsam::SharedNoiseModel meas_model;
+        mutable std::vector<AtmosDelayCache> atmos_cache; // a factor is linearized by one thread at a time
+};
+}
+
+#endif
@@ -43,6 +43,7 @@
 #include <gtsam/geometry/Pose3.h>
 #include <gtsam/inference/Symbol.h>
 #include <gtsam/base/Vector.h>
+#include <gnss_factor/gnss_atmos_delay.hpp>
 using namespace gnss_comm;
 
 namespace ligo {
@@ -54,9 +55,9 @@ class GnssPsrDoppFactorNoR : public gtsam::NoiseModelFactor5<gtsam::Vector6, gts
     public: 
         // EIGEN_MAKE_ALIGNED_OPERATOR_NEW
         // GnssPsrDoppFactor() = delete;
-        GnssPsrDoppFactorNoR(gtsam::Key j1, gtsam::Key j2, gtsam::Key j3, gtsam::Key j4, gtsam::Key j5, bool invalid_lidar_, double values_[27], int sys_idx_, 
+        GnssPsrDoppFactorNoR(gtsam::Key j1, gtsam::Key j2, gtsam::Key j3, gtsam::Key j4, gtsam::Key j5, bool invalid_lidar_, double values_[27], AtmosParamsPtr atmos_params_, int sys_idx_, 
         Eigen::Vector3d hat_omg_T_, const gtsam::SharedNoiseModel& model) :
-        hat_omg_T(hat_omg_T_), sys_idx(sys_idx_), invalid_lidar(invalid_lidar_),
+        hat_omg_T(hat_omg_T_), atmos_params(atmos_params_), sys_idx(sys_idx_), invalid_lidar(invalid_lidar_),
         gtsam::NoiseModelFactor5<gtsam::Vector6, gtsam::Vector4, gtsam::Vector1, gtsam::Vector3, gtsam::Rot3>(model, j1, j2, j3, j4, j5) {
             Tex_imu_r << values_[0], values_[1], values_[2];
             // anc_local << values_[3], values_[4], values_[5];
@@ -68,10 +69,6 @@ class GnssPsrDoppFactorNoR : public gtsam::NoiseModelFactor5<gtsam::Vector6, gts
             pr_uura = values_[12];
             dp_uura = values_[13];
             relative_sqrt_info = values_[14];
-            for (int i = 0; i < 8; i++)
-            {
-                latest_gnss_iono_params.push_back(values_[15+i]);
-            }
             time_current = values_[23];
             freq = values_[24];
             psr_measured = values_[25];
@@ -126,14 +123,8 @@ class GnssPsrDoppFactorNoR : public gtsam::NoiseModelFactor5<gtsam::Vector6, gts
             Eigen::Vector3d V_ecef = R_ecef_local * local_vel;
 
             double ion_delay = 0, tro_delay = 0;
-            double azel[2] = {0, M_PI/2.0};
-            if (P_ecef.norm() > 0)
-            {
-                sat_azel(P_ecef, sv_pos, azel);
-                Eigen::Vector3d rcv_lla = ecef2geo(P_ecef);
-                tro_delay = calculate_trop_delay(sec2time(time_current), rcv_lla, azel);
-                ion_delay = calculate_ion_delay(sec2time(time_current), latest_gnss_iono_params, rcv_lla, azel); // rely on local pose
-            }
+            double azel[2];
+            atmos_cache.evaluate(P_ecef, sv_pos, time_current, *atmos_params, azel, ion_delay, tro_delay);
             double sin_el = sin(azel[1]);
             double sin_el_2 = sin_el*sin_el;
             double pr_weight = sin_el_2 / pr_uura * relative_sqrt_info; // not requisite
@@ -273,7 +264,8 @@ class GnssPsrDoppFactorNoR : public gtsam::NoiseModelFactor5<gtsam::Vector6, gts
     private:
         Eigen::Vector3d Tex_imu_r, anc_local, sv_pos, sv_vel, hat_omg_T;
         double svdt, tgd, svddt, pr_uura, dp_uura, relative_sqrt_info, time_current, freq, psr_measured, dopp_measured;
-        std::vector<double> latest_gnss_iono_params;
+        AtmosParamsPtr atmos_params;
+        mutable AtmosDelayCache atmos_cache; // a factor is linearized by one thread at a time
         int sys_idx;
         bool invalid_lidar;
 };
@@ -5,6 +5,8 @@
 #ifndef FASTER_LIO_EIGEN_TYPES_H
 #define FASTER_LIO_EIGEN_TYPES_H
 
+#include <cstdint>
+
 #include <Eigen/Core>
 #include <Eigen/Dense>
 #include <Eigen/Geometry>
@@ -75,6 +77,21 @@ inline size_t hash_vec<3>::operator()(const Eigen::Matrix<int, 3, 1>& v) const {
     return size_t(((v[0]) * 73856093) ^ ((v[1]) * 471943) ^ ((v[2]) * 83492791)) % 10000000;
 }
 
+/// morton code (z-order) of a 3d voxel index, interleaves the low 21 bits of the axes so that nearby voxels get
+/// nearby codes
+inline uint64_t morton_code(const Eigen::Matrix<int, 3, 1>& v) {
+    auto spread = [](uint64_t x) {
+        x &= 0x1fffff;
+        x = (x | x << 32) & 0x1f00000000ffffULL;
+        x = (x | x << 16) & 0x1f0000ff0000ffULL;
+        x = (x | x << 8) & 0x100f00f00f00f00fULL;
+        x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+        x = (x | x << 2) & 0x1249249249249249ULL;
+        return x;
+    };
+    return spread(v[0] + (1 << 20)) | spread(v[1] + (1 << 20)) << 1 | spread(v[2] + (1 << 20)) << 2;
+}
+
 // constexpr auto less_vec2i = [](const Vec2i& v1, const Vec2i& v2) {
 //     return v1[0] < v2[0] || (v1[0] == v2[0] && v1[1] < v2[1]);
 // };
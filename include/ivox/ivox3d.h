@@ -8,16 +8,20 @@
 #include <glog/logging.h>
 // #include <execution>
 #include <list>
+#include <memory>
 #include <thread>
+#include <unordered_set>
 
 #include "eigen_types.h"
 #include "ivox3d_node.hpp"
+#include "ivox3d_snapshot.h"
 
 namespace faster_lio {
 
 enum class IVoxNodeType {
     DEFAULT,  // linear ivox
     PHC,      // phc ivox
+    FLAT,     // open addressing voxel hash with pooled point storage, see ivox3d_flat.h
 };
 
 /// traits for NodeType
@@ -34,6 +38,11 @@ struct IVoxNodeTypeTraits<IVoxNodeType::PHC, PointT, dim> {
     using NodeType = IVoxNodePhc<PointT, dim>;
 };
 
+template <typename PointT, int dim>
+struct IVoxNodeTypeTraits<IVoxNodeType::FLAT, PointT, dim> {
+    using NodeType = IVoxFlatNode;
+};
+
 template <int dim = 3, IVoxNodeType node_type = IVoxNodeType::DEFAULT, typename PointType = pcl::PointXYZ>
 class IVox {
    public:
@@ -55,6 +64,7 @@ class IVox {
         float inv_resolution_ = 10.0;                   // inverse resolution
         NearbyType nearby_type_ = NearbyType::NEARBY6;  // nearby range
         std::size_t capacity_ = 1000000;                // capacity
+        bool copy_on_write_ = false;                    // versioned storage with O(1) snapshot
     };
 
     /**
@@ -74,6 +84,16 @@ class IVox {
 
     void AddPoints(std::vector<Eigen::Vector3d> &points_to_add);
 
+    /**
+     * add points only into voxels that do not exist yet, used to (re)load prior map tiles
+     * whose voxels may be partly present
+     * @param points_to_add
+     */
+    void AddPointsToNewGrids(const PointVector& points_to_add);
+
+    /// whether the voxel of a point exists
+    bool HasGrid(const PointType& pt) { return FindNode(Pos2Grid(ToEigen<float, dim>(pt))) != nullptr; }
+
     /// get nn
     bool GetClosestPoint(const PointType& pt, PointType& closest_pt);
 
@@ -83,6 +103,14 @@ class IVox {
     /// get nn in cloud
     bool GetClosestPoint(const PointVector& cloud, PointVector& closest_cloud);
 
+    /**
+     * knn of num points at once, without allocations once the thread local buffers have grown. The up to max_num
+     * neighbours of pts[i] are written nearest first to neighbours[i * max_num], their number to num_neighbours[i].
+     * The voxels of the next point are looked up and their points prefetched before the current point is searched.
+     */
+    void GetClosestPoints(const PointType* pts, size_t num, PointType* neighbours, int* num_neighbours,
+                          int max_num = 5, double max_range = 5.0);
+
     /// get number of points
     size_t NumPoints() const;
 
@@ -92,15 +120,75 @@ class IVox {
     /// get statistics of the points
     std::vector<float> StatGridPoints() const;
 
+    /// share the voxels of another ivox in O(1), voxels are copied lazily on the first write (copy_on_write_ only)
+    void SnapshotFrom(IVox& other);
+
+    /// number of voxels written since the last snapshot
+    size_t NumDirtyGrids() const { return cow_delta_.size(); }
+
+    /**
+     * copy the voxels and their points in morton order of the voxel keys, so the voxels around a query are close in
+     * memory. Meant for the static map after loading: the LRU order is replaced by the morton order, with copy on
+     * write the voxels end up in a single layer and the snapshots taken before keep the old ones.
+     */
+    void Compact();
+
+    /**
+     * remove the voxels for which pred(box_min, box_max) is true, [box_min, box_max) being the box of the voxel.
+     * Returns the number of removed voxels. With copy on write the remaining voxels end up in a single layer, the
+     * snapshots taken before keep the old ones.
+     */
+    template <typename Pred>
+    size_t RemoveGridsIf(Pred pred);
+
+    /**
+     * write the voxels into a snapshot file (see ivox3d_snapshot.h), source_size and source_mtime identify the map
+     * file the ivox was built from
+     */
+    bool Save(const std::string& path, uint64_t source_size, int64_t source_mtime) const;
+
+    /// replace the voxels by those of a snapshot, false if it is missing, of another map file or resolution
+    bool Load(const std::string& path, uint64_t source_size, int64_t source_mtime);
+
     std::unordered_map<KeyType, typename std::list<std::pair<KeyType, NodeType>>::iterator, hash_vec<dim>>
         grids_map_;   
     KeyType Pos2Grid(const PtType& pt) const;
     KeyType Pos2Grid_(const PtType& pt, const double &defined_res) const;
 
    private:
+    using NodePtr = std::shared_ptr<NodeType>;
+
+    /// a voxel of the copy on write storage and the write counter of its last write
+    struct CowGrid {
+        NodePtr node;
+        uint64_t stamp;
+    };
+    using GridLayer = std::unordered_map<KeyType, CowGrid, hash_vec<dim>>;
+
+    static constexpr size_t kMaxCowLayers = 4;
+
     /// generate the nearby grids according to the given options
     void GenerateNearbyGrids();
 
+    /// find the voxel of a key, nullptr if not exist
+    inline NodeType* FindNode(const KeyType& key);
+
+    /// insert one point into its voxel
+    void InsertPoint(const PointType& pt);
+
+    /// freeze the written voxels into a shared layer and merge small layers
+    void FreezeDelta();
+
+    /**
+     * flatten the copy on write storage into a single layer without its least recently written voxels, keeping
+     * 7/8 of capacity_, so the eviction runs once per capacity_ / 8 new voxels
+     */
+    void EvictCowGrids();
+
+    /// visit every voxel once, from the most to the least recently written
+    template <typename Func>
+    void ForEachGrid(Func func) const;
+
     /// position to grid
     // KeyType Pos2Grid(const PtType& pt) const;
 
@@ -109,6 +197,11 @@ class IVox {
         // grids_map_;                                        // voxel hash map
     std::list<std::pair<KeyType, NodeType>> grids_cache_;  // voxel cache
     std::vector<KeyType> nearby_grids_;                    // nearbys
+
+    std::vector<std::shared_ptr<const GridLayer>> cow_layers_;  // frozen layers shared by snapshots, oldest first
+    GridLayer cow_delta_;                                       // voxels written since the last snapshot
+    size_t cow_num_grids_ = 0;                                  // number of distinct voxels over all layers
+    uint64_t cow_stamp_ = 0;                                    // write counter, orders the voxels for the eviction
 };
 
 template <int dim, IVoxNodeType node_type, typename PointType>
@@ -117,10 +210,10 @@ bool IVox<dim, node_type, PointType>::GetClosestPoint(const PointType& pt, Point
     auto key = Pos2Grid(ToEigen<float, dim>(pt));
     std::for_each(nearby_grids_.begin(), nearby_grids_.end(), [&key, &candidates, &pt, this](const KeyType& delta) {
         auto dkey = key + delta;
-        auto iter = grids_map_.find(dkey);
-        if (iter != grids_map_.end()) {
+        NodeType* node = FindNode(dkey);
+        if (node != nullptr) {
             DistPoint dist_point;
-            bool found = iter->second->second.NNPoint(pt, dist_point);
+            bool found = node->NNPoint(pt, dist_point);
             if (found) {
                 candidates.emplace_back(dist_point);
             }
@@ -139,8 +232,8 @@ bool IVox<dim, node_type, PointType>::GetClosestPoint(const PointType& pt, Point
 template <int dim, IVoxNodeType node_type, typename PointType>
 bool IVox<dim, node_type, PointType>::GetClosestPoint(const PointType& pt, PointVector& closest_pt, int max_num,
                                                       double max_range) {
-    std::vector<DistPoint> candidates;
-    candidates.reserve(max_num * nearby_grids_.size());
+    thread_local std::vector<DistPoint> candidates;
+    candidates.clear();
     // cout << nearby_grids_.size() << ";" << endl;
     auto key = Pos2Grid(ToEigen<float, dim>(pt));
 
@@ -155,13 +248,13 @@ bool IVox<dim, node_type, PointType>::GetClosestPoint(const PointType& pt, Point
 
     for (const KeyType& delta : nearby_grids_) {
         auto dkey = key + delta;
-        auto iter = grids_map_.find(dkey);
-        if (iter != grids_map_.end()) {
+        NodeType* node = FindNode(dkey);
+        if (node != nullptr) {
 #ifdef INNER_TIMER
             auto t1 = std::chrono::high_resolution_clock::now();
 #endif
             // cout << pt << endl;
-            auto tmp = iter->second->second.KNNPointByCondition(candidates, pt, max_num, max_range);
+            auto tmp = node->KNNPointByCondition(candidates, pt, max_num, max_range);
 #ifdef INNER_TIMER
             auto t2 = std::chrono::high_resolution_clock::now();
             auto knn = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
@@ -211,8 +304,55 @@ bool IVox<dim, node_type, PointType>::GetClosestPoint(const PointType& pt, Point
     return closest_pt.empty() == false;
 }
 
+template <int dim, IVoxNodeType node_type, typename PointType>
+void IVox<dim, node_type, PointType>::GetClosestPoints(const PointType* pts, size_t num, PointType* neighbours,
+                                                       int* num_neighbours, int max_num, double max_range) {
+    thread_local std::vector<DistPoint> candidates;
+    thread_local std::vector<NodeType*> nodes, next_nodes;
+    auto find_nodes = [this](const PointType& pt, std::vector<NodeType*>& found) {
+        found.clear();
+        auto key = Pos2Grid(ToEigen<float, dim>(pt));
+        for (const KeyType& delta : nearby_grids_) {
+            NodeType* node = FindNode(key + delta);
+            if (node != nullptr) {
+                node->Prefetch();
+                found.push_back(node);
+            }
+        }
+    };
+
+    if (num > 0) {
+        find_nodes(pts[0], next_nodes);
+    }
+    for (size_t i = 0; i < num; ++i) {
+        nodes.swap(next_nodes);
+        if (i + 1 < num) {
+            find_nodes(pts[i + 1], next_nodes);
+        }
+
+        candidates.clear();
+        for (NodeType* node : nodes) {
+            node->KNNPointByCondition(candidates, pts[i], max_num, max_range);
+        }
+        if (candidates.size() > size_t(max_num)) {
+            std::nth_element(candidates.begin(), candidates.begin() + max_num - 1, candidates.end());
+            candidates.resize(max_num);
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        PointType* out = neighbours + i * max_num;
+        for (size_t j = 0; j < candidates.size(); ++j) {
+            out[j] = candidates[j].Get();
+        }
+        num_neighbours[i] = candidates.size();
+    }
+}
+
 template <int dim, IVoxNodeType node_type, typename PointType>
 size_t IVox<dim, node_type, PointType>::NumValidGrids() const {
+    if (options_.copy_on_write_) {
+        return cow_num_grids_;
+    }
     return grids_map_.size();
 }
 
@@ -261,58 +401,356 @@ bool IVox<dim, node_type, PointType>::GetClosestPoint(const PointVector& cloud,
 
 template <int dim, IVoxNodeType node_type, typename PointType>
 void IVox<dim, node_type, PointType>::AddPoints(const PointVector& points_to_add) {
-    for(size_t i = 0; i<points_to_add.size(); i++) {
-        auto key = Pos2Grid(Eigen::Matrix<float, dim, 1>(points_to_add[i].x, points_to_add[i].y, points_to_add[i].z));
-        auto iter = grids_map_.find(key);
-        if (iter == grids_map_.end()) {
-            PointType center;
-            center.getVector3fMap() = key.template cast<float>() * options_.resolution_;
-
-            grids_cache_.push_front({key, NodeType(center, options_.resolution_)});
-            grids_map_.insert({key, grids_cache_.begin()});
-
-            grids_cache_.front().second.InsertPoint(points_to_add[i]);
-
-            if (grids_map_.size() >= options_.capacity_) {
-                grids_map_.erase(grids_cache_.back().first);
-                grids_cache_.pop_back();
-            }
-        } else {
-            iter->second->second.InsertPoint(points_to_add[i]);
-            grids_cache_.splice(grids_cache_.begin(), grids_cache_, iter->second);
-            grids_map_[key] = grids_cache_.begin();
-        }
+    for (size_t i = 0; i < points_to_add.size(); i++) {
+        InsertPoint(points_to_add[i]);
     }
 }
 
 template <int dim, IVoxNodeType node_type, typename PointType>
 void IVox<dim, node_type, PointType>::AddPoints(std::vector<Eigen::Vector3d>& points_to_add) {
-    for(size_t i = 0; i<points_to_add.size(); i++) {
+    for (size_t i = 0; i < points_to_add.size(); i++) {
         PointType pt;
         pt.x = points_to_add[i].x();
         pt.y = points_to_add[i].y();
         pt.z = points_to_add[i].z();
-        auto key = Pos2Grid(Eigen::Matrix<float, dim, 1>(pt.x, pt.y, pt.z));
+        InsertPoint(pt);
+    }
+}
+
+template <int dim, IVoxNodeType node_type, typename PointType>
+void IVox<dim, node_type, PointType>::AddPointsToNewGrids(const PointVector& points_to_add) {
+    std::unordered_set<KeyType, hash_vec<dim>> new_grids;
+    for (const auto& pt : points_to_add) {
+        auto key = Pos2Grid(ToEigen<float, dim>(pt));
+        if (new_grids.count(key) == 0) {
+            if (FindNode(key) != nullptr) {
+                continue;
+            }
+            new_grids.insert(key);
+        }
+        InsertPoint(pt);
+    }
+}
+
+template <int dim, IVoxNodeType node_type, typename PointType>
+typename IVox<dim, node_type, PointType>::NodeType* IVox<dim, node_type, PointType>::FindNode(const KeyType& key) {
+    if (!options_.copy_on_write_) {
         auto iter = grids_map_.find(key);
-        if (iter == grids_map_.end()) {
-            PointType center;
-            center.getVector3fMap() = key.template cast<float>() * options_.resolution_;
+        return iter == grids_map_.end() ? nullptr : &iter->second->second;
+    }
+
+    // FreezeDelta keeps at most kMaxCowLayers layers, so this probes at most kMaxCowLayers + 1 tables
+    auto iter = cow_delta_.find(key);
+    if (iter != cow_delta_.end()) {
+        return iter->second.node.get();
+    }
+    for (auto layer = cow_layers_.rbegin(); layer != cow_layers_.rend(); ++layer) {
+        auto layer_iter = (*layer)->find(key);
+        if (layer_iter != (*layer)->end()) {
+            return layer_iter->second.node.get();
+        }
+    }
+    return nullptr;
+}
+
+template <int dim, IVoxNodeType node_type, typename PointType>
+void IVox<dim, node_type, PointType>::InsertPoint(const PointType& pt) {
+    auto key = Pos2Grid(Eigen::Matrix<float, dim, 1>(pt.x, pt.y, pt.z));
+
+    if (options_.copy_on_write_) {
+        auto iter = cow_delta_.find(key);
+        if (iter == cow_delta_.end()) {
+            // copy the shared voxel on its first write, the frozen layers are never modified
+            NodeType* shared = FindNode(key);
+            if (shared == nullptr && cow_num_grids_ + 1 >= options_.capacity_) {
+                EvictCowGrids();
+                shared = FindNode(key);
+            }
+            NodePtr node;
+            if (shared != nullptr) {
+                node = std::allocate_shared<NodeType>(Eigen::aligned_allocator<NodeType>(), *shared);
+            } else {
+                PointType center;
+                center.getVector3fMap() = key.template cast<float>() * options_.resolution_;
+                node = std::allocate_shared<NodeType>(Eigen::aligned_allocator<NodeType>(), center,
+                                                      options_.resolution_);
+                cow_num_grids_++;
+            }
+            iter = cow_delta_.emplace(key, CowGrid{std::move(node), 0}).first;
+        }
+        iter->second.stamp = ++cow_stamp_;
+        iter->second.node->InsertPoint(pt);
+        return;
+    }
 
-            grids_cache_.push_front({key, NodeType(center, options_.resolution_)});
-            grids_map_.insert({key, grids_cache_.begin()});
+    auto iter = grids_map_.find(key);
+    if (iter == grids_map_.end()) {
+        PointType center;
+        center.getVector3fMap() = key.template cast<float>() * options_.resolution_;
 
-            grids_cache_.front().second.InsertPoint(pt);
+        grids_cache_.push_front({key, NodeType(center, options_.resolution_)});
+        grids_map_.insert({key, grids_cache_.begin()});
 
-            if (grids_map_.size() >= options_.capacity_) {
-                grids_map_.erase(grids_cache_.back().first);
-                grids_cache_.pop_back();
+        grids_cache_.front().second.InsertPoint(pt);
+
+        if (grids_map_.size() >= options_.capacity_) {
+            grids_map_.erase(grids_cache_.back().first);
+            grids_cache_.pop_back();
+        }
+    } else {
+        iter->second->second.InsertPoint(pt);
+        grids_cache_.splice(grids_cache_.begin(), grids_cache_, iter->second);
+        grids_map_[key] = grids_cache_.begin();
+    }
+}
+
+template <int dim, IVoxNodeType node_type, typename PointType>
+void IVox<dim, node_type, PointType>::FreezeDelta() {
+    if (cow_delta_.empty()) {
+        return;
+    }
+    cow_layers_.emplace_back(std::make_shared<const GridLayer>(std::move(cow_delta_)));
+    cow_delta_ = GridLayer();
+
+    // merge the newest layers while they are too many or of similar size, so a lookup probes only a few tables
+    // and the large base layer is rebuilt only after the layers above it have grown to half of its size
+    while (cow_layers_.size() > 1) {
+        const auto& upper = cow_layers_[cow_layers_.size() - 1];
+        const auto& lower = cow_layers_[cow_layers_.size() - 2];
+        if (cow_layers_.size() <= kMaxCowLayers && upper->size() * 2 < lower->size()) {
+            break;
+        }
+        auto merged = std::make_shared<GridLayer>(*lower);
+        for (const auto& grid : *upper) {
+            (*merged)[grid.first] = grid.second;
+        }
+        cow_layers_.pop_back();
+        cow_layers_.back() = std::move(merged);
+    }
+}
+
+template <int dim, IVoxNodeType node_type, typename PointType>
+void IVox<dim, node_type, PointType>::EvictCowGrids() {
+    // the newest version of every voxel, delta first, the nodes are shared with the layers and snapshots
+    GridLayer grids;
+    grids.reserve(cow_num_grids_);
+    grids.insert(cow_delta_.begin(), cow_delta_.end());
+    for (auto layer = cow_layers_.rbegin(); layer != cow_layers_.rend(); ++layer) {
+        grids.insert((*layer)->begin(), (*layer)->end());
+    }
+
+    const size_t num_keep = std::max<size_t>(options_.capacity_ - options_.capacity_ / 8, 1);
+    if (grids.size() > num_keep) {
+        std::vector<std::pair<uint64_t, KeyType>> stamps;
+        stamps.reserve(grids.size());
+        for (const auto& grid : grids) {
+            stamps.emplace_back(grid.second.stamp, grid.first);
+        }
+        const size_t num_evict = grids.size() - num_keep;
+        std::nth_element(stamps.begin(), stamps.begin() + num_evict - 1, stamps.end(),
+                         [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (size_t i = 0; i < num_evict; ++i) {
+            grids.erase(stamps[i].second);
+        }
+    }
+
+    // the written voxels become shared like on a snapshot, their next write copies them
+    cow_num_grids_ = grids.size();
+    cow_layers_.assign(1, std::make_shared<const GridLayer>(std::move(grids)));
+    cow_delta_.clear();
+}
+
+template <int dim, IVoxNodeType node_type, typename PointType>
+void IVox<dim, node_type, PointType>::SnapshotFrom(IVox& other) {
+    if (&other == this) {
+        return;
+    }
+    if (!options_.copy_on_write_ || !other.options_.copy_on_write_) {
+        // deep copy, the map iterators must point into our own cache
+        grids_cache_ = other.grids_cache_;
+        grids_map_.clear();
+        for (auto iter = grids_cache_.begin(); iter != grids_cache_.end(); ++iter) {
+            grids_map_.insert({iter->first, iter});
+        }
+        return;
+    }
+
+    other.FreezeDelta();
+    cow_layers_ = other.cow_layers_;
+    cow_delta_.clear();
+    cow_num_grids_ = other.cow_num_grids_;
+    cow_stamp_ = other.cow_stamp_;
+}
+
+template <int dim, IVoxNodeType node_type, typename PointType>
+template <typename Func>
+void IVox<dim, node_type, PointType>::ForEachGrid(Func func) const {
+    if (!options_.copy_on_write_) {
+        for (const auto& grid : grids_cache_) {
+            func(grid.first, grid.second);
+        }
+        return;
+    }
+
+    // a voxel of a newer layer hides the same voxel of the older ones
+    std::unordered_set<KeyType, hash_vec<dim>> visited;
+    for (const auto& grid : cow_delta_) {
+        visited.insert(grid.first);
+        func(grid.first, *grid.second.node);
+    }
+    for (auto layer = cow_layers_.rbegin(); layer != cow_layers_.rend(); ++layer) {
+        for (const auto& grid : **layer) {
+            if (visited.insert(grid.first).second) {
+                func(grid.first, *grid.second.node);
+            }
+        }
+    }
+}
+
+template <int dim, IVoxNodeType node_type, typename PointType>
+void IVox<dim, node_type, PointType>::Compact() {
+    static_assert(dim == 3, "morton order of 3d voxel keys");
+    std::vector<std::pair<uint64_t, std::pair<KeyType, const NodeType*>>> grids;
+    grids.reserve(NumValidGrids());
+    ForEachGrid([&grids](const KeyType& key, const NodeType& node) {
+        grids.push_back({morton_code(key), {key, &node}});
+    });
+    std::sort(grids.begin(), grids.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    if (!options_.copy_on_write_) {
+        // the copies allocate the voxels and their points in order, the old cache is released at the end
+        std::list<std::pair<KeyType, NodeType>> cache;
+        for (const auto& grid : grids) {
+            cache.emplace_back(grid.second.first, *grid.second.second);
+        }
+        grids_cache_.swap(cache);
+        grids_map_.clear();
+        grids_map_.reserve(grids_cache_.size());
+        for (auto iter = grids_cache_.begin(); iter != grids_cache_.end(); ++iter) {
+            grids_map_.insert({iter->first, iter});
+        }
+        return;
+    }
+
+    // the copies count as written before any later write
+    auto layer = std::make_shared<GridLayer>();
+    layer->reserve(grids.size());
+    for (const auto& grid : grids) {
+        layer->emplace(grid.second.first,
+                       CowGrid{std::allocate_shared<NodeType>(Eigen::aligned_allocator<NodeType>(), *grid.second.second),
+                               0});
+    }
+    cow_layers_.assign(1, std::move(layer));
+    cow_delta_.clear();
+    cow_num_grids_ = grids.size();
+}
+
+template <int dim, IVoxNodeType node_type, typename PointType>
+template <typename Pred>
+size_t IVox<dim, node_type, PointType>::RemoveGridsIf(Pred pred) {
+    auto remove = [this, &pred](const KeyType& key) {
+        const PtType box_min = key.template cast<float>() * options_.resolution_;
+        return pred(box_min, PtType(box_min.array() + options_.resolution_));
+    };
+
+    if (!options_.copy_on_write_) {
+        size_t num_removed = 0;
+        for (auto iter = grids_cache_.begin(); iter != grids_cache_.end();) {
+            if (remove(iter->first)) {
+                grids_map_.erase(iter->first);
+                iter = grids_cache_.erase(iter);
+                num_removed++;
+            } else {
+                ++iter;
             }
+        }
+        return num_removed;
+    }
+
+    // a voxel of a newer layer hides the same voxel of the older ones, the kept voxels are shared, not copied
+    const size_t num_grids = cow_num_grids_;
+    auto layer = std::make_shared<GridLayer>();
+    std::unordered_set<KeyType, hash_vec<dim>> visited;
+    auto gather = [&](const GridLayer& grids) {
+        for (const auto& grid : grids) {
+            if (visited.insert(grid.first).second && !remove(grid.first)) {
+                layer->insert(grid);
+            }
+        }
+    };
+    gather(cow_delta_);
+    for (auto iter = cow_layers_.rbegin(); iter != cow_layers_.rend(); ++iter) {
+        gather(**iter);
+    }
+    cow_num_grids_ = layer->size();
+    cow_layers_.assign(1, std::move(layer));
+    cow_delta_.clear();
+    return num_grids - cow_num_grids_;
+}
+
+template <int dim, IVoxNodeType node_type, typename PointType>
+bool IVox<dim, node_type, PointType>::Save(const std::string& path, uint64_t source_size, int64_t source_mtime) const {
+    IVoxSnapshotData data;
+    ForEachGrid([&data](const KeyType& key, const NodeType& node) {
+        data.AddGrid(key, node.Size());
+        for (std::size_t i = 0; i < node.Size(); ++i) {
+            const PointType pt = node.GetPoint(i);
+            data.AddPoint(pt.x, pt.y, pt.z);
+        }
+    });
+    return WriteIVoxSnapshot(path, dim, options_.resolution_, source_size, source_mtime, data);
+}
+
+template <int dim, IVoxNodeType node_type, typename PointType>
+bool IVox<dim, node_type, PointType>::Load(const std::string& path, uint64_t source_size, int64_t source_mtime) {
+    IVoxSnapshot snapshot(path, dim, options_.resolution_, source_size, source_mtime);
+    if (!snapshot.Valid()) {
+        return false;
+    }
+
+    grids_map_.clear();
+    grids_cache_.clear();
+    cow_layers_.clear();
+    cow_delta_.clear();
+    cow_num_grids_ = 0;
+
+    // the snapshot holds distinct voxels of distinct points, so neither the voxels nor the points are looked up
+    const std::size_t num_grids = std::min(snapshot.NumGrids(), options_.capacity_ - 1);
+    if (options_.copy_on_write_) {
+        cow_delta_.reserve(num_grids);
+    } else {
+        grids_map_.reserve(num_grids);
+    }
+    const float* points = snapshot.Points();
+    for (std::size_t i = 0; i < num_grids; ++i) {
+        const IVoxSnapshotGrid& grid = snapshot.Grids()[i];
+        const KeyType key(grid.key[0], grid.key[1], grid.key[2]);
+        PointType center;
+        center.getVector3fMap() = key.template cast<float>() * options_.resolution_;
+
+        NodeType* node;
+        if (options_.copy_on_write_) {
+            auto shared = std::allocate_shared<NodeType>(Eigen::aligned_allocator<NodeType>(), center,
+                                                         options_.resolution_);
+            node = shared.get();
+            cow_delta_.emplace(key, CowGrid{std::move(shared), 0});
+            cow_num_grids_++;
         } else {
-            iter->second->second.InsertPoint(pt);
-            grids_cache_.splice(grids_cache_.begin(), grids_cache_, iter->second);
-            grids_map_[key] = grids_cache_.begin();
+            grids_cache_.push_back({key, NodeType(center, options_.resolution_)});
+            grids_map_.insert({key, std::prev(grids_cache_.end())});
+            node = &grids_cache_.back().second;
+        }
+
+        node->Reserve(grid.num_points);
+        for (uint32_t j = 0; j < grid.num_points; ++j, points += 3) {
+            PointType pt;
+            pt.x = points[0];
+            pt.y = points[1];
+            pt.z = points[2];
+            node->AppendPoint(pt);
         }
     }
+    return true;
 }
 
 template <int dim, IVoxNodeType node_type, typename PointType>
@@ -327,15 +765,35 @@ Eigen::Matrix<int, dim, 1> IVox<dim, node_type, PointType>::Pos2Grid_(const IVox
 
 template <int dim, IVoxNodeType node_type, typename PointType>
 std::vector<float> IVox<dim, node_type, PointType>::StatGridPoints() const {
-    int num = grids_cache_.size(), valid_num = 0, max = 0, min = 100000000;
+    int num = 0, valid_num = 0, max = 0, min = 100000000;
     int sum = 0, sum_square = 0;
-    for (auto& it : grids_cache_) {
-        int s = it.second.Size();
+    auto stat = [&](const NodeType& node) {
+        int s = node.Size();
+        num++;
         valid_num += s > 0;
         max = s > max ? s : max;
         min = s < min ? s : min;
         sum += s;
         sum_square += s * s;
+    };
+    if (options_.copy_on_write_) {
+        // visit every voxel once, the newest version wins
+        GridLayer visited;
+        for (const auto& grid : cow_delta_) {
+            visited.insert(grid);
+        }
+        for (auto layer = cow_layers_.rbegin(); layer != cow_layers_.rend(); ++layer) {
+            for (const auto& grid : **layer) {
+                visited.insert(grid);
+            }
+        }
+        for (const auto& grid : visited) {
+            stat(*grid.second.node);
+        }
+    } else {
+        for (auto& it : grids_cache_) {
+            stat(it.second);
+        }
     }
     float ave = float(sum) / num;
     float stddev = num > 1 ? sqrt((float(sum_square) - num * ave * ave) / (num - 1)) : 0;
@@ -344,4 +802,6 @@ std::vector<float> IVox<dim, node_type, PointType>::StatGridPoints() const {
 
 }  // namespace faster_lio
 
+#include "ivox3d_flat.h"
+
 #endif
@@ -0,0 +1,696 @@
+//
+// Flat storage backend of ivox, selected by IVoxNodeType::FLAT.
+//
+
+#ifndef FASTER_LIO_IVOX3D_FLAT_H
+#define FASTER_LIO_IVOX3D_FLAT_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <unordered_set>
+#include <vector>
+
+namespace faster_lio {
+
+/**
+ * ivox without node objects: the voxels are found in an open addressing (linear probing) hash table keyed by the
+ * voxel index packed into 64 bits, the voxel records live in one array and the points of all voxels in one pool of
+ * xyz floats, each voxel owning a slab of it. The LRU list is intrusive and index based. A neighbor voxel of a
+ * query costs one probe of the table, one voxel record and one contiguous run of points.
+ *
+ * Copy on write is not supported, SnapshotFrom copies the arrays.
+ */
+template <int dim, typename PointType>
+class IVox<dim, IVoxNodeType::FLAT, PointType> {
+   public:
+    using KeyType = Eigen::Matrix<int, dim, 1>;
+    using PtType = Eigen::Matrix<float, dim, 1>;
+    using NodeType = typename IVoxNodeTypeTraits<IVoxNodeType::FLAT, PointType, dim>::NodeType;
+    using PointVector = std::vector<PointType, Eigen::aligned_allocator<PointType>>;
+
+    enum class NearbyType {
+        CENTER,  // center only
+        NEARBY6,
+        NEARBY18,
+        NEARBY26,
+    };
+
+    struct Options {
+        float resolution_ = 0.2;                        // ivox resolution
+        float inv_resolution_ = 10.0;                   // inverse resolution
+        NearbyType nearby_type_ = NearbyType::NEARBY6;  // nearby range
+        std::size_t capacity_ = 1000000;                // capacity
+        bool copy_on_write_ = false;                    // not supported by the flat ivox
+    };
+
+    /// candidate of a knn search, index into the point pool
+    struct DistPoint {
+        float dist = 0;
+        uint32_t idx = 0;
+
+        inline bool operator<(const DistPoint& rhs) const { return dist < rhs.dist; }
+    };
+
+    explicit IVox(Options options) : options_(options) {
+        options_.inv_resolution_ = 1.0 / options_.resolution_;
+        if (options_.copy_on_write_) {
+            LOG(WARNING) << "copy on write is not supported by the flat ivox, disabled.";
+            options_.copy_on_write_ = false;
+        }
+        GenerateNearbyGrids();
+        Rehash(kMinTableSize);
+    }
+
+    /// add points
+    void AddPoints(const PointVector& points_to_add);
+
+    void AddPoints(std::vector<Eigen::Vector3d>& points_to_add);
+
+    /// add points only into voxels that do not exist yet
+    void AddPointsToNewGrids(const PointVector& points_to_add);
+
+    /// whether the voxel of a point exists
+    bool HasGrid(const PointType& pt) const { return FindNode(PackKey(Pos2Grid(ToEigen<float, dim>(pt)))) >= 0; }
+
+    /// get nn
+    bool GetClosestPoint(const PointType& pt, PointType& closest_pt);
+
+    /// get nn with condition
+    bool GetClosestPoint(const PointType& pt, PointVector& closest_pt, int max_num = 5, double max_range = 5.0);
+
+    /// get nn in cloud
+    bool GetClosestPoint(const PointVector& cloud, PointVector& closest_cloud);
+
+    /**
+     * knn of num points at once, see the default ivox. The table slots of the voxels around the next point are
+     * prefetched before the current point is searched.
+     */
+    void GetClosestPoints(const PointType* pts, size_t num, PointType* neighbours, int* num_neighbours,
+                          int max_num = 5, double max_range = 5.0);
+
+    /// get number of points
+    size_t NumPoints() const;
+
+    /// get number of valid grids
+    size_t NumValidGrids() const { return num_nodes_; }
+
+    /// get statistics of the points
+    std::vector<float> StatGridPoints() const;
+
+    /// copy the voxels of another ivox
+    void SnapshotFrom(IVox& other);
+
+    /// always 0, there is no copy on write
+    size_t NumDirtyGrids() const { return 0; }
+
+    /// renumber the voxels and move their slabs in morton order of the voxel keys, see the default ivox
+    void Compact();
+
+    /// remove the voxels for which pred(box_min, box_max) is true, see the default ivox
+    template <typename Pred>
+    size_t RemoveGridsIf(Pred pred);
+
+    /// write the voxels into a snapshot file, see ivox3d_snapshot.h
+    bool Save(const std::string& path, uint64_t source_size, int64_t source_mtime) const;
+
+    /// replace the voxels by those of a snapshot, the pool and the table are filled in one pass
+    bool Load(const std::string& path, uint64_t source_size, int64_t source_mtime);
+
+    KeyType Pos2Grid(const PtType& pt) const;
+    KeyType Pos2Grid_(const PtType& pt, const double& defined_res) const;
+
+   private:
+    static_assert(dim == 3, "the flat ivox packs 3d voxel keys");
+
+    static constexpr uint64_t kEmptyKey = std::numeric_limits<uint64_t>::max();
+    static constexpr int kKeyBits = 21;  // bits per axis of a packed key
+    static constexpr int64_t kKeyOffset = int64_t(1) << (kKeyBits - 1);
+    static constexpr size_t kMinTableSize = 1024;
+    static constexpr float kMinPointDist2 = 0.2 * 0.2;  // same rule as IVoxNode::InsertPoint
+
+    struct Slot {
+        uint64_t key = kEmptyKey;
+        int32_t node = -1;
+    };
+
+    void GenerateNearbyGrids();
+
+    /// pack a voxel index into 64 bits, the neighbors of a packed key are found by adding packed offsets
+    static uint64_t PackKey(const KeyType& key) {
+        return uint64_t(key[0] + kKeyOffset) | (uint64_t(key[1] + kKeyOffset) << kKeyBits) |
+               (uint64_t(key[2] + kKeyOffset) << (2 * kKeyBits));
+    }
+
+    static KeyType UnpackKey(uint64_t key) {
+        const uint64_t mask = (uint64_t(1) << kKeyBits) - 1;
+        return KeyType(int64_t(key & mask) - kKeyOffset, int64_t((key >> kKeyBits) & mask) - kKeyOffset,
+                       int64_t((key >> (2 * kKeyBits)) & mask) - kKeyOffset);
+    }
+
+    static size_t HashKey(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return size_t(key);
+    }
+
+    /// index of the voxel of a packed key, -1 if not exist
+    inline int32_t FindNode(uint64_t key) const;
+
+    void InsertPoint(const PointType& pt);
+
+    int32_t NewNode(uint64_t key);
+    void EraseNode(int32_t idx);
+
+    void TableInsert(uint64_t key, int32_t node);
+    void TableErase(uint64_t key);
+    void Rehash(size_t table_size);
+
+    uint32_t AllocSlab(uint32_t slab_class);
+
+    void LruUnlink(int32_t idx);
+    void LruPushFront(int32_t idx);
+
+    /// search the voxels around a point, keeps the max_num nearest sorted in candidates
+    void SearchKnn(const PointType& pt, int max_num, float max_range2, std::vector<DistPoint>& candidates) const;
+
+    Options options_;
+    std::vector<int64_t> nearby_offsets_;  // packed offsets of the nearby voxels
+
+    std::vector<Slot> table_;  // open addressing, power of two size
+    size_t num_nodes_ = 0;
+
+    std::vector<NodeType> nodes_;
+    std::vector<int32_t> free_nodes_;
+    int32_t lru_head_ = -1;  // most recently written
+    int32_t lru_tail_ = -1;
+
+    std::vector<FlatPoint> pool_;
+    std::vector<std::vector<uint32_t>> free_slabs_;  // released slabs per class
+};
+
+template <int dim, typename PointType>
+void IVox<dim, IVoxNodeType::FLAT, PointType>::GenerateNearbyGrids() {
+    std::vector<KeyType> nearby_grids;
+    if (options_.nearby_type_ == NearbyType::CENTER) {
+        nearby_grids.emplace_back(KeyType::Zero());
+    } else {
+        // same order as the default ivox: center, faces, edges, corners
+        const int max_dist = options_.nearby_type_ == NearbyType::NEARBY6    ? 1
+                             : options_.nearby_type_ == NearbyType::NEARBY18 ? 2
+                                                                              : 3;
+        for (int dist = 0; dist <= max_dist; ++dist) {
+            for (int x = -1; x <= 1; ++x) {
+                for (int y = -1; y <= 1; ++y) {
+                    for (int z = -1; z <= 1; ++z) {
+                        if (std::abs(x) + std::abs(y) + std::abs(z) == dist) {
+                            nearby_grids.emplace_back(x, y, z);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    nearby_offsets_.clear();
+    for (const auto& delta : nearby_grids) {
+        nearby_offsets_.push_back(int64_t(delta[0]) + int64_t(delta[1]) * (int64_t(1) << kKeyBits) +
+                                  int64_t(delta[2]) * (int64_t(1) << (2 * kKeyBits)));
+    }
+}
+
+template <int dim, typename PointType>
+int32_t IVox<dim, IVoxNodeType::FLAT, PointType>::FindNode(uint64_t key) const {
+    const size_t mask = table_.size() - 1;
+    for (size_t i = HashKey(key) & mask;; i = (i + 1) & mask) {
+        const Slot& slot = table_[i];
+        if (slot.key == key) {
+            return slot.node;
+        }
+        if (slot.key == kEmptyKey) {
+            return -1;
+        }
+    }
+}
+
+template <int dim, typename PointType>
+void IVox<dim, IVoxNodeType::FLAT, PointType>::TableInsert(uint64_t key, int32_t node) {
+    if ((num_nodes_ + 1) * 2 > table_.size()) {
+        Rehash(table_.size() * 2);
+    }
+    const size_t mask = table_.size() - 1;
+    size_t i = HashKey(key) & mask;
+    while (table_[i].key != kEmptyKey) {
+        i = (i + 1) & mask;
+    }
+    table_[i].key = key;
+    table_[i].node = node;
+    num_nodes_++;
+}
+
+template <int dim, typename PointType>
+void IVox<dim, IVoxNodeType::FLAT, PointType>::TableErase(uint64_t key) {
+    const size_t mask = table_.size() - 1;
+    size_t i = HashKey(key) & mask;
+    while (table_[i].key != key) {
+        if (table_[i].key == kEmptyKey) {
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+    num_nodes_--;
+
+    // backward shift deletion, keeps the probe sequences intact without tombstones
+    for (size_t j = (i + 1) & mask; table_[j].key != kEmptyKey; j = (j + 1) & mask) {
+        const size_t home = HashKey(table_[j].key) & mask;
+        // the entry at j stays if its home is cyclically in (i, j]
+        const bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (!stays) {
+            table_[i] = table_[j];
+            i = j;
+        }
+    }
+    table_[i] = Slot();
+}
+
+template <int dim, typename PointType>
+void IVox<dim, IVoxNodeType::FLAT, PointType>::Rehash(size_t table_size) {
+    std::vector<Slot> old_table(table_size);
+    old_table.swap(table_);
+    const size_t mask = table_.size() - 1;
+    for (const auto& slot : old_table) {
+        if (slot.key == kEmptyKey) {
+            continue;
+        }
+        size_t i = HashKey(slot.key) & mask;
+        while (table_[i].key != kEmptyKey) {
+            i = (i + 1) & mask;
+        }
+        table_[i] = slot;
+    }
+}
+
+template <int dim, typename PointType>
+uint32_t IVox<dim, IVoxNodeType::FLAT, PointType>::AllocSlab(uint32_t slab_class) {
+    if (free_slabs_.size() <= slab_class) {
+        free_slabs_.resize(slab_class + 1);
+    }
+    auto& free_list = free_slabs_[slab_class];
+    if (!free_list.empty()) {
+        uint32_t begin = free_list.back();
+        free_list.pop_back();
+        return begin;
+    }
+    uint32_t begin = pool_.size();
+    pool_.resize(pool_.size() + (NodeType::kMinSlab << slab_class));
+    return begin;
+}
+
+template <int dim, typename PointType>
+void IVox<dim, IVoxNodeType::FLAT, PointType>::LruUnlink(int32_t idx) {
+    NodeType& node = nodes_[idx];
+    (node.prev >= 0 ? nodes_[node.prev].next : lru_head_) = node.next;
+    (node.next >= 0 ? nodes_[node.next].prev : lru_tail_) = node.prev;
+    node.prev = node.next = -1;
+}
+
+template <int dim, typename PointType>
+void IVox<dim, IVoxNodeType::FLAT, PointType>::LruPushFront(int32_t idx) {
+    NodeType& node = nodes_[idx];
+    node.prev = -1;
+    node.next = lru_head_;
+    (lru_head_ >= 0 ? nodes_[lru_head_].prev : lru_tail_) = idx;
+    lru_head_ = idx;
+}
+
+template <int dim, typename PointType>
+int32_t IVox<dim, IVoxNodeType::FLAT, PointType>::NewNode(uint64_t key) {
+    int32_t idx;
+    if (!free_nodes_.empty()) {
+        idx = free_nodes_.back();
+        free_nodes_.pop_back();
+    } else {
+        idx = nodes_.size();
+        nodes_.emplace_back();
+    }
+    NodeType& node = nodes_[idx];
+    node.key = key;
+    node.size = 0;
+    node.slab_class = 0;
+    node.begin = AllocSlab(0);
+    TableInsert(key, idx);
+    LruPushFront(idx);
+    return idx;
+}
+
+template <int dim, typename PointType>
+void IVox<dim, IVoxNodeType::FLAT, PointType>::EraseNode(int32_t idx) {
+    NodeType& node = nodes_[idx];
+    TableErase(node.key);
+    LruUnlink(idx);
+    free_slabs_[node.slab_class].push_back(node.begin);
+    free_nodes_.push_back(idx);
+}
+
+template <int dim, typename PointType>
+void IVox<dim, IVoxNodeType::FLAT, PointType>::InsertPoint(const PointType& pt) {
+    const uint64_t key = PackKey(Pos2Grid(PtType(pt.x, pt.y, pt.z)));
+    int32_t idx = FindNode(key);
+    if (idx < 0) {
+        idx = NewNode(key);
+        if (num_nodes_ >= options_.capacity_) {
+            EraseNode(lru_tail_);
+        }
+    } else if (idx != lru_head_) {
+        LruUnlink(idx);
+        LruPushFront(idx);
+    }
+
+    NodeType& node = nodes_[idx];
+    for (uint32_t i = node.begin; i < node.begin + node.size; ++i) {
+        const float dx = pool_[i].x - pt.x, dy = pool_[i].y - pt.y, dz = pool_[i].z - pt.z;
+        if (dx * dx + dy * dy + dz * dz < kMinPointDist2) {
+            return;
+        }
+    }
+
+    if (node.size == node.Capacity()) {
+        // move the points to a slab of twice the size
+        const uint32_t begin = AllocSlab(node.slab_class + 1);
+        std::copy(pool_.begin() + node.begin, pool_.begin() + node.begin + node.size, pool_.begin() + begin);
+        free_slabs_[node.slab_class].push_back(node.begin);
+        node.begin = begin;
+        node.slab_class++;
+    }
+    pool_[node.begin + node.size++] = FlatPoint{pt.x, pt.y, pt.z};
+}
+
+template <int dim, typename PointType>
+void IVox<dim, IVoxNodeType::FLAT, PointType>::AddPoints(const PointVector& points_to_add) {
+    for (const auto& pt : points_to_add) {
+        InsertPoint(pt);
+    }
+}
+
+template <int dim, typename PointType>
+void IVox<dim, IVoxNodeType::FLAT, PointType>::AddPoints(std::vector<Eigen::Vector3d>& points_to_add) {
+    for (const auto& p : points_to_add) {
+        PointType pt;
+        pt.x = p.x();
+        pt.y = p.y();
+        pt.z = p.z();
+        InsertPoint(pt);
+    }
+}
+
+template <int dim, typename PointType>
+void IVox<dim, IVoxNodeType::FLAT, PointType>::AddPointsToNewGrids(const PointVector& points_to_add) {
+    std::unordered_set<uint64_t> new_grids;
+    for (const auto& pt : points_to_add) {
+        const uint64_t key = PackKey(Pos2Grid(ToEigen<float, dim>(pt)));
+        if (new_grids.count(key) == 0) {
+            if (FindNode(key) >= 0) {
+                continue;
+            }
+            new_grids.insert(key);
+        }
+        InsertPoint(pt);
+    }
+}
+
+template <int dim, typename PointType>
+void IVox<dim, IVoxNodeType::FLAT, PointType>::SearchKnn(const PointType& pt, int max_num, float max_range2,
+                                                         std::vector<DistPoint>& candidates) const {
+    candidates.clear();
+    const uint64_t key = PackKey(Pos2Grid(ToEigen<float, dim>(pt)));
+    for (const int64_t offset : nearby_offsets_) {
+        const int32_t idx = FindNode(key + offset);
+        if (idx < 0) {
+            continue;
+        }
+        const NodeType& node = nodes_[idx];
+        for (uint32_t i = node.begin; i < node.begin + node.size; ++i) {
+            const float dx = pool_[i].x - pt.x, dy = pool_[i].y - pt.y, dz = pool_[i].z - pt.z;
+            const float d = dx * dx + dy * dy + dz * dz;
+            if (d >= max_range2 || (candidates.size() == size_t(max_num) && d >= candidates.back().dist)) {
+                continue;
+            }
+            // insertion into the sorted candidates, max_num is small
+            if (candidates.size() < size_t(max_num)) {
+                candidates.emplace_back();
+            }
+            size_t j = candidates.size() - 1;
+            for (; j > 0 && candidates[j - 1].dist > d; --j) {
+                candidates[j] = candidates[j - 1];
+            }
+            candidates[j].dist = d;
+            candidates[j].idx = i;
+        }
+    }
+}
+
+template <int dim, typename PointType>
+bool IVox<dim, IVoxNodeType::FLAT, PointType>::GetClosestPoint(const PointType& pt, PointType& closest_pt) {
+    thread_local std::vector<DistPoint> candidates;
+    SearchKnn(pt, 1, std::numeric_limits<float>::max(), candidates);
+    if (candidates.empty()) {
+        return false;
+    }
+    const FlatPoint& p = pool_[candidates.front().idx];
+    closest_pt.x = p.x;
+    closest_pt.y = p.y;
+    closest_pt.z = p.z;
+    return true;
+}
+
+template <int dim, typename PointType>
+bool IVox<dim, IVoxNodeType::FLAT, PointType>::GetClosestPoint(const PointType& pt, PointVector& closest_pt,
+                                                               int max_num, double max_range) {
+    thread_local std::vector<DistPoint> candidates;
+    SearchKnn(pt, max_num, max_range * max_range, candidates);
+
+    closest_pt.clear();
+    for (const auto& candidate : candidates) {
+        const FlatPoint& p = pool_[candidate.idx];
+        PointType point;
+        point.x = p.x;
+        point.y = p.y;
+        point.z = p.z;
+        closest_pt.emplace_back(point);
+    }
+    return closest_pt.empty() == false;
+}
+
+template <int dim, typename PointType>
+bool IVox<dim, IVoxNodeType::FLAT, PointType>::GetClosestPoint(const PointVector& cloud, PointVector& closest_cloud) {
+    closest_cloud.resize(cloud.size());
+    for (size_t i = 0; i < cloud.size(); ++i) {
+        PointType pt;
+        if (GetClosestPoint(cloud[i], pt)) {
+            closest_cloud[i] = pt;
+        } else {
+            closest_cloud[i] = PointType();
+        }
+    }
+    return true;
+}
+
+template <int dim, typename PointType>
+void IVox<dim, IVoxNodeType::FLAT, PointType>::GetClosestPoints(const PointType* pts, size_t num, PointType* neighbours,
+                                                                int* num_neighbours, int max_num, double max_range) {
+    thread_local std::vector<DistPoint> candidates;
+    const size_t mask = table_.size() - 1;
+    for (size_t i = 0; i < num; ++i) {
+        if (i + 1 < num) {
+            const uint64_t next_key = PackKey(Pos2Grid(ToEigen<float, dim>(pts[i + 1])));
+            for (const int64_t offset : nearby_offsets_) {
+                __builtin_prefetch(&table_[HashKey(next_key + offset) & mask]);
+            }
+        }
+
+        SearchKnn(pts[i], max_num, max_range * max_range, candidates);
+        PointType* out = neighbours + i * max_num;
+        for (size_t j = 0; j < candidates.size(); ++j) {
+            const FlatPoint& p = pool_[candidates[j].idx];
+            PointType point;
+            point.x = p.x;
+            point.y = p.y;
+            point.z = p.z;
+            out[j] = point;
+        }
+        num_neighbours[i] = candidates.size();
+    }
+}
+
+template <int dim, typename PointType>
+void IVox<dim, IVoxNodeType::FLAT, PointType>::Compact() {
+    std::vector<std::pair<uint64_t, int32_t>> order;
+    order.reserve(num_nodes_);
+    for (int32_t idx = lru_head_; idx >= 0; idx = nodes_[idx].next) {
+        order.emplace_back(morton_code(UnpackKey(nodes_[idx].key)), idx);
+    }
+    std::sort(order.begin(), order.end());
+
+    // the slabs keep their size class, the free lists start empty
+    std::vector<NodeType> nodes(order.size());
+    std::vector<FlatPoint> pool;
+    pool.reserve(pool_.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        const NodeType& old = nodes_[order[i].second];
+        NodeType& node = nodes[i];
+        node = old;
+        node.begin = pool.size();
+        node.prev = int32_t(i) - 1;
+        node.next = i + 1 < order.size() ? int32_t(i) + 1 : -1;
+        pool.insert(pool.end(), pool_.begin() + old.begin, pool_.begin() + old.begin + old.Capacity());
+    }
+    nodes_.swap(nodes);
+    pool_.swap(pool);
+    free_nodes_.clear();
+    free_slabs_.clear();
+    lru_head_ = nodes_.empty() ? -1 : 0;
+    lru_tail_ = int32_t(nodes_.size()) - 1;
+
+    std::fill(table_.begin(), table_.end(), Slot());
+    num_nodes_ = 0;
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        TableInsert(nodes_[i].key, i);
+    }
+}
+
+template <int dim, typename PointType>
+template <typename Pred>
+size_t IVox<dim, IVoxNodeType::FLAT, PointType>::RemoveGridsIf(Pred pred) {
+    size_t num_removed = 0;
+    for (int32_t idx = lru_head_; idx >= 0;) {
+        const int32_t next = nodes_[idx].next;
+        const PtType box_min = UnpackKey(nodes_[idx].key).template cast<float>() * options_.resolution_;
+        if (pred(box_min, PtType(box_min.array() + options_.resolution_))) {
+            EraseNode(idx);
+            num_removed++;
+        }
+        idx = next;
+    }
+    return num_removed;
+}
+
+template <int dim, typename PointType>
+size_t IVox<dim, IVoxNodeType::FLAT, PointType>::NumPoints() const {
+    size_t num = 0;
+    for (int32_t idx = lru_head_; idx >= 0; idx = nodes_[idx].next) {
+        num += nodes_[idx].size;
+    }
+    return num;
+}
+
+template <int dim, typename PointType>
+std::vector<float> IVox<dim, IVoxNodeType::FLAT, PointType>::StatGridPoints() const {
+    int num = 0, valid_num = 0, max = 0, min = 100000000;
+    int sum = 0, sum_square = 0;
+    for (int32_t idx = lru_head_; idx >= 0; idx = nodes_[idx].next) {
+        int s = nodes_[idx].size;
+        num++;
+        valid_num += s > 0;
+        max = s > max ? s : max;
+        min = s < min ? s : min;
+        sum += s;
+        sum_square += s * s;
+    }
+    float ave = float(sum) / num;
+    float stddev = num > 1 ? sqrt((float(sum_square) - num * ave * ave) / (num - 1)) : 0;
+    return std::vector<float>{valid_num, ave, max, min, stddev};
+}
+
+template <int dim, typename PointType>
+void IVox<dim, IVoxNodeType::FLAT, PointType>::SnapshotFrom(IVox& other) {
+    if (&other == this) {
+        return;
+    }
+    table_ = other.table_;
+    num_nodes_ = other.num_nodes_;
+    nodes_ = other.nodes_;
+    free_nodes_ = other.free_nodes_;
+    lru_head_ = other.lru_head_;
+    lru_tail_ = other.lru_tail_;
+    pool_ = other.pool_;
+    free_slabs_ = other.free_slabs_;
+}
+
+template <int dim, typename PointType>
+bool IVox<dim, IVoxNodeType::FLAT, PointType>::Save(const std::string& path, uint64_t source_size,
+                                                    int64_t source_mtime) const {
+    IVoxSnapshotData data;
+    for (int32_t idx = lru_head_; idx >= 0; idx = nodes_[idx].next) {
+        const NodeType& node = nodes_[idx];
+        data.AddGrid(UnpackKey(node.key), node.size);
+        for (uint32_t i = node.begin; i < node.begin + node.size; ++i) {
+            data.AddPoint(pool_[i].x, pool_[i].y, pool_[i].z);
+        }
+    }
+    return WriteIVoxSnapshot(path, dim, options_.resolution_, source_size, source_mtime, data);
+}
+
+template <int dim, typename PointType>
+bool IVox<dim, IVoxNodeType::FLAT, PointType>::Load(const std::string& path, uint64_t source_size,
+                                                    int64_t source_mtime) {
+    IVoxSnapshot snapshot(path, dim, options_.resolution_, source_size, source_mtime);
+    if (!snapshot.Valid()) {
+        return false;
+    }
+
+    const size_t num_grids = std::min(snapshot.NumGrids(), options_.capacity_ - 1);
+    const IVoxSnapshotGrid* grids = snapshot.Grids();
+
+    // the smallest slab of each voxel, all slabs in one allocation of the pool
+    nodes_.assign(num_grids, NodeType());
+    size_t pool_size = 0;
+    for (size_t i = 0; i < num_grids; ++i) {
+        NodeType& node = nodes_[i];
+        node.key = PackKey(KeyType(grids[i].key[0], grids[i].key[1], grids[i].key[2]));
+        node.size = grids[i].num_points;
+        while (node.Capacity() < node.size) {
+            node.slab_class++;
+        }
+        node.begin = pool_size;
+        node.prev = int32_t(i) - 1;
+        node.next = i + 1 < num_grids ? int32_t(i) + 1 : -1;
+        pool_size += node.Capacity();
+    }
+    pool_.resize(pool_size);
+    free_nodes_.clear();
+    free_slabs_.clear();
+    lru_head_ = num_grids > 0 ? 0 : -1;
+    lru_tail_ = int32_t(num_grids) - 1;
+
+    size_t table_size = kMinTableSize;
+    while (table_size < 2 * (num_grids + 1)) {
+        table_size *= 2;
+    }
+    table_.assign(table_size, Slot());
+    num_nodes_ = 0;
+
+    const FlatPoint* points = reinterpret_cast<const FlatPoint*>(snapshot.Points());
+    for (size_t i = 0; i < num_grids; ++i) {
+        NodeType& node = nodes_[i];
+        std::copy(points, points + node.size, pool_.begin() + node.begin);
+        points += node.size;
+        TableInsert(node.key, i);
+    }
+    return true;
+}
+
+template <int dim, typename PointType>
+Eigen::Matrix<int, dim, 1> IVox<dim, IVoxNodeType::FLAT, PointType>::Pos2Grid(const PtType& pt) const {
+    return (pt * options_.inv_resolution_).array().floor().template cast<int>();
+}
+
+template <int dim, typename PointType>
+Eigen::Matrix<int, dim, 1> IVox<dim, IVoxNodeType::FLAT, PointType>::Pos2Grid_(const PtType& pt,
+                                                                               const double& defined_res) const {
+    return (pt / defined_res).array().floor().template cast<int>();
+}
+
+}  // namespace faster_lio
+
+#endif
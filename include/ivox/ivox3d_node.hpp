@@ -51,6 +51,14 @@ class IVoxNode {
 
     void InsertPoint(const PointT& pt);
 
+    /// insert a point known to be apart from the others, e.g. of a snapshot
+    void AppendPoint(const PointT& pt) { points_.emplace_back(pt); }
+
+    void Reserve(std::size_t num) { points_.reserve(num); }
+
+    /// start loading the points before they are searched
+    void Prefetch() const { __builtin_prefetch(points_.data()); }
+
     inline bool Empty() const;
 
     inline std::size_t Size() const;
@@ -79,6 +87,12 @@ class IVoxNodePhc {
 
     void InsertPoint(const PointT& pt);
 
+    void AppendPoint(const PointT& pt) { InsertPoint(pt); }
+
+    void Reserve(std::size_t) {}
+
+    void Prefetch() const { __builtin_prefetch(phc_cubes_.data()); }
+
     void ErasePoint(const PointT& pt, const double erase_distance_th_);
 
     inline bool Empty() const;
@@ -106,6 +120,25 @@ class IVoxNodePhc {
     Eigen::Matrix<float, dim, 1> min_cube_;
 };
 
+/// point of the flat ivox, coordinates only
+struct FlatPoint {
+    float x, y, z;
+};
+
+/// voxel of the flat ivox, its points are a slab in the point pool shared by all voxels
+struct IVoxFlatNode {
+    uint64_t key = 0;         // packed voxel key
+    uint32_t begin = 0;       // first point of the slab in the pool
+    uint32_t size = 0;        // number of points
+    uint32_t slab_class = 0;  // the slab holds kMinSlab << slab_class points
+    int32_t prev = -1;        // lru list, -1 at the ends
+    int32_t next = -1;
+
+    static constexpr uint32_t kMinSlab = 4;
+
+    uint32_t Capacity() const { return kMinSlab << slab_class; }
+};
+
 template <typename PointT, int dim>
 struct IVoxNode<PointT, dim>::DistPoint {
     double dist = 0;
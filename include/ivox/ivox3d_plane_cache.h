@@ -0,0 +1,136 @@
+//
+// Planes fitted once per voxel of a static map, used next to the ivox of the localization map.
+//
+
+#ifndef FASTER_LIO_IVOX3D_PLANE_CACHE_H
+#define FASTER_LIO_IVOX3D_PLANE_CACHE_H
+
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+#include "eigen_types.h"
+
+namespace faster_lio {
+
+/**
+ * The prior map of the localization does not change, so the plane a query point is associated with can be fitted
+ * once per voxel instead of a knn search and a plane fit per point and scan. A voxel holding at least min_points
+ * points that span a surface gets the least squares plane of its points, together with its quality, the largest
+ * distance of these points to the plane. Find only returns the planes within max_residual, the other points fall
+ * back to the knn search of the ivox. Voxels which receive new points are dropped by Invalidate.
+ */
+template <typename PointType>
+class IVoxPlaneCache {
+   public:
+    using KeyType = Eigen::Matrix<int, 3, 1>;
+    using PointVector = std::vector<PointType, Eigen::aligned_allocator<PointType>>;
+
+    struct Plane {
+        Eigen::Vector4f abcd;  // abcd.head<3>().dot(p) + abcd(3) = 0, unit normal
+        float residual;        // largest distance of the voxel points to the plane
+    };
+
+    IVoxPlaneCache(float resolution, int min_points, float max_residual)
+        : resolution_(resolution), inv_resolution_(1.0f / resolution), min_points_(min_points),
+          max_residual_(max_residual) {}
+
+    /// fit the planes of all voxels of the points, the existing planes are replaced
+    void Build(const PointVector& points);
+
+    /// drop the planes of the voxels of the points, e.g. after the points were added to the map
+    void Invalidate(const std::vector<Eigen::Vector3d>& points) {
+        for (const auto& pt : points) {
+            planes_.erase(Pos2Grid(pt.cast<float>()));
+        }
+    }
+
+    /// plane of the voxel of a point, nullptr if the voxel has none or it is not flat enough
+    const Plane* Find(const PointType& pt) const {
+        auto iter = planes_.find(Pos2Grid(pt.getVector3fMap()));
+        if (iter == planes_.end() || iter->second.residual > max_residual_) {
+            return nullptr;
+        }
+        return &iter->second;
+    }
+
+    size_t NumPlanes() const { return planes_.size(); }
+
+    /// number of planes within max_residual
+    size_t NumValidPlanes() const {
+        size_t num = 0;
+        for (const auto& it : planes_) {
+            num += it.second.residual <= max_residual_;
+        }
+        return num;
+    }
+
+   private:
+    /// moments of the points of a voxel, relative to the voxel corner
+    struct Moments {
+        int num = 0;
+        Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+        Eigen::Matrix3d sum_sq = Eigen::Matrix3d::Zero();
+    };
+
+    KeyType Pos2Grid(const Eigen::Vector3f& pt) const {
+        return (pt * inv_resolution_).array().floor().template cast<int>();
+    }
+
+    float resolution_;
+    float inv_resolution_;
+    int min_points_;
+    float max_residual_;
+    std::unordered_map<KeyType, Plane, hash_vec<3>> planes_;
+};
+
+template <typename PointType>
+void IVoxPlaneCache<PointType>::Build(const PointVector& points) {
+    std::unordered_map<KeyType, Moments, hash_vec<3>> moments;
+    for (const auto& pt : points) {
+        const KeyType key = Pos2Grid(pt.getVector3fMap());
+        const Eigen::Vector3d p = pt.getVector3fMap().template cast<double>() - key.template cast<double>() * resolution_;
+        Moments& m = moments[key];
+        m.num++;
+        m.sum += p;
+        m.sum_sq += p * p.transpose();
+    }
+
+    planes_.clear();
+    planes_.reserve(moments.size());
+    for (const auto& it : moments) {
+        const Moments& m = it.second;
+        if (m.num < min_points_) {
+            continue;
+        }
+        const Eigen::Vector3d mean = m.sum / m.num;
+        const Eigen::Matrix3d cov = m.sum_sq / m.num - mean * mean.transpose();
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver;
+        solver.computeDirect(cov);
+        // (nearly) collinear points do not define a plane
+        if (!(solver.eigenvalues()(1) > 1e-4 * solver.eigenvalues()(2))) {
+            continue;
+        }
+        const Eigen::Vector3d normal = solver.eigenvectors().col(0);
+        const Eigen::Vector3d centroid = mean + it.first.template cast<double>() * resolution_;
+        Plane plane;
+        plane.abcd << normal.cast<float>(), static_cast<float>(-normal.dot(centroid));
+        plane.residual = 0;
+        planes_.emplace(it.first, plane);
+    }
+
+    for (const auto& pt : points) {
+        auto iter = planes_.find(Pos2Grid(pt.getVector3fMap()));
+        if (iter != planes_.end()) {
+            Plane& plane = iter->second;
+            plane.residual =
+                std::max(plane.residual, std::fabs(plane.abcd.template head<3>().dot(pt.getVector3fMap()) + plane.abcd(3)));
+        }
+    }
+}
+
+}  // namespace faster_lio
+
+#endif
@@ -0,0 +1,131 @@
+//
+// Binary snapshot of an ivox, written once and memory mapped at startup.
+//
+
+#ifndef FASTER_LIO_IVOX3D_SNAPSHOT_H
+#define FASTER_LIO_IVOX3D_SNAPSHOT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <utils/mapped_file.h>
+
+namespace faster_lio {
+
+/*
+ * Layout of a snapshot file (native endianness, every section is naturally aligned in the mapping):
+ *   [IVoxSnapshotHeader][num_grids x IVoxSnapshotGrid][num_points x float xyz]
+ * The grids are stored from the most to the least recently written one, each owns the next num_points points.
+ * Only the coordinates of the points are kept. The snapshot is used while the size and mtime of the map file it
+ * was built from and the resolution of the ivox match the header.
+ */
+#define IVOX_SNAPSHOT_VERSION (1)
+
+struct IVoxSnapshotHeader {
+    char magic[4];  // "IVOX"
+    uint32_t version;
+    uint32_t dim;
+    float resolution;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t num_grids;
+    uint64_t num_points;
+};
+
+struct IVoxSnapshotGrid {
+    int32_t key[3];
+    uint32_t num_points;
+};
+
+/// voxels and points of an ivox, collected by IVox::Save
+struct IVoxSnapshotData {
+    std::vector<IVoxSnapshotGrid> grids;
+    std::vector<float> points;  // xyz
+
+    template <typename KeyType>
+    void AddGrid(const KeyType& key, uint32_t num_points) {
+        grids.push_back(IVoxSnapshotGrid{{key[0], key[1], key[2]}, num_points});
+    }
+
+    void AddPoint(float x, float y, float z) {
+        points.push_back(x);
+        points.push_back(y);
+        points.push_back(z);
+    }
+};
+
+/// a partly written snapshot is removed
+inline bool WriteIVoxSnapshot(const std::string& path, int dim, float resolution, uint64_t source_size,
+                              int64_t source_mtime, const IVoxSnapshotData& data) {
+    IVoxSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "IVOX", 4);
+    header.version = IVOX_SNAPSHOT_VERSION;
+    header.dim = dim;
+    header.resolution = resolution;
+    header.source_size = source_size;
+    header.source_mtime = source_mtime;
+    header.num_grids = data.grids.size();
+    header.num_points = data.points.size() / 3;
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(data.grids.data(), sizeof(IVoxSnapshotGrid), data.grids.size(), file);
+    fwrite(data.points.data(), sizeof(float), data.points.size(), file);
+    const bool failed = ferror(file);
+    fclose(file);
+    if (failed) {
+        remove(path.c_str());
+    }
+    return !failed;
+}
+
+/// mapped snapshot file, the sections point into the mapping
+class IVoxSnapshot {
+   public:
+    IVoxSnapshot(const std::string& path, int dim, float resolution, uint64_t source_size, int64_t source_mtime)
+        : file_(path) {
+        if (!file_.valid() || file_.size() < sizeof(IVoxSnapshotHeader)) {
+            return;
+        }
+        header_ = reinterpret_cast<const IVoxSnapshotHeader*>(file_.data());
+        const bool valid = memcmp(header_->magic, "IVOX", 4) == 0 && header_->version == IVOX_SNAPSHOT_VERSION &&
+                           header_->dim == uint32_t(dim) && header_->resolution == resolution &&
+                           header_->source_size == source_size && header_->source_mtime == source_mtime &&
+                           file_.size() == sizeof(IVoxSnapshotHeader) + header_->num_grids * sizeof(IVoxSnapshotGrid) +
+                                               header_->num_points * 3 * sizeof(float);
+        if (!valid) {
+            header_ = nullptr;
+            return;
+        }
+        // the grids must own exactly the stored points, a loader walks the points by them
+        uint64_t num_points = 0;
+        for (size_t i = 0; i < header_->num_grids; ++i) {
+            num_points += Grids()[i].num_points;
+        }
+        if (num_points != header_->num_points) {
+            header_ = nullptr;
+        }
+    }
+
+    bool Valid() const { return header_ != nullptr; }
+    size_t NumGrids() const { return header_->num_grids; }
+    size_t NumPoints() const { return header_->num_points; }
+
+    const IVoxSnapshotGrid* Grids() const { return reinterpret_cast<const IVoxSnapshotGrid*>(header_ + 1); }
+    const float* Points() const { return reinterpret_cast<const float*>(Grids() + header_->num_grids); }
+
+   private:
+    MappedFile file_;
+    const IVoxSnapshotHeader* header_ = nullptr;
+};
+
+}  // namespace faster_lio
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ * BSD 3-Clause License
+
+ *  Copyright (c) 2025, Dongjiao He
+ *  All rights reserved.
+ *
+ *  Author: Dongjiao HE <hdj65822@connect.hku.hk>
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Universitaet Bremen nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/*
+ * Bounded single-producer / single-consumer queue of time-stamped sensor messages.
+ * The producer (a ros callback) only calls push_back, the consumer (the main loop) calls
+ * everything else. Slots are allocated once; a message older than the last pushed one
+ * is rejected, so the buffer is always ordered by time stamp.
+ */
+template <typename T>
+class SpscRingBuffer {
+ public:
+  explicit SpscRingBuffer(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity + 1) size <<= 1;
+    mask_ = size - 1;
+    slots_.resize(size);
+    stamps_.resize(size, 0.0);
+  }
+
+  SpscRingBuffer(const SpscRingBuffer &) = delete;
+  SpscRingBuffer &operator=(const SpscRingBuffer &) = delete;
+
+  /// producer: false if the message is dropped because the buffer is full or out of order
+  bool push_back(T item, double stamp) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) > mask_ - 1) {
+      num_dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    if (tail != 0 && stamp < last_stamp_) {
+      num_out_of_order_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    slots_[tail & mask_] = std::move(item);
+    stamps_[tail & mask_] = stamp;
+    last_stamp_ = stamp;
+    tail_.store(tail + 1, std::memory_order_release);
+
+    const size_t used = tail + 1 - head_.load(std::memory_order_relaxed);
+    if (used > high_watermark_.load(std::memory_order_relaxed)) {
+      high_watermark_.store(used, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  /// consumer
+  bool empty() const { return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire); }
+
+  size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_relaxed); }
+
+  T &front() { return slots_[head_.load(std::memory_order_relaxed) & mask_]; }
+
+  T &back() { return slots_[(tail_.load(std::memory_order_acquire) - 1) & mask_]; }
+
+  double front_stamp() const { return stamps_[head_.load(std::memory_order_relaxed) & mask_]; }
+
+  double back_stamp() const { return stamps_[(tail_.load(std::memory_order_acquire) - 1) & mask_]; }
+
+  void pop_front() {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    slots_[head & mask_] = T();  // release the message before the slot is handed back
+    head_.store(head + 1, std::memory_order_release);
+  }
+
+  /// drop all messages with stamp < time, returns the number of dropped messages
+  size_t pop_until(double time) {
+    size_t num = 0;
+    while (!empty() && front_stamp() < time) {
+      pop_front();
+      num++;
+    }
+    return num;
+  }
+
+  void clear() {
+    while (!empty()) pop_front();
+  }
+
+  /// back-pressure counters
+  size_t capacity() const { return mask_; }
+  size_t num_dropped() const { return num_dropped_.load(std::memory_order_relaxed); }
+  size_t num_out_of_order() const { return num_out_of_order_.load(std::memory_order_relaxed); }
+  size_t high_watermark() const { return high_watermark_.load(std::memory_order_relaxed); }
+
+ private:
+  std::vector<T> slots_;
+  std::vector<double> stamps_;
+  size_t mask_ = 0;
+  double last_stamp_ = 0.0;  // producer only
+
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+
+  std::atomic<size_t> num_dropped_{0};
+  std::atomic<size_t> num_out_of_order_{0};
+  std::atomic<size_t> high_watermark_{0};
+};
+
+#endif
@@ -44,8 +44,16 @@ PointCloudXYZI::Ptr feats_down_world(new PointCloudXYZI(10000, 1));
 std::vector<V3D> pbody_list;
 std::vector<V3D> pimu_list;
 std::vector<PointVector> Nearest_Points; 
+std::vector<V3D> pworld_match_list;
+std::vector<VF(4)> plane_match_list;
+std::vector<signed char> match_state_list;
+std::vector<signed char> match_level_list;
 std::shared_ptr<IVoxType> ivox_ = nullptr;                    // localmap in ivox
 std::shared_ptr<IVoxType> ivox_last_ = nullptr;                    // localmap in ivox
+std::vector<std::shared_ptr<IVoxType> > ivox_levels_;              // coarser levels of ivox_, empty if disabled
+std::vector<std::shared_ptr<IVoxType> > ivox_levels_last_;         // ivox_last_ of each level
+std::vector<int> level_hits(1, 0), level_misses(1, 0);
+std::shared_ptr<PlaneCacheType> plane_cache_ = nullptr;            // planes of the prior map, nullptr if disabled
 std::vector<double> knots_t;
 std::vector<V3D> cp_pos;
 std::vector<V3D> updatedmap;
@@ -125,6 +133,178 @@ Eigen::Matrix<double, 24, 24> df_dx_output(state_output &s, const input_ikfom &i
 	return cov;
 }
 
+void propagate_cov_output(state_output &s, const input_ikfom &in, double delta_t, Eigen::Matrix<double, 24, 24> &P)
+{
+	// F of df_dx_output is the identity but for the block rows of pos, rot and vel, so F * P only changes
+	// these 9 rows, and F * P * F^T in addition only the same 9 columns
+	enum { POS = decltype(state_output::pos)::IDX, ROT = decltype(state_output::rot)::IDX, VEL = decltype(state_output::vel)::IDX,
+	       OMG = decltype(state_output::omg)::IDX, ACC = decltype(state_output::acc)::IDX, GRAV = decltype(state_output::gravity)::IDX };
+	static_assert(POS == 0 && ROT == 3 && VEL == 6, "pos, rot and vel lead the state");
+
+	SO3 delta_R;
+	Eigen::MatrixXd Jacob;
+	Eigen::Vector3d delta_theta = s.omg * delta_t;
+	Eigen::VectorXd delta_theta_ = delta_theta;
+	delta_R = SO3::exp(delta_theta);
+	delta_R.Jacob_right(delta_theta_, Jacob);
+
+	const M3D F_rot_rot = delta_R.transpose();
+	const M3D F_rot_omg = Jacob * delta_t;
+	const M3D F_vel_rot = -s.rot * MTK::hat(s.acc) * delta_t;
+	const M3D F_vel_acc = s.rot * delta_t;
+
+	Eigen::Matrix<double, 9, 24> FP;
+	FP.middleRows<3>(POS) = P.middleRows<3>(POS) + delta_t * P.middleRows<3>(VEL);
+	FP.middleRows<3>(ROT) = F_rot_rot * P.middleRows<3>(ROT) + F_rot_omg * P.middleRows<3>(OMG);
+	FP.middleRows<3>(VEL) = P.middleRows<3>(VEL) + F_vel_rot * P.middleRows<3>(ROT) + F_vel_acc * P.middleRows<3>(ACC) + delta_t * P.middleRows<3>(GRAV);
+
+	Eigen::Matrix<double, 9, 9> FPFt;
+	FPFt.middleCols<3>(POS) = FP.middleCols<3>(POS) + delta_t * FP.middleCols<3>(VEL);
+	FPFt.middleCols<3>(ROT) = FP.middleCols<3>(ROT) * F_rot_rot.transpose() + FP.middleCols<3>(OMG) * F_rot_omg.transpose();
+	FPFt.middleCols<3>(VEL) = FP.middleCols<3>(VEL) + FP.middleCols<3>(ROT) * F_vel_rot.transpose() + FP.middleCols<3>(ACC) * F_vel_acc.transpose()
+	                          + delta_t * FP.middleCols<3>(GRAV);
+
+	P.topLeftCorner<9, 9>() = FPFt;
+	P.topRightCorner<9, 15>() = FP.rightCols<15>();
+	P.bottomLeftCorner<15, 9>() = FP.rightCols<15>().transpose();
+}
+
+// the residual of a plane associated at level l is accepted up to 2^l times the one of ivox_
+static bool plane_accepted(const VF(4) &pabcd, const PointType &point_world, double p_norm, int level)
+{
+	float pd2 = fabs(pabcd.head<3>().dot(point_world.getVector3fMap()) + pabcd(3)) / (1 << level);
+	return p_norm > match_s * pd2 * pd2;
+}
+
+int match_coarse_to_fine(const PointType &point_world, double p_norm, PointVector &points_near, VF(4) &pabcd, bool &plane_valid)
+{
+	const bool accepted = plane_valid && plane_accepted(pabcd, point_world, p_norm, 0);
+	std::vector<int> &fine_counter = accepted ? level_hits : level_misses;
+#pragma omp atomic
+	fine_counter[0]++;
+	if (accepted) return 0;
+
+	// a point far from the surfaces of ivox_, e.g. after a GNSS re-anchor or during fast motion, takes the plane of the
+	// finest coarser level that has one; projected onto that plane, its neighbours in ivox_ refine the plane
+	PointVector coarse_near, fine_near;
+	VF(4) coarse_abcd, fine_abcd;
+	for (int level = 1; level <= (int)ivox_levels_.size(); level++)
+	{
+		ivox_levels_[level - 1]->GetClosestPoint(point_world, coarse_near, NUM_MATCH_POINTS);
+		const bool found = coarse_near.size() >= NUM_MATCH_POINTS && esti_plane(coarse_abcd, coarse_near, plane_thr)
+		                   && plane_accepted(coarse_abcd, point_world, p_norm, level);
+		std::vector<int> &counter = found ? level_hits : level_misses;
+#pragma omp atomic
+		counter[level]++;
+		if (!found) continue;
+
+		PointType projected = point_world;
+		projected.getVector3fMap() -= (coarse_abcd.head<3>().dot(point_world.getVector3fMap()) + coarse_abcd(3)) * coarse_abcd.head<3>();
+		ivox_->GetClosestPoint(projected, fine_near, NUM_MATCH_POINTS);
+		if (fine_near.size() >= NUM_MATCH_POINTS && esti_plane(fine_abcd, fine_near, plane_thr)
+		    && plane_accepted(fine_abcd, point_world, p_norm, level))
+		{
+			pabcd = fine_abcd;
+			points_near.swap(fine_near);
+		}
+		else
+		{
+			pabcd = coarse_abcd;
+			points_near.swap(coarse_near);
+		}
+		plane_valid = true;
+		return level;
+	}
+	return 0;
+}
+
+void batch_match_scan(double pcl_beg_time, double state_time)
+{
+	pworld_match_list.resize(feats_down_size);
+	plane_match_list.resize(feats_down_size);
+	match_state_list.assign(feats_down_size, MATCH_NONE);
+	match_level_list.assign(feats_down_size, 0);
+	if (match_reuse_dist <= 0) return;
+
+	const state_output &s = kf_output.x_;
+	std::vector<const PlaneCacheType::Plane *> cached_planes(feats_down_size);
+#pragma omp parallel for num_threads(MP_PROC_NUM)
+	for (int i = 0; i < feats_down_size; i++)
+	{
+		// constant velocity guess of the pose at the time of the point
+		double dt = feats_down_body->points[i].curvature / 1000.0 + pcl_beg_time - state_time;
+		M3D rot = s.rot * Exp(V3D(s.omg), dt);
+		pworld_match_list[i] = rot * pimu_list[i] + s.pos + s.vel * dt;
+
+		PointType point_world;
+		point_world.getVector3fMap() = pworld_match_list[i].cast<float>();
+		cached_planes[i] = plane_cache_ ? plane_cache_->Find(point_world) : nullptr;
+		// no neighbours, the point is reported invalid by esti_plane_batch and overwritten below
+		if (cached_planes[i] != nullptr)
+			Nearest_Points[i].clear();
+	}
+
+	// the other points are searched in morton order of their voxels, so the queries of a batch share voxels and
+	// walk the map storage in the order of IVox::Compact
+	std::vector<std::pair<uint64_t, int>> knn_order;
+	knn_order.reserve(feats_down_size);
+	for (int i = 0; i < feats_down_size; i++)
+	{
+		if (cached_planes[i] == nullptr)
+			knn_order.emplace_back(faster_lio::morton_code(ivox_->Pos2Grid(pworld_match_list[i].cast<float>())), i);
+	}
+	std::sort(knn_order.begin(), knn_order.end());
+	const int num_knn = knn_order.size();
+#pragma omp parallel for num_threads(MP_PROC_NUM)
+	for (int start = 0; start < num_knn; start += KNN_BATCH_SIZE)
+	{
+		const int num = std::min(KNN_BATCH_SIZE, num_knn - start);
+		PointType knn_points[KNN_BATCH_SIZE], knn_neighbours[KNN_BATCH_SIZE * NUM_MATCH_POINTS];
+		int knn_num_neighbours[KNN_BATCH_SIZE];
+		for (int n = 0; n < num; n++)
+			knn_points[n].getVector3fMap() = pworld_match_list[knn_order[start + n].second].cast<float>();
+		ivox_->GetClosestPoints(knn_points, num, knn_neighbours, knn_num_neighbours, NUM_MATCH_POINTS);
+		for (int n = 0; n < num; n++)
+		{
+			const PointType *first = knn_neighbours + n * NUM_MATCH_POINTS;
+			Nearest_Points[knn_order[start + n].second].assign(first, first + knn_num_neighbours[n]);
+		}
+	}
+
+#pragma omp parallel for num_threads(MP_PROC_NUM)
+	for (int start = 0; start < feats_down_size; start += PLANE_BATCH_SIZE)
+	{
+		const int num = std::min(PLANE_BATCH_SIZE, feats_down_size - start);
+		const PointVector *neighbours[PLANE_BATCH_SIZE];
+		for (int l = 0; l < num; l++)
+			neighbours[l] = &Nearest_Points[start + l];
+
+		bool plane_valid[PLANE_BATCH_SIZE];
+		esti_plane_batch(&plane_match_list[start], plane_valid, neighbours, num, plane_thr);
+		for (int l = 0; l < num; l++)
+		{
+			int i = start + l;
+			if (cached_planes[i] != nullptr)
+			{
+				plane_match_list[i] = cached_planes[i]->abcd;
+				plane_valid[l] = true;
+			}
+			if (!ivox_levels_.empty())
+			{
+				PointType point_world;
+				point_world.getVector3fMap() = pworld_match_list[i].cast<float>();
+				match_level_list[i] = match_coarse_to_fine(point_world, pbody_list[i].norm(), Nearest_Points[i], plane_match_list[i], plane_valid[l]);
+			}
+			match_state_list[i] = plane_valid[l] ? MATCH_PLANE : MATCH_NO_PLANE;
+		}
+	}
+}
+
+void reset_match_cache()
+{
+	std::fill(match_state_list.begin(), match_state_list.end(), MATCH_NONE);
+}
+
 void h_model_output(state_output &s, Eigen::Matrix3d cov_p, Eigen::Matrix3d cov_R, esekfom::dyn_share_modified<double> &ekfom_data)
 {
 	bool match_in_map = false;
@@ -132,6 +312,9 @@ void h_model_output(state_output &s, Eigen::Matrix3d cov_p, Eigen::Matrix3d cov_
 	pabcd.setZero();
 	normvec->resize(time_seq[k]);
 	int effect_num_k = 0;
+	// a plane of level l is fitted to points 2^l times as far apart and is accepted with a residual up to 2^l times
+	// larger, so the row of the (single) selected point is scaled by 1 / 2^l, i.e. 4^l times the laser_point_cov
+	double row_weight = 1.0;
 	for (int j = 0; j < time_seq[k]; j++)
 	{
 		PointType &point_body_j  = feats_down_body->points[idx+j+1];
@@ -142,18 +325,48 @@ void h_model_output(state_output &s, Eigen::Matrix3d cov_p, Eigen::Matrix3d cov_
 		V3D p_world;
 		p_world << point_world_j.x, point_world_j.y, point_world_j.z;
 		{
-			auto &points_near = Nearest_Points[idx+j+1];
-            ivox_->GetClosestPoint(point_world_j, points_near, NUM_MATCH_POINTS); // 
-			if ((points_near.size() < NUM_MATCH_POINTS)) // || pointSearchSqDis[NUM_MATCH_POINTS - 1] > 5)
+			int i = idx+j+1;
+			bool plane_valid = false;
+			int level = 0;
+			if (match_state_list[i] != MATCH_NONE && (p_world - pworld_match_list[i]).squaredNorm() < match_reuse_dist * match_reuse_dist)
 			{
-				point_selected_surf[idx+j+1] = false;
+				// the point moved less than match_reuse_dist since its correspondence was searched
+				plane_valid = match_state_list[i] == MATCH_PLANE;
+				pabcd = plane_match_list[i];
+				level = match_level_list[i];
 			}
 			else
 			{
-				point_selected_surf[idx+j+1] = false;
-				if (esti_plane(pabcd, points_near, plane_thr)) //(planeValid)
+				const PlaneCacheType::Plane *plane = plane_cache_ ? plane_cache_->Find(point_world_j) : nullptr;
+				if (plane != nullptr)
+				{
+					// one lookup instead of the knn search and the plane fit
+					Nearest_Points[i].clear();
+					pabcd = plane->abcd;
+					plane_valid = true;
+				}
+				else
+				{
+					auto &points_near = Nearest_Points[i];
+					ivox_->GetClosestPoint(point_world_j, points_near, NUM_MATCH_POINTS); // 
+					plane_valid = points_near.size() >= NUM_MATCH_POINTS && esti_plane(pabcd, points_near, plane_thr); // || pointSearchSqDis[NUM_MATCH_POINTS - 1] > 5)
+				}
+				if (!ivox_levels_.empty())
+					level = match_coarse_to_fine(point_world_j, p_norm, Nearest_Points[i], pabcd, plane_valid);
+				if (match_reuse_dist > 0)
+				{
+					pworld_match_list[i] = p_world;
+					plane_match_list[i] = pabcd;
+					match_state_list[i] = plane_valid ? MATCH_PLANE : MATCH_NO_PLANE;
+					match_level_list[i] = level;
+				}
+			}
+			point_selected_surf[i] = false;
+			{
+				if (plane_valid) //(planeValid)
 				{
-					float pd2 = fabs(pabcd(0) * point_world_j.x + pabcd(1) * point_world_j.y + pabcd(2) * point_world_j.z + pabcd(3));
+					// the residual of a coarse level correspondence is scaled by its resolution, see plane_accepted
+					float pd2 = fabs(pabcd(0) * point_world_j.x + pabcd(1) * point_world_j.y + pabcd(2) * point_world_j.z + pabcd(3)) / (1 << level);
 					
 					if (effect_num_k > 0) continue;
 					if (p_norm > match_s * pd2 * pd2)
@@ -163,6 +376,7 @@ void h_model_output(state_output &s, Eigen::Matrix3d cov_p, Eigen::Matrix3d cov_
 						normvec->points[j].y = pabcd(1);
 						normvec->points[j].z = pabcd(2);
 						normvec->points[j].intensity = pabcd(3);
+						row_weight = 1.0 / (1 << level);
 						effect_num_k ++;
 					}
 				}  
@@ -202,6 +416,8 @@ void h_model_output(state_output &s, Eigen::Matrix3d cov_p, Eigen::Matrix3d cov_
 				ekfom_data.h_x.block<1, 6>(m, 0) << norm_vec(0), norm_vec(1), norm_vec(2), VEC_FROM_ARRAY(A); //, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0;
 			// }
 			ekfom_data.z(m) = -norm_vec(0) * feats_down_world->points[idx+j+1].x -norm_vec(1) * feats_down_world->points[idx+j+1].y -norm_vec(2) * feats_down_world->points[idx+j+1].z-normvec->points[j].intensity;
+			ekfom_data.h_x.row(m) *= row_weight;
+			ekfom_data.z(m) *= row_weight;
 			
 			m++;
 		}
@@ -319,7 +535,7 @@ void h_model_GNSS_output(state_output &s, Eigen::Matrix3d cov_p, Eigen::Matrix3d
 	// ekfom_data.R_GNSS(5) = gnss_ekf_noise;
 	// double max_err = error_1 > error_2? error_1 : error_2;
 	// max_err = max_err > error_3? max_err : error_3;
-	ekfom_data.M_Noise = gnss_ekf_noise; // > max_err? gnss_ekf_noise : max_err;
+	ekfom_data.M_Noise = gnss_ekf_noise + p_gnss->delay_noise; // > max_err? gnss_ekf_noise : max_err;
 }
 
 void h_model_NMEA_output(state_output &s, Eigen::Matrix3d cov_p, Eigen::Matrix3d cov_R, esekfom::dyn_share_modified<double> &ekfom_data)
@@ -369,7 +585,7 @@ void h_model_NMEA_output(state_output &s, Eigen::Matrix3d cov_p, Eigen::Matrix3d
 	// ekfom_data.z_NMEA.block<3, 1>(0, 0) = p_nmea->state_const_.pos - s.pos - s.vel * s.time_diff - 0.5 * s.acc * s.time_diff * s.time_diff; // 
 	// ekfom_data.z_NMEA.block<3, 1>(6, 0) = p_nmea->state_const_.vel - s.vel - s.acc * s.time_diff; // 
 	// ekfom_data.z_NMEA.block<3, 1>(3, 0) = res_r; // s.rot.transpose() * p_gnss->state_.rot; //  
-	ekfom_data.M_Noise = gnss_ekf_noise;
+	ekfom_data.M_Noise = gnss_ekf_noise + p_nmea->delay_noise;
 }
 
 void pointBodyToWorld(PointType const * const pi, PointType * const po)
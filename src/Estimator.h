@@ -54,8 +54,19 @@ extern std::vector<V3D> updatedmap;
 extern std::vector<V3D> pbody_list;
 extern std::vector<V3D> pimu_list;
 extern std::vector<PointVector> Nearest_Points; 
+
+// cached correspondence of a point: searched at pworld_match_list, plane in plane_match_list
+enum MatchState : signed char { MATCH_NONE = -1, MATCH_NO_PLANE = 0, MATCH_PLANE = 1 };
+extern std::vector<V3D> pworld_match_list;
+extern std::vector<VF(4)> plane_match_list;
+extern std::vector<signed char> match_state_list;
+extern std::vector<signed char> match_level_list;              // level of ivox_levels_ the plane was associated at, 0: ivox_
 extern std::shared_ptr<IVoxType> ivox_;                    // localmap in ivox
 extern std::shared_ptr<IVoxType> ivox_last_;                    // localmap in ivox
+extern std::vector<std::shared_ptr<IVoxType> > ivox_levels_;   // coarser levels of ivox_, level l + 1 of 2^(l + 1) times its resolution
+extern std::vector<std::shared_ptr<IVoxType> > ivox_levels_last_; // ivox_last_ of each level
+extern std::vector<int> level_hits, level_misses;             // planes found per level (0: ivox_) since the last log
+extern std::shared_ptr<PlaneCacheType> plane_cache_;            // planes of the prior map, nullptr if disabled
 extern std::vector<double> knots_t;
 extern std::vector<V3D> cp_pos;
 extern std::vector<M3D> cp_rot;
@@ -82,6 +93,18 @@ Eigen::Matrix<double, 24, 1> get_f_output(state_output &s, const input_ikfom &in
 
 Eigen::Matrix<double, 24, 24> df_dx_output(state_output &s, const input_ikfom &in, double delta_t);
 
+// P = F * P * F^T with F = df_dx_output(s, in, delta_t), updating only the blocks F touches
+void propagate_cov_output(state_output &s, const input_ikfom &in, double delta_t, Eigen::Matrix<double, 24, 24> &P);
+
+// search the correspondences of all points of the scan in parallel, with a constant velocity guess of their poses
+void batch_match_scan(double pcl_beg_time, double state_time);
+
+// drop the cached correspondences, e.g. after the map changed
+void reset_match_cache();
+
+// coarse to fine association of a point whose plane in ivox_ is missing or too far, returns the level it is associated at
+int match_coarse_to_fine(const PointType &point_world, double p_norm, PointVector &points_near, VF(4) &pabcd, bool &plane_valid);
+
 void h_model_output(state_output &s, Eigen::Matrix3d cov_p, Eigen::Matrix3d cov_R, esekfom::dyn_share_modified<double> &ekfom_data);
 
 void h_model_IMU_output(state_output &s, esekfom::dyn_share_modified<double> &ekfom_data);
@@ -210,130 +210,411 @@ void GNSSAssignment::initNoises( void ) // maybe usable!
 
 void GNSSAssignment::Ephemfromrinex(const std::string &rinex_filepath)
 {
-  rinex2ephems(rinex_filepath, sat2ephem_rnx);
-  std::map<uint32_t, std::vector<EphemBasePtr>>::iterator it;
-  for (it = sat2ephem_rnx.begin(); it != sat2ephem_rnx.end(); it++)
+  std::map<uint32_t, std::vector<EphemBasePtr>> sat2ephem_rnx;
+  if (!(rinex_cache && loadRinexNavCache(rinex_filepath, sat2ephem_rnx, latest_gnss_iono_params)))
   {
-    for (int j = 0; j < it->second.size(); j++)
-    {
-      sat2time_index_rnx[it->first].emplace(time2sec(it->second[j]->toe), j);
-    }
+    rinex2ephems(rinex_filepath, sat2ephem_rnx);
+    const bool has_iono = rinex2iono_params(rinex_filepath, latest_gnss_iono_params);
+    if (rinex_cache)
+      saveRinexNavCache(rinex_filepath, sat2ephem_rnx, latest_gnss_iono_params, has_iono);
   }
-  rinex2iono_params(rinex_filepath, latest_gnss_iono_params);
+  ephem_store_rnx.load(sat2ephem_rnx);
 }
 
 void GNSSAssignment::Obsfromrinex(const std::string &rinex_filepath, std::queue<std::vector<ObsPtr>> &rinex_meas)
 {
-  rinex2obs(rinex_filepath, rinex_meas);
+  std::vector<std::vector<ObsPtr>> epochs;
+  if (!(rinex_cache && loadRinexObsCache(rinex_filepath, epochs)))
+  {
+    rinex2obs(rinex_filepath, epochs);
+    if (rinex_cache)
+      saveRinexObsCache(rinex_filepath, epochs);
+  }
+  for (auto &meas : epochs)
+    rinex_meas.push(meas);
 }
 
 void GNSSAssignment::inputEphem(EphemBasePtr ephem_ptr) // 
 {
-    double toe = time2sec(ephem_ptr->toe);
-    // if a new ephemeris comes
-    if (sat2time_index.count(ephem_ptr->sat) == 0 || sat2time_index.at(ephem_ptr->sat).count(toe) == 0)
-    {
-        sat2ephem[ephem_ptr->sat].emplace_back(ephem_ptr);
-        sat2time_index[ephem_ptr->sat].emplace(toe, sat2ephem.at(ephem_ptr->sat).size()-1);
-    }
+    // only a new ephemeris is stored
+    ephem_store.insert(ephem_ptr);
 }
 
-void GNSSAssignment::rinex2iono_params(const std::string &rinex_filepath, std::vector<double> &iono_params)
+bool GNSSAssignment::rinex2iono_params(const std::string &rinex_filepath, std::vector<double> &iono_params)
 {
     iono_params.resize(8);
-    std::ifstream file(rinex_filepath);
-    std::string line;
+    MappedFile file(rinex_filepath);
+    if (!file.valid())
+    {
+        LOG(ERROR) << "Cannot open RINEX file " << rinex_filepath;
+        return false;
+    }
+    RinexLineReader reader(file);
+    RinexLine line;
 
     // check first line, mainly RINEX version
-    if (!(std::getline(file, line) && line.find("RINEX VERSION")  != std::string::npos 
-            && line.find("3.04") != std::string::npos))
+    if (!(reader.next(line) && line.contains("RINEX VERSION") && line.contains("3.04")))
     {
         LOG(ERROR) << "Only RINEX 3.04 is supported";
-        return;
+        return false;
     }
 
     bool find_alpha = false, find_beta = false;
-    while(std::getline(file, line))
+    while (reader.next(line))
     {
-        if (line.find("IONOSPHERIC CORR") != std::string::npos && line.find("GPSA") != std::string::npos)
+        if (line.contains("IONOSPHERIC CORR") && line.contains("GPSA"))
         {
-
             // parse ion alpha value
             for (size_t i = 0; i < 4; ++i)
-            {
-                std::string value_str = line.substr(i*12+5, 12);
-                iono_params[i] = str2double(value_str);
-            }
+                iono_params[i] = line.toDouble(i*12+5, 12);
             find_alpha = true;
         }
-        else if (line.find("IONOSPHERIC CORR") != std::string::npos && line.find("GPSB") != std::string::npos)
+        else if (line.contains("IONOSPHERIC CORR") && line.contains("GPSB"))
         {
             // parse ion beta value
             for (size_t i = 0; i < 4; ++i)
-            {
-                std::string value_str = line.substr(i*12+5, 12);
-                iono_params[i+4] = str2double(value_str);
-            }
+                iono_params[i+4] = line.toDouble(i*12+5, 12);
             find_beta = true;
         }
 
         if(find_alpha && find_beta)
             break;
     }
-    file.close();
+    return find_alpha && find_beta;
 }
 
 void GNSSAssignment::rinex2ephems(const std::string &rinex_filepath, std::map<uint32_t, std::vector<EphemBasePtr>> &sat2ephem_)
 {
+    MappedFile ephem_file(rinex_filepath);
+    if (!ephem_file.valid())
+    {
+        LOG(ERROR) << "Cannot open RINEX file " << rinex_filepath;
+        return;
+    }
+    RinexLineReader reader(ephem_file);
+    RinexLine line;
+
     uint32_t gpst_leap_seconds = static_cast<uint32_t>(-1);
-    std::ifstream ephem_file(rinex_filepath);
-    std::string line;
-    while(std::getline(ephem_file, line))
+    while (reader.next(line))
     {
-        if (line.find("RINEX VERSION / TYPE") != std::string::npos && line.find("3.04") == std::string::npos)
+        if (line.contains("RINEX VERSION / TYPE") && !line.contains("3.04"))
         {
             LOG(ERROR) << "Only RINEX 3.04 is supported for observation file";
             return;
         }
-        else if (line.find("LEAP SECONDS") != std::string::npos && line.find("BDS") == std::string::npos)
-            gpst_leap_seconds = static_cast<uint32_t>(std::stoi(line.substr(4, 6)));
-        else if (line.find("END OF HEADER") != std::string::npos)
+        else if (line.contains("LEAP SECONDS") && !line.contains("BDS"))
+            gpst_leap_seconds = static_cast<uint32_t>(line.toInt(4, 6));
+        else if (line.contains("END OF HEADER"))
             break;
     }
     LOG_IF(FATAL, gpst_leap_seconds == static_cast<uint32_t>(-1)) << "No leap second record found";
 
-    while(std::getline(ephem_file, line))
+    RinexLine ephem_lines[8];
+    while (reader.next(ephem_lines[0]))
     {
-        if (line.at(0) == 'G' || line.at(0) == 'C' || line.at(0) == 'E')
+        const char sys_char = ephem_lines[0].at(0);
+        if (sys_char == 'G' || sys_char == 'C' || sys_char == 'E')
         {
-            std::vector<std::string> ephem_lines;
-            ephem_lines.push_back(line);
-            for (size_t i = 0; i < 7; ++i)
-            {
-                std::getline(ephem_file, line);
-                ephem_lines.push_back(line);
-            }
+            for (size_t i = 1; i < 8; ++i)
+                if (!reader.next(ephem_lines[i]))
+                    ephem_lines[i] = RinexLine();
             EphemPtr ephem = rinex_line2ephem(ephem_lines);
             if (!ephem || ephem->ttr.time == 0)  continue;
-            if (sat2ephem_.count(ephem->sat) == 0)
-                sat2ephem_.emplace(ephem->sat, std::vector<EphemBasePtr>());
-            sat2ephem_.at(ephem->sat).push_back(ephem);
+            sat2ephem_[ephem->sat].push_back(ephem);
+        }
+        else if (sys_char == 'R')
+        {
+            for (size_t i = 1; i < 4; ++i)
+                if (!reader.next(ephem_lines[i]))
+                    ephem_lines[i] = RinexLine();
+            GloEphemPtr glo_ephem = rinex_line2glo_ephem(ephem_lines, gpst_leap_seconds);
+            sat2ephem_[glo_ephem->sat].push_back(glo_ephem);
+        }
+    }
+}
+
+// the sidecar is valid as long as the rinex file is unchanged
+static bool rinexCacheValid(const std::string &rinex_filepath, const RinexCacheHeader &header, const char *magic)
+{
+    struct stat file_stat;
+    return stat(rinex_filepath.c_str(), &file_stat) == 0 && memcmp(header.magic, magic, 4) == 0 &&
+           header.version == RINEX_CACHE_VERSION && header.source_size == (uint64_t)file_stat.st_size &&
+           header.source_mtime == (int64_t)file_stat.st_mtime;
+}
+
+static FILE *openRinexCache(const std::string &rinex_filepath, RinexCacheHeader &header, const char *magic)
+{
+    struct stat file_stat;
+    if (stat(rinex_filepath.c_str(), &file_stat) != 0)
+        return nullptr;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, magic, 4);
+    header.version = RINEX_CACHE_VERSION;
+    header.source_size = file_stat.st_size;
+    header.source_mtime = file_stat.st_mtime;
+    return fopen((rinex_filepath + ".bin").c_str(), "wb");
+}
+
+// a partly written sidecar is removed, it would only be rejected by the next load
+static void closeRinexCache(const std::string &rinex_filepath, FILE *file)
+{
+    const bool failed = ferror(file);
+    fclose(file);
+    if (failed)
+    {
+        LOG(WARNING) << "Cannot write the RINEX cache of " << rinex_filepath;
+        remove((rinex_filepath + ".bin").c_str());
+    }
+}
+
+bool GNSSAssignment::loadRinexNavCache(const std::string &rinex_filepath, std::map<uint32_t, std::vector<EphemBasePtr>> &sat2ephem_, std::vector<double> &iono_params)
+{
+    MappedFile file(rinex_filepath + ".bin");
+    if (!file.valid())
+        return false;
+    RinexCacheReader reader(file);
+    RinexCacheHeader header;
+    double iono[8];
+    if (!reader.read(&header) || !rinexCacheValid(rinex_filepath, header, "RNXN") || !reader.read(iono, 8))
+        return false;
+
+    std::map<uint32_t, std::vector<EphemBasePtr>> sat2ephem_cache;
+    for (uint64_t i = 0; i < header.num_records; ++i)
+    {
+        uint32_t type = 0;
+        if (!reader.read(&type))
+            return false;
+        if (type == 0)
+        {
+            RinexEphemRecord record;
+            if (!reader.read(&record))
+                return false;
+            EphemPtr ephem(new Ephem());
+            ephem->sat = record.sat;
+            ephem->week = record.week;
+            ephem->health = record.health;
+            ephem->toc.time = record.toc;
+            ephem->toc.sec = record.toc_sec;
+            ephem->toe.time = record.toe;
+            ephem->toe.sec = record.toe_sec;
+            ephem->ttr.time = record.ttr;
+            ephem->ttr.sec = record.ttr_sec;
+            ephem->iode = record.iode;
+            ephem->iodc = record.iodc;
+            ephem->toe_tow = record.toe_tow;
+            ephem->ura = record.ura;
+            ephem->tgd[0] = record.tgd[0];
+            ephem->tgd[1] = record.tgd[1];
+            ephem->A = record.A;
+            ephem->e = record.e;
+            ephem->i0 = record.i0;
+            ephem->omg = record.omg;
+            ephem->OMG0 = record.OMG0;
+            ephem->M0 = record.M0;
+            ephem->delta_n = record.delta_n;
+            ephem->OMG_dot = record.OMG_dot;
+            ephem->i_dot = record.i_dot;
+            ephem->cuc = record.cuc;
+            ephem->cus = record.cus;
+            ephem->crc = record.crc;
+            ephem->crs = record.crs;
+            ephem->cic = record.cic;
+            ephem->cis = record.cis;
+            ephem->af0 = record.af0;
+            ephem->af1 = record.af1;
+            ephem->af2 = record.af2;
+            sat2ephem_cache[ephem->sat].push_back(ephem);
         }
-        else if (line.at(0) == 'R')
+        else
         {
-            std::vector<std::string> ephem_lines;
-            ephem_lines.push_back(line);
-            for (size_t i = 0; i < 3; ++i)
+            RinexGloEphemRecord record;
+            if (!reader.read(&record))
+                return false;
+            GloEphemPtr glo_ephem(new GloEphem());
+            glo_ephem->sat = record.sat;
+            glo_ephem->health = record.health;
+            glo_ephem->age = record.age;
+            glo_ephem->freqo = record.freqo;
+            glo_ephem->toe.time = record.toe;
+            glo_ephem->toe.sec = record.toe_sec;
+            glo_ephem->tau_n = record.tau_n;
+            glo_ephem->gamma = record.gamma;
+            for (size_t j = 0; j < 3; ++j)
             {
-                std::getline(ephem_file, line);
-                ephem_lines.push_back(line);
+                glo_ephem->pos[j] = record.pos[j];
+                glo_ephem->vel[j] = record.vel[j];
+                glo_ephem->acc[j] = record.acc[j];
+            }
+            sat2ephem_cache[glo_ephem->sat].push_back(glo_ephem);
+        }
+    }
+    if (!reader.end())
+        return false;
+
+    for (auto &sat_ephems : sat2ephem_cache)
+    {
+        auto &ephems = sat2ephem_[sat_ephems.first];
+        ephems.insert(ephems.end(), sat_ephems.second.begin(), sat_ephems.second.end());
+    }
+    if (header.has_iono)
+        iono_params.assign(iono, iono + 8);
+    else
+        iono_params.resize(8);
+    return true;
+}
+
+void GNSSAssignment::saveRinexNavCache(const std::string &rinex_filepath, const std::map<uint32_t, std::vector<EphemBasePtr>> &sat2ephem_, const std::vector<double> &iono_params, bool has_iono)
+{
+    RinexCacheHeader header;
+    FILE *file = openRinexCache(rinex_filepath, header, "RNXN");
+    if (file == nullptr)
+    {
+        LOG(WARNING) << "Cannot write the RINEX cache of " << rinex_filepath;
+        return;
+    }
+    for (const auto &sat_ephems : sat2ephem_)
+        header.num_records += sat_ephems.second.size();
+    header.has_iono = has_iono;
+    fwrite(&header, sizeof(header), 1, file);
+    double iono[8] = {0};
+    std::copy_n(iono_params.begin(), std::min<size_t>(iono_params.size(), 8), iono);
+    fwrite(iono, sizeof(double), 8, file);
+
+    for (const auto &sat_ephems : sat2ephem_)
+    {
+        for (const auto &ephem_base : sat_ephems.second)
+        {
+            if (EphemPtr ephem = std::dynamic_pointer_cast<Ephem>(ephem_base))
+            {
+                const uint32_t type = 0;
+                RinexEphemRecord record;
+                memset(&record, 0, sizeof(record));
+                record.sat = ephem->sat;
+                record.week = ephem->week;
+                record.health = ephem->health;
+                record.toc = ephem->toc.time;
+                record.toc_sec = ephem->toc.sec;
+                record.toe = ephem->toe.time;
+                record.toe_sec = ephem->toe.sec;
+                record.ttr = ephem->ttr.time;
+                record.ttr_sec = ephem->ttr.sec;
+                record.iode = ephem->iode;
+                record.iodc = ephem->iodc;
+                record.toe_tow = ephem->toe_tow;
+                record.ura = ephem->ura;
+                record.tgd[0] = ephem->tgd[0];
+                record.tgd[1] = ephem->tgd[1];
+                record.A = ephem->A;
+                record.e = ephem->e;
+                record.i0 = ephem->i0;
+                record.omg = ephem->omg;
+                record.OMG0 = ephem->OMG0;
+                record.M0 = ephem->M0;
+                record.delta_n = ephem->delta_n;
+                record.OMG_dot = ephem->OMG_dot;
+                record.i_dot = ephem->i_dot;
+                record.cuc = ephem->cuc;
+                record.cus = ephem->cus;
+                record.crc = ephem->crc;
+                record.crs = ephem->crs;
+                record.cic = ephem->cic;
+                record.cis = ephem->cis;
+                record.af0 = ephem->af0;
+                record.af1 = ephem->af1;
+                record.af2 = ephem->af2;
+                fwrite(&type, sizeof(type), 1, file);
+                fwrite(&record, sizeof(record), 1, file);
+            }
+            else
+            {
+                GloEphemPtr glo_ephem = std::dynamic_pointer_cast<GloEphem>(ephem_base);
+                const uint32_t type = 1;
+                RinexGloEphemRecord record;
+                memset(&record, 0, sizeof(record));
+                record.sat = glo_ephem->sat;
+                record.health = glo_ephem->health;
+                record.age = glo_ephem->age;
+                record.freqo = glo_ephem->freqo;
+                record.toe = glo_ephem->toe.time;
+                record.toe_sec = glo_ephem->toe.sec;
+                record.tau_n = glo_ephem->tau_n;
+                record.gamma = glo_ephem->gamma;
+                for (size_t j = 0; j < 3; ++j)
+                {
+                    record.pos[j] = glo_ephem->pos[j];
+                    record.vel[j] = glo_ephem->vel[j];
+                    record.acc[j] = glo_ephem->acc[j];
+                }
+                fwrite(&type, sizeof(type), 1, file);
+                fwrite(&record, sizeof(record), 1, file);
             }
-            GloEphemPtr glo_ephem = rinex_line2glo_ephem(ephem_lines, gpst_leap_seconds);
-            if (sat2ephem_.count(glo_ephem->sat) == 0)
-                sat2ephem_.emplace(glo_ephem->sat, std::vector<EphemBasePtr>());
-            sat2ephem_.at(glo_ephem->sat).push_back(glo_ephem);
         }
     }
+    closeRinexCache(rinex_filepath, file);
+}
+
+// the same computation as GNSSProcess::GnssPsrDoppMeas did for every observation
+static void computeSvState(const ObsPtr &obs, const EphemBasePtr &ephem, SvState &state)
+{
+    int freq_idx = -1;
+    L1_freq(obs, &freq_idx);
+    const double tof = obs->psr[freq_idx] / LIGHT_SPEED;
+    gtime_t sv_tx = time_add(obs->time, -tof);
+
+    state.ephem = ephem;
+    if (satsys(obs->sat, NULL) == SYS_GLO)
+    {
+        GloEphemPtr glo_ephem = std::dynamic_pointer_cast<GloEphem>(ephem);
+        state.svdt = geph2svdt(sv_tx, glo_ephem);
+        sv_tx = time_add(sv_tx, -state.svdt);
+        state.pos = geph2pos(sv_tx, glo_ephem, &state.svdt);
+        state.vel = geph2vel(sv_tx, glo_ephem, &state.svddt);
+    }
+    else
+    {
+        EphemPtr eph = std::dynamic_pointer_cast<Ephem>(ephem);
+        state.svdt = eph2svdt(sv_tx, eph);
+        sv_tx = time_add(sv_tx, -state.svdt);
+        state.pos = eph2pos(sv_tx, eph, &state.svdt);
+        state.vel = eph2vel(sv_tx, eph, &state.svddt);
+    }
+}
+
+// the orbit and clock of a satellite are computed once per epoch, for the elevation filter and the factors
+const SvState &GNSSAssignment::svState(const ObsPtr &obs, const EphemBasePtr &ephem)
+{
+    const double epoch_time = time2sec(obs->time);
+    std::map<uint32_t, SvState> &epoch_states = sv_state_cache[epoch_time];
+    auto it = epoch_states.find(obs->sat);
+    if (it == epoch_states.end() || it->second.ephem != ephem)
+    {
+        if (it == epoch_states.end())
+            it = epoch_states.emplace(obs->sat, SvState()).first;
+        computeSvState(obs, ephem, it->second);
+        // never drop the epoch being read
+        while (sv_state_cache.size() > SV_STATE_EPOCHS && sv_state_cache.begin()->first < epoch_time)
+            sv_state_cache.erase(sv_state_cache.begin());
+    }
+    return it->second;
+}
+
+// compute the states missing in the cache for a whole epoch, in parallel over the satellites
+void GNSSAssignment::fillSvStates(const std::vector<ObsPtr> &gnss_meas, const std::vector<EphemBasePtr> &ephems)
+{
+    std::vector<std::pair<size_t, SvState *>> missing;
+    for (size_t i = 0; i < gnss_meas.size(); i++)
+    {
+        std::map<uint32_t, SvState> &epoch_states = sv_state_cache[time2sec(gnss_meas[i]->time)];
+        auto it = epoch_states.find(gnss_meas[i]->sat);
+        if (it == epoch_states.end() || it->second.ephem != ephems[i])
+            missing.emplace_back(i, &epoch_states[gnss_meas[i]->sat]);
+    }
+#pragma omp parallel for num_threads(MP_PROC_NUM)
+    for (size_t i = 0; i < missing.size(); i++)
+        computeSvState(gnss_meas[missing[i].first], ephems[missing[i].first], *missing[i].second);
+
+    while (sv_state_cache.size() > SV_STATE_EPOCHS && !gnss_meas.empty() && sv_state_cache.begin()->first < time2sec(gnss_meas[0]->time))
+        sv_state_cache.erase(sv_state_cache.begin());
 }
 
 // ### 代码解释：
@@ -364,7 +645,6 @@ void GNSSAssignment::processGNSSBase(const std::vector<ObsPtr> &gnss_meas, std::
     uint32_t sys = satsys(obs->sat, NULL);
     if (sys != SYS_GPS && sys != SYS_GLO && sys != SYS_GAL && sys != SYS_BDS)
         continue;
-    size_t ephem_index = -1;
     EphemBasePtr best_ephem_cur;
     double obs_time = time2sec(obs->time);
     if (obs->freqs.empty())    continue;       // no valid signal measurement
@@ -524,36 +804,22 @@ void GNSSAssignment::processGNSSBase(const std::vector<ObsPtr> &gnss_meas, std::
     if (!ephem_from_rinex)
     {
       // 获取卫星星历，如果还没有星历则跳过
-      if (sat2ephem.count(obs->sat) == 0)
+      if (!ephem_store.has(obs->sat))
         continue;
       
-      // 获取当前卫星的时间索引映射
-      std::map<double, size_t> time2index = sat2time_index.at(obs->sat);
-      double ephem_time = EPH_VALID_SECONDS; // 设置有效的星历时间窗口
-      // 遍历时间索引，找到与当前观测时间最接近的星历时间
-      for (auto ti : time2index)
-      {
-          // 如果当前星历的时间和观测时间差距更小，则更新
-          if (std::abs(ti.first - obs_time) < ephem_time)
-          {
-              ephem_time = std::abs(ti.first - obs_time); // 更新时间差
-              ephem_index = ti.second;                    // 记录最接近的星历索引
-          }
-      }
+      // 二分查找与当前观测时间最接近的星历，在有效时间窗口内才使用
+      best_ephem_cur = ephem_store.nearest(obs->sat, obs_time, EPH_VALID_SECONDS);
       // 如果没有找到有效的星历，则跳过该观测
-      std::map<double, size_t>().swap(time2index);
-      if (ephem_time >= EPH_VALID_SECONDS)
+      if (!best_ephem_cur)
       {
           cerr << "ephemeris not valid anymore\n";
           continue;
       }
-      // 获取最合适的星历
-      best_ephem_cur = sat2ephem.at(obs->sat).at(ephem_index);
     }
     else
     {
       // cout << "gnss ready:" << gnss_ready << endl;
-      if (sat2ephem_rnx.count(obs->sat) == 0)
+      if (!ephem_store_rnx.has(obs->sat))
           continue;
     //   if (obs->freqs.empty())    continue;       // no valid signal measurement
       
@@ -562,24 +828,12 @@ void GNSSAssignment::processGNSSBase(const std::vector<ObsPtr> &gnss_meas, std::
     //   if (freq_idx_ < 0)   continue;              // no L1 observation
       
     //   obs_time = time2sec(obs->time);
-      std::map<double, size_t> time2index = sat2time_index_rnx.at(obs->sat);
-      double ephem_time = EPH_VALID_SECONDS;
-      for (auto ti : time2index)
-      {
-        //   cout << std::abs(ti.first - obs_time) << endl;
-          if (std::abs(ti.first - obs_time) < ephem_time)
-          {
-              ephem_time = std::abs(ti.first - obs_time);
-              ephem_index = ti.second;
-          }
-      }
-      std::map<double, size_t>().swap(time2index);
-      if (ephem_time >= EPH_VALID_SECONDS)
+      best_ephem_cur = ephem_store_rnx.nearest(obs->sat, obs_time, EPH_VALID_SECONDS);
+      if (!best_ephem_cur)
       {
           cerr << "ephemeris not valid anymore\n";
           continue;
       }
-      best_ephem_cur = sat2ephem_rnx.at(obs->sat).at(ephem_index);
     }
       const EphemBasePtr &best_ephem = best_ephem_cur;
       // filter by tracking status
@@ -589,11 +843,7 @@ void GNSSAssignment::processGNSSBase(const std::vector<ObsPtr> &gnss_meas, std::
       if (gnss_ready) // && !quick_it) // gnss initialization is completed, then filter the sat by elevation angle // need to be defined
       {
           // 计算卫星的 ECEF 位置
-          Eigen::Vector3d sat_ecef;
-          if (sys == SYS_GLO)
-              sat_ecef = geph2pos(obs->time, std::dynamic_pointer_cast<GloEphem>(best_ephem), NULL);
-          else
-              sat_ecef = eph2pos(obs->time, std::dynamic_pointer_cast<Ephem>(best_ephem), NULL);
+          const Eigen::Vector3d &sat_ecef = svState(obs, best_ephem).pos;
           // 计算卫星方位角（Azimuth）和仰角（Elevation）
           double azel[2] = {0, M_PI/2.0};
         //   if (fabs((ecef_pos-sat_ecef).norm() - hatch_filter_meas[obs->sat]) > 3 * 1e6)
@@ -733,18 +983,44 @@ void GNSSAssignment::delete_variables(bool nolidar, size_t frame_delete, int fra
     }
 }  
 
-double GNSSAssignment::str2double(const std::string &num_str)
+#ifdef GNSS_FIXED_LAG_SMOOTHER
+void GNSSAssignment::update_fixed_lag(int frame_num, int window)
 {
-    size_t D_pos = num_str.find("D");
-    std::string tmp_str = num_str;
-    if (D_pos != std::string::npos)
-        tmp_str = tmp_str.replace(D_pos, 1, "e");
-    return std::stod(tmp_str);
+    // the frame index is the timestamp of a variable, the variables of the frames out of the window are
+    // marginalized into a prior on the remaining ones. The extrinsics are restamped at every epoch to stay.
+    if (!smoother)
+    {
+        // started once the gnss is initialized, it takes over the graph isam held until then
+        smoother = std::make_shared<gtsam::IncrementalFixedLagSmoother>(window - 1, isam.params());
+        for (const auto &factor : isam.getFactorsUnsafe())
+        {
+            if (factor) gtSAMgraph.push_back(factor);
+        }
+        initialEstimate.insert(isam.calculateEstimate());
+    }
+    const double timestamp = frame_num - 1;
+    gtsam::FixedLagSmoother::KeyTimestampMap timestamps;
+    for (const gtsam::Key key : initialEstimate.keys())
+    {
+        timestamps[key] = gtsam::Symbol(key).index();
+    }
+    for (const gtsam::Key key : {E(0), P(0)})
+    {
+        if (initialEstimate.exists(key) || smoother->timestamps().count(key))
+        {
+            timestamps[key] = timestamp;
+        }
+    }
+    smoother->update(gtSAMgraph, initialEstimate, timestamps);
+    gtSAMgraph.resize(0);
+    initialEstimate.clear();
+    smoother->update();
+    isamCurrentEstimate = smoother->calculateEstimate();
 }
+#endif
 
-EphemPtr GNSSAssignment::rinex_line2ephem(const std::vector<std::string> &ephem_lines)
+EphemPtr GNSSAssignment::rinex_line2ephem(const RinexLine *ephem_lines)
 {
-    LOG_IF(FATAL, ephem_lines.size() != 8) << "Ephemeris record should contain 8 lines";
     uint32_t sat_sys = SYS_NONE;
     if      (ephem_lines[0].at(0) == 'G')    sat_sys = SYS_GPS;
     else if (ephem_lines[0].at(0) == 'C')    sat_sys = SYS_BDS;
@@ -752,7 +1028,7 @@ EphemPtr GNSSAssignment::rinex_line2ephem(const std::vector<std::string> &ephem_
     LOG_IF(FATAL, sat_sys == SYS_NONE) << "Satellite system is not supported: " << ephem_lines[0].at(0);
 
     EphemPtr ephem(new Ephem());
-    uint32_t prn = static_cast<uint32_t>(std::stoi(ephem_lines[0].substr(1, 2)));
+    uint32_t prn = static_cast<uint32_t>(ephem_lines[0].toInt(1, 2));
     {
         ephem->sat = sat_no(sat_sys, prn);
     }
@@ -760,70 +1036,70 @@ EphemPtr GNSSAssignment::rinex_line2ephem(const std::vector<std::string> &ephem_
         ephem->sat = sat_no(sat_sys, prn);
     }
     double epoch[6];
-    epoch[0] = static_cast<double>(std::stoi(ephem_lines[0].substr(4, 4)));
-    epoch[1] = static_cast<double>(std::stoi(ephem_lines[0].substr(9, 2)));
-    epoch[2] = static_cast<double>(std::stoi(ephem_lines[0].substr(12, 2)));
-    epoch[3] = static_cast<double>(std::stoi(ephem_lines[0].substr(15, 2)));
-    epoch[4] = static_cast<double>(std::stoi(ephem_lines[0].substr(18, 2)));
-    epoch[5] = static_cast<double>(std::stoi(ephem_lines[0].substr(21, 2)));
+    epoch[0] = static_cast<double>(ephem_lines[0].toInt(4, 4));
+    epoch[1] = static_cast<double>(ephem_lines[0].toInt(9, 2));
+    epoch[2] = static_cast<double>(ephem_lines[0].toInt(12, 2));
+    epoch[3] = static_cast<double>(ephem_lines[0].toInt(15, 2));
+    epoch[4] = static_cast<double>(ephem_lines[0].toInt(18, 2));
+    epoch[5] = static_cast<double>(ephem_lines[0].toInt(21, 2));
     ephem->toc = epoch2time(epoch);
     if (sat_sys == SYS_BDS)     ephem->toc.time += 14;     // BDS-GPS time correction
-    ephem->af0 = str2double(ephem_lines[0].substr(23, 19));
-    ephem->af1 = str2double(ephem_lines[0].substr(42, 19));
-    ephem->af2 = str2double(ephem_lines[0].substr(61, 19));
+    ephem->af0 = ephem_lines[0].toDouble(23, 19);
+    ephem->af1 = ephem_lines[0].toDouble(42, 19);
+    ephem->af2 = ephem_lines[0].toDouble(61, 19);
 
     // the second line
     if (sat_sys == SYS_GPS)
-        ephem->iode  = str2double(ephem_lines[1].substr(4, 19));
-    ephem->crs       = str2double(ephem_lines[1].substr(23, 19));
-    ephem->delta_n   = str2double(ephem_lines[1].substr(42, 19));
-    ephem->M0        = str2double(ephem_lines[1].substr(61, 19));
+        ephem->iode  = ephem_lines[1].toDouble(4, 19);
+    ephem->crs       = ephem_lines[1].toDouble(23, 19);
+    ephem->delta_n   = ephem_lines[1].toDouble(42, 19);
+    ephem->M0        = ephem_lines[1].toDouble(61, 19);
 
     // the third line
-    ephem->cuc = str2double(ephem_lines[2].substr(4, 19));
-    ephem->e = str2double(ephem_lines[2].substr(23, 19));
-    ephem->cus = str2double(ephem_lines[2].substr(42, 19));
-    double sqrt_A = str2double(ephem_lines[2].substr(61, 19));
+    ephem->cuc = ephem_lines[2].toDouble(4, 19);
+    ephem->e = ephem_lines[2].toDouble(23, 19);
+    ephem->cus = ephem_lines[2].toDouble(42, 19);
+    double sqrt_A = ephem_lines[2].toDouble(61, 19);
     ephem->A = sqrt_A * sqrt_A;
 
     // the forth line
-    ephem->toe_tow = str2double(ephem_lines[3].substr(4, 19));
-    ephem->cic = str2double(ephem_lines[3].substr(23, 19));
-    ephem->OMG0 = str2double(ephem_lines[3].substr(42, 19));
-    ephem->cis = str2double(ephem_lines[3].substr(61, 19));
+    ephem->toe_tow = ephem_lines[3].toDouble(4, 19);
+    ephem->cic = ephem_lines[3].toDouble(23, 19);
+    ephem->OMG0 = ephem_lines[3].toDouble(42, 19);
+    ephem->cis = ephem_lines[3].toDouble(61, 19);
 
     // the fifth line
-    ephem->i0 = str2double(ephem_lines[4].substr(4, 19));
-    ephem->crc = str2double(ephem_lines[4].substr(23, 19));
-    ephem->omg = str2double(ephem_lines[4].substr(42, 19));
-    ephem->OMG_dot = str2double(ephem_lines[4].substr(61, 19));
+    ephem->i0 = ephem_lines[4].toDouble(4, 19);
+    ephem->crc = ephem_lines[4].toDouble(23, 19);
+    ephem->omg = ephem_lines[4].toDouble(42, 19);
+    ephem->OMG_dot = ephem_lines[4].toDouble(61, 19);
 
     // the sixth line
-    ephem->i_dot = str2double(ephem_lines[5].substr(4, 19));
+    ephem->i_dot = ephem_lines[5].toDouble(4, 19);
     if  (sat_sys == SYS_GAL)
     {
-        uint32_t ephe_source = static_cast<uint32_t>(str2double(ephem_lines[5].substr(23, 19)));
+        uint32_t ephe_source = static_cast<uint32_t>(ephem_lines[5].toDouble(23, 19));
         if (!(ephe_source & 0x01))  
         {
             // LOG(ERROR) << "not contain I/NAV E1-b info, skip this ephemeris";
             return ephem;   // only parse I/NAV E1-b ephemeris
         }
     }
-    ephem->week = static_cast<uint32_t>(str2double(ephem_lines[5].substr(42, 19)));
+    ephem->week = static_cast<uint32_t>(ephem_lines[5].toDouble(42, 19));
     if (sat_sys == SYS_GPS || sat_sys == SYS_GAL)     ephem->toe = gpst2time(ephem->week, ephem->toe_tow);
     else if (sat_sys == SYS_BDS)                      ephem->toe = bdt2time(ephem->week, ephem->toe_tow+14);
     // if (sat_sys == SYS_GAL)     ephem->toe = gst2time(ephem->week, ephem->toe_tow);
 
     // the seventh line
-    ephem->ura = str2double(ephem_lines[6].substr(4, 19));
-    ephem->health = static_cast<uint32_t>(str2double(ephem_lines[6].substr(23, 19)));
-    ephem->tgd[0] = str2double(ephem_lines[6].substr(42, 19));
+    ephem->ura = ephem_lines[6].toDouble(4, 19);
+    ephem->health = static_cast<uint32_t>(ephem_lines[6].toDouble(23, 19));
+    ephem->tgd[0] = ephem_lines[6].toDouble(42, 19);
     if (sat_sys == SYS_BDS || sat_sys == SYS_GAL)
-        ephem->tgd[1] = str2double(ephem_lines[6].substr(61, 19));
-    if (sat_sys == SYS_GPS)     ephem->iodc = str2double(ephem_lines[6].substr(61, 19));
+        ephem->tgd[1] = ephem_lines[6].toDouble(61, 19);
+    if (sat_sys == SYS_GPS)     ephem->iodc = ephem_lines[6].toDouble(61, 19);
 
     // the eighth line
-    double ttr_tow = str2double(ephem_lines[7].substr(4, 19));
+    double ttr_tow = ephem_lines[7].toDouble(4, 19);
     // GAL week = GST week + 1024 + rollover, already align with GPS week!!!
     if      (sat_sys == SYS_GPS || sat_sys == SYS_GAL)   ephem->ttr = gpst2time(ephem->week, ttr_tow);
     else if (sat_sys == SYS_BDS)   ephem->ttr = bdt2time(ephem->week, ttr_tow);
@@ -839,13 +1115,12 @@ EphemPtr GNSSAssignment::rinex_line2ephem(const std::vector<std::string> &ephem_
     return ephem;
 }
 
-GloEphemPtr GNSSAssignment::rinex_line2glo_ephem(const std::vector<std::string> &ephem_lines, const uint32_t gpst_leap_seconds)
+GloEphemPtr GNSSAssignment::rinex_line2glo_ephem(const RinexLine *ephem_lines, const uint32_t gpst_leap_seconds)
 {
-    LOG_IF(FATAL, ephem_lines.size() != 4) << "GLO ephemeris record should contain 8 lines";
     LOG_IF(FATAL, ephem_lines[0].at(0) != 'R') << "Not a valid GLO ephemeris record";
     GloEphemPtr glo_ephem(new GloEphem());
 
-    uint32_t prn = static_cast<uint32_t>(std::stoi(ephem_lines[0].substr(1, 2)));
+    uint32_t prn = static_cast<uint32_t>(ephem_lines[0].toInt(1, 2));
     {
         glo_ephem->sat = sat_no(SYS_GLO, prn);
     }
@@ -853,60 +1128,59 @@ GloEphemPtr GNSSAssignment::rinex_line2glo_ephem(const std::vector<std::string>
         glo_ephem->sat = sat_no(SYS_GLO, prn);
     }
     double epoch[6];
-    epoch[0] = static_cast<double>(std::stoi(ephem_lines[0].substr(4, 4)));
-    epoch[1] = static_cast<double>(std::stoi(ephem_lines[0].substr(9, 2)));
-    epoch[2] = static_cast<double>(std::stoi(ephem_lines[0].substr(12, 2)));
-    epoch[3] = static_cast<double>(std::stoi(ephem_lines[0].substr(15, 2)));
-    epoch[4] = static_cast<double>(std::stoi(ephem_lines[0].substr(18, 2)));
-    epoch[5] = static_cast<double>(std::stoi(ephem_lines[0].substr(21, 2)));
+    epoch[0] = static_cast<double>(ephem_lines[0].toInt(4, 4));
+    epoch[1] = static_cast<double>(ephem_lines[0].toInt(9, 2));
+    epoch[2] = static_cast<double>(ephem_lines[0].toInt(12, 2));
+    epoch[3] = static_cast<double>(ephem_lines[0].toInt(15, 2));
+    epoch[4] = static_cast<double>(ephem_lines[0].toInt(18, 2));
+    epoch[5] = static_cast<double>(ephem_lines[0].toInt(21, 2));
     glo_ephem->toe = epoch2time(epoch);
     glo_ephem->toe.time += gpst_leap_seconds;
-    glo_ephem->tau_n = -1.0 * str2double(ephem_lines[0].substr(23, 19));
-    glo_ephem->gamma = str2double(ephem_lines[0].substr(42, 19));
+    glo_ephem->tau_n = -1.0 * ephem_lines[0].toDouble(23, 19);
+    glo_ephem->gamma = ephem_lines[0].toDouble(42, 19);
 
     // the second line
-    glo_ephem->pos[0] = str2double(ephem_lines[1].substr(4, 19)) * 1e3;
-    glo_ephem->vel[0] = str2double(ephem_lines[1].substr(23, 19)) * 1e3;
-    glo_ephem->acc[0] = str2double(ephem_lines[1].substr(42, 19)) * 1e3;
-    glo_ephem->health = static_cast<uint32_t>(str2double(ephem_lines[1].substr(61, 19)));
+    glo_ephem->pos[0] = ephem_lines[1].toDouble(4, 19) * 1e3;
+    glo_ephem->vel[0] = ephem_lines[1].toDouble(23, 19) * 1e3;
+    glo_ephem->acc[0] = ephem_lines[1].toDouble(42, 19) * 1e3;
+    glo_ephem->health = static_cast<uint32_t>(ephem_lines[1].toDouble(61, 19));
 
     // the third line
-    glo_ephem->pos[1] = str2double(ephem_lines[2].substr(4, 19)) * 1e3;
-    glo_ephem->vel[1] = str2double(ephem_lines[2].substr(23, 19)) * 1e3;
-    glo_ephem->acc[1] = str2double(ephem_lines[2].substr(42, 19)) * 1e3;
-    glo_ephem->freqo  = static_cast<int>(str2double(ephem_lines[2].substr(61, 19)));
+    glo_ephem->pos[1] = ephem_lines[2].toDouble(4, 19) * 1e3;
+    glo_ephem->vel[1] = ephem_lines[2].toDouble(23, 19) * 1e3;
+    glo_ephem->acc[1] = ephem_lines[2].toDouble(42, 19) * 1e3;
+    glo_ephem->freqo  = static_cast<int>(ephem_lines[2].toDouble(61, 19));
 
     // the forth line
-    glo_ephem->pos[2] = str2double(ephem_lines[3].substr(4, 19)) * 1e3;
-    glo_ephem->vel[2] = str2double(ephem_lines[3].substr(23, 19)) * 1e3;
-    glo_ephem->acc[2] = str2double(ephem_lines[3].substr(42, 19)) * 1e3;
-    glo_ephem->age  = static_cast<uint32_t>(str2double(ephem_lines[3].substr(61, 19)));
+    glo_ephem->pos[2] = ephem_lines[3].toDouble(4, 19) * 1e3;
+    glo_ephem->vel[2] = ephem_lines[3].toDouble(23, 19) * 1e3;
+    glo_ephem->acc[2] = ephem_lines[3].toDouble(42, 19) * 1e3;
+    glo_ephem->age  = static_cast<uint32_t>(ephem_lines[3].toDouble(61, 19));
 
     return glo_ephem;
 }
 
-ObsPtr GNSSAssignment::rinex_line2obs(const std::string rinex_str, 
-    const std::map<uint8_t, std::vector<std::string>> &sys2type)
+ObsPtr GNSSAssignment::rinex_line2obs(const RinexLine &rinex_line, 
+    const std::map<uint8_t, std::vector<RinexObsType>> &sys2type)
 {
     ObsPtr obs;
-    uint8_t sys_char = rinex_str.at(0);
+    uint8_t sys_char = rinex_line.at(0);
     if (char2sys.count(sys_char) == 0)   return obs;
     obs.reset(new Obs());
     uint32_t sys = char2sys.at(sys_char);
-    uint32_t prn = static_cast<uint32_t>(std::stoi(rinex_str.substr(1, 2)));
+    uint32_t prn = static_cast<uint32_t>(rinex_line.toInt(1, 2));
     obs->sat = sat_no(sys, prn);
     std::map<double, uint32_t> freq2idx;
-    std::vector<std::string> date_types = sys2type.at(sys_char);
+    const std::vector<RinexObsType> &date_types = sys2type.at(sys_char);
     uint32_t line_offset = 3;
-    for (auto type : date_types)
+    for (const auto &type : date_types)
     {
-        std::string field_str = rinex_str.substr(line_offset, 14);
+        const uint32_t field_offset = line_offset;
         line_offset += 14 + 2;
-        if (field_str.find_first_not_of(' ') == std::string::npos)  continue;
-        const double field_value = stod(field_str);
-        std::stringstream ss;
-        ss << sys_char << type.at(1);
-        const double freq = type2freq.at(ss.str());
+        if (rinex_line.blank(field_offset, 14))  continue;
+        const double field_value = rinex_line.toDouble(field_offset, 14);
+        LOG_IF(FATAL, type.freq < 0) << "Unrecognized frequency of measurement type " << type.kind;
+        const double freq = type.freq;
         uint32_t freq_idx = static_cast<uint32_t>(-1);
         if (freq2idx.count(freq) == 0)
         {
@@ -919,16 +1193,16 @@ ObsPtr GNSSAssignment::rinex_line2obs(const std::string rinex_str,
             freq_idx = freq2idx.at(freq);
         }
         
-        if (type.at(0) == 'L')
+        if (type.kind == 'L')
             obs->cp[freq_idx] = field_value;
-        else if (type.at(0) == 'C')
+        else if (type.kind == 'C')
             obs->psr[freq_idx] = field_value;
-        else if (type.at(0) == 'D')
+        else if (type.kind == 'D')
             obs->dopp[freq_idx] = field_value;
-        else if (type.at(0) == 'S')
+        else if (type.kind == 'S')
             obs->CN0[freq_idx] = field_value;
         else
-            LOG(FATAL) << "Unrecognized measurement type " << type.at(0);
+            LOG(FATAL) << "Unrecognized measurement type " << type.kind;
     }
     // fill in other fields
     uint32_t num_freqs = obs->freqs.size();
@@ -957,60 +1231,178 @@ ObsPtr GNSSAssignment::rinex_line2obs(const std::string rinex_str,
 }
 
 // TODO: GLONASS slot number
-void GNSSAssignment::rinex2obs(const std::string &rinex_filepath, std::queue<std::vector<ObsPtr>> &rinex_meas)
+void GNSSAssignment::rinex2obs(const std::string &rinex_filepath, std::vector<std::vector<ObsPtr>> &rinex_meas)
 {
-    std::ifstream obs_file(rinex_filepath);
-    std::string rinex_line;
+    MappedFile obs_file(rinex_filepath);
+    if (!obs_file.valid())
+    {
+        LOG(ERROR) << "Cannot open RINEX file " << rinex_filepath;
+        return;
+    }
+    RinexLineReader reader(obs_file);
+    RinexLine rinex_line;
 
     // parse header
-    std::map<uint8_t, std::vector<std::string>> sys2type;
+    std::map<uint8_t, std::vector<RinexObsType>> sys2type;
     uint8_t sys_char = 0;
     
-    while (std::getline(obs_file, rinex_line))
+    while (reader.next(rinex_line))
     {
-        if (rinex_line.find("RINEX VERSION / TYPE") != std::string::npos && rinex_line.find("3.04") == std::string::npos)
+        if (rinex_line.contains("RINEX VERSION / TYPE") && !rinex_line.contains("3.04"))
         {
             LOG(ERROR) << "Only RINEX 3.04 is supported for observation file";
             return;
         }
-        else if (rinex_line.find("SYS / # / OBS TYPES") != std::string::npos)
+        else if (rinex_line.contains("SYS / # / OBS TYPES"))
         {
             if (rinex_line.at(0) != ' ')
             {
                 sys_char = rinex_line.at(0);
-                sys2type.emplace(sys_char, std::vector<std::string>());
+                sys2type.emplace(sys_char, std::vector<RinexObsType>());
             }
             for (size_t i = 0; i < 13; ++i)
-                if (rinex_line.substr(7+4*i, 3) != "   ")
-                    sys2type.at(sys_char).emplace_back(rinex_line.substr(7+4*i, 3));
+            {
+                if (rinex_line.blank(7+4*i, 3))
+                    continue;
+                // the frequency of the band is looked up once here instead of for every field
+                const std::string band{static_cast<char>(sys_char), rinex_line.at(8+4*i)};
+                const double freq = type2freq.count(band) ? type2freq.at(band) : -1.0;
+                sys2type.at(sys_char).push_back(RinexObsType{rinex_line.at(7+4*i), freq});
+            }
         }
-        else if (rinex_line.find("END OF HEADER") != std::string::npos)  break;
+        else if (rinex_line.contains("END OF HEADER"))  break;
     }
 
-    while (std::getline(obs_file, rinex_line))
+    while (reader.next(rinex_line))
     {
-        LOG_IF(FATAL, rinex_line.at(0) != '>') << "Invalid Observation record " << rinex_line;
+        LOG_IF(FATAL, rinex_line.at(0) != '>') << "Invalid Observation record " << std::string(rinex_line.ptr, rinex_line.len);
         LOG_IF(FATAL, rinex_line.at(31) != '0') << "Invalid Epoch data " << rinex_line.at(31)-48;
-        std::vector<double> epoch_time;
-        epoch_time.emplace_back(std::stod(rinex_line.substr(2, 4)));
-        epoch_time.emplace_back(std::stod(rinex_line.substr(7, 2)));
-        epoch_time.emplace_back(std::stod(rinex_line.substr(10, 2)));
-        epoch_time.emplace_back(std::stod(rinex_line.substr(13, 2)));
-        epoch_time.emplace_back(std::stod(rinex_line.substr(16, 2)));
-        epoch_time.emplace_back(std::stod(rinex_line.substr(18, 11)));
-        gtime_t obs_time = epoch2time(&(epoch_time[0]));
-        const int num_obs = std::stoi(rinex_line.substr(32, 3));
+        double epoch_time[6];
+        epoch_time[0] = rinex_line.toDouble(2, 4);
+        epoch_time[1] = rinex_line.toDouble(7, 2);
+        epoch_time[2] = rinex_line.toDouble(10, 2);
+        epoch_time[3] = rinex_line.toDouble(13, 2);
+        epoch_time[4] = rinex_line.toDouble(16, 2);
+        epoch_time[5] = rinex_line.toDouble(18, 11);
+        gtime_t obs_time = epoch2time(epoch_time);
+        const int num_obs = rinex_line.toInt(32, 3);
         std::vector<ObsPtr> meas;
+        meas.reserve(num_obs);
         for (int i = 0; i < num_obs; ++i)
         {
-            LOG_IF(FATAL, !std::getline(obs_file, rinex_line)) << "Incomplete RINEX file";
+            LOG_IF(FATAL, !reader.next(rinex_line)) << "Incomplete RINEX file";
             ObsPtr obs = rinex_line2obs(rinex_line, sys2type);
             if (!obs || obs->freqs.empty())  continue;
             obs->time = obs_time;
             meas.emplace_back(obs);
         }
-        rinex_meas.push(meas); // only GPS and BDS?
+        rinex_meas.push_back(std::move(meas)); // only GPS and BDS?
+    }
+}
+
+bool GNSSAssignment::loadRinexObsCache(const std::string &rinex_filepath, std::vector<std::vector<ObsPtr>> &rinex_meas)
+{
+    MappedFile file(rinex_filepath + ".bin");
+    if (!file.valid())
+        return false;
+    RinexCacheReader reader(file);
+    RinexCacheHeader header;
+    if (!reader.read(&header) || !rinexCacheValid(rinex_filepath, header, "RNXO"))
+        return false;
+
+    std::vector<std::vector<ObsPtr>> epochs(header.num_records);
+    std::vector<double> fields;
+    for (auto &meas : epochs)
+    {
+        int64_t time = 0;
+        double sec = 0;
+        uint32_t num_obs = 0;
+        if (!reader.read(&time) || !reader.read(&sec) || !reader.read(&num_obs))
+            return false;
+        meas.reserve(num_obs);
+        for (uint32_t i = 0; i < num_obs; ++i)
+        {
+            uint32_t sat = 0, num_freqs = 0;
+            if (!reader.read(&sat) || !reader.read(&num_freqs))
+                return false;
+            fields.resize(RINEX_OBS_FIELDS * num_freqs);
+            if (!reader.read(fields.data(), fields.size()))
+                return false;
+
+            ObsPtr obs(new Obs());
+            obs->time.time = time;
+            obs->time.sec = sec;
+            obs->sat = sat;
+            auto field = [&](size_t k) { return fields.begin() + k * num_freqs; };
+            obs->freqs.assign(field(0), field(1));
+            obs->CN0.assign(field(1), field(2));
+            obs->LLI.assign(field(2), field(3));
+            obs->code.assign(field(3), field(4));
+            obs->psr.assign(field(4), field(5));
+            obs->psr_std.assign(field(5), field(6));
+            obs->cp.assign(field(6), field(7));
+            obs->cp_std.assign(field(7), field(8));
+            obs->dopp.assign(field(8), field(9));
+            obs->dopp_std.assign(field(9), field(10));
+            obs->status.assign(field(10), field(11));
+            meas.emplace_back(obs);
+        }
+    }
+    if (!reader.end())
+        return false;
+
+    rinex_meas.insert(rinex_meas.end(), epochs.begin(), epochs.end());
+    return true;
+}
+
+void GNSSAssignment::saveRinexObsCache(const std::string &rinex_filepath, const std::vector<std::vector<ObsPtr>> &rinex_meas)
+{
+    RinexCacheHeader header;
+    FILE *file = openRinexCache(rinex_filepath, header, "RNXO");
+    if (file == nullptr)
+    {
+        LOG(WARNING) << "Cannot write the RINEX cache of " << rinex_filepath;
+        return;
+    }
+    header.num_records = rinex_meas.size();
+    fwrite(&header, sizeof(header), 1, file);
+
+    std::vector<double> fields;
+    for (const auto &meas : rinex_meas)
+    {
+        const int64_t time = meas.empty() ? 0 : meas.front()->time.time;
+        const double sec = meas.empty() ? 0 : meas.front()->time.sec;
+        const uint32_t num_obs = meas.size();
+        fwrite(&time, sizeof(time), 1, file);
+        fwrite(&sec, sizeof(sec), 1, file);
+        fwrite(&num_obs, sizeof(num_obs), 1, file);
+        for (const auto &obs : meas)
+        {
+            const uint32_t num_freqs = obs->freqs.size();
+            fields.clear();
+            auto append = [&](const auto &values)
+            {
+                for (uint32_t k = 0; k < num_freqs; ++k)
+                    fields.push_back(k < values.size() ? values[k] : 0);
+            };
+            append(obs->freqs);
+            append(obs->CN0);
+            append(obs->LLI);
+            append(obs->code);
+            append(obs->psr);
+            append(obs->psr_std);
+            append(obs->cp);
+            append(obs->cp_std);
+            append(obs->dopp);
+            append(obs->dopp_std);
+            append(obs->status);
+            const uint32_t sat = obs->sat;
+            fwrite(&sat, sizeof(sat), 1, file);
+            fwrite(&num_freqs, sizeof(num_freqs), 1, file);
+            fwrite(fields.data(), sizeof(double), fields.size(), file);
+        }
     }
+    closeRinexCache(rinex_filepath, file);
 }
 
 // int GNSSAssignment::satno_rtk(int sys, int prn)
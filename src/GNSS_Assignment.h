@@ -45,6 +45,7 @@
 #include <gnss_comm/gnss_ros.hpp>
 #include <common_lib.h>
 #include <numeric>
+#include <unordered_map>
 #include <opencv2/core/eigen.hpp>
 #include <gtsam/inference/Symbol.h>
 #include <gtsam/nonlinear/Values.h>
@@ -58,7 +59,15 @@
 #include <gtsam/nonlinear/NonlinearEquality.h>
 #include <gtsam/nonlinear/LevenbergMarquardtOptimizer.h>
 #include <gtsam/nonlinear/ISAM2.h>
+#ifdef GNSS_FIXED_LAG_SMOOTHER
+#if __has_include(<gtsam/nonlinear/IncrementalFixedLagSmoother.h>)
+#include <gtsam/nonlinear/IncrementalFixedLagSmoother.h>
+#else
+#include <gtsam_unstable/nonlinear/IncrementalFixedLagSmoother.h>
+#endif
+#endif
 #include <fstream>
+#include "RinexReader.h"
 
 #include <gnss_factor/gnss_cp_factor_nor.hpp>
 // #include <gnss_factor/gnss_cp_factor_pos.hpp>
@@ -73,12 +82,92 @@
 #include <gnss_factor/gnss_lio_factor_nolidar.hpp>
 #include <gnss_factor/gnss_prior_factor.hpp>
 #include <gnss_factor/gnss_psr_dopp_factor_nor.hpp>
+#include <gnss_factor/gnss_psr_dopp_epoch_factor.hpp>
 // #include <gnss_factor/gnss_psr_dopp_factor_pos.hpp>
 #include <gnss_factor/gnss_psr_dopp_factor_nolidar.hpp>
 // #include <gnss_factor/gnss_psr_dopp_factor_nolidar_pos.hpp>
 
 using namespace gnss_comm;
 
+// satellite position, velocity and clock at the signal transmission time of one observation
+struct SvState
+{
+    EphemBasePtr ephem;
+    Eigen::Vector3d pos;
+    Eigen::Vector3d vel;
+    double svdt = 0, svddt = 0;
+};
+
+#define SV_STATE_EPOCHS (4) // epochs kept in the satellite state cache
+
+// ephemerides of each satellite sorted by toe, the nearest one is found by binary search
+class EphemStore
+{
+public:
+    // append one ephemeris, false if the satellite already has one with the same toe
+    bool insert(const EphemBasePtr &ephem)
+    {
+        const double toe = time2sec(ephem->toe);
+        std::vector<Entry> &entries = sat2entries[ephem->sat];
+        if (entries.empty() || entries.back().toe < toe)
+        {
+            entries.push_back(Entry{toe, ephem});
+            return true;
+        }
+        auto it = std::lower_bound(entries.begin(), entries.end(), toe, [](const Entry &entry, double t)
+                                   { return entry.toe < t; });
+        if (it != entries.end() && it->toe == toe)
+            return false;
+        entries.insert(it, Entry{toe, ephem});
+        return true;
+    }
+
+    // bulk load, e.g. a whole rinex navigation file, sorted once per satellite
+    void load(const std::map<uint32_t, std::vector<EphemBasePtr>> &sat2ephem)
+    {
+        for (const auto &sat_ephems : sat2ephem)
+        {
+            std::vector<Entry> &entries = sat2entries[sat_ephems.first];
+            entries.reserve(entries.size() + sat_ephems.second.size());
+            for (const auto &ephem : sat_ephems.second)
+                entries.push_back(Entry{time2sec(ephem->toe), ephem});
+            // the first ephemeris of a toe is kept
+            std::stable_sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+                             { return a.toe < b.toe; });
+            entries.erase(std::unique(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+                                      { return a.toe == b.toe; }), entries.end());
+        }
+    }
+
+    bool has(uint32_t sat) const { return sat2entries.count(sat) > 0; }
+
+    // the ephemeris closest to time (the earlier one on a tie), nullptr if none is closer than max_diff
+    EphemBasePtr nearest(uint32_t sat, double time, double max_diff) const
+    {
+        auto sat_it = sat2entries.find(sat);
+        if (sat_it == sat2entries.end() || sat_it->second.empty())
+            return nullptr;
+        const std::vector<Entry> &entries = sat_it->second;
+        auto it = std::lower_bound(entries.begin(), entries.end(), time, [](const Entry &entry, double t)
+                                   { return entry.toe < t; });
+        if (it == entries.end() || (it != entries.begin() && time - (it - 1)->toe <= it->toe - time))
+            --it;
+        if (std::abs(it->toe - time) >= max_diff)
+            return nullptr;
+        return it->ephem;
+    }
+
+    void clear() { sat2entries.clear(); }
+
+private:
+    struct Entry
+    {
+        double toe;
+        EphemBasePtr ephem;
+    };
+    std::unordered_map<uint32_t, std::vector<Entry>> sat2entries;
+};
+
 using gtsam::symbol_shorthand::R; // Pose3 ()
 using gtsam::symbol_shorthand::P; // Pose3 (x,y,z,r,p,y)
 // using gtsam::symbol_shorthand::V; // Vel   (xdot,ydot,zdot)
@@ -93,18 +182,6 @@ using gtsam::symbol_shorthand::G; // pos, vel
 // using gtsam::symbol_shorthand::Y; // local enu (yaw)
 // using gtsam::symbol_shorthand::A; // anchor point (anc) total = 18 dimensions
 
-struct sat_first
-{
-    double timecur;
-    Eigen::Vector3d RTex;
-    int frame_num;
-
-    bool operator <(const sat_first &s) const
-    {
-        return (timecur < s.timecur);
-    }
-};
-
 class GNSSAssignment
 {
     public:
@@ -175,22 +252,27 @@ class GNSSAssignment
         int change_ext = 1;
         std::deque<std::vector<size_t>> factor_id_frame; // 
 
-        std::map<uint32_t, std::vector<EphemBasePtr>> sat2ephem;
-        std::map<uint32_t, std::vector<EphemBasePtr>> sat2ephem_rnx;
+        EphemStore ephem_store;     // ephemerides received online
+        EphemStore ephem_store_rnx; // ephemerides from the rinex navigation file
         std::vector<double> latest_gnss_iono_params;
+        ligo::AtmosParamsPtr atmos_params; // iono params of the latest factors
+        double atmos_update_thres = 0.1;
         bool ephem_from_rinex = false;
         bool obs_from_rinex = false;
         bool pvt_is_gt = true;
-        std::map<uint32_t, std::map<double, size_t>> sat2time_index;
-        std::map<uint32_t, std::map<double, size_t>> sat2time_index_rnx;
+        bool rinex_cache = false; // load the rinex files from / save them to a binary sidecar "<file>.bin"
         void Ephemfromrinex(const std::string &rinex_filepath);
         void inputEphem(EphemBasePtr ephem_ptr);
-        void rinex2iono_params(const std::string &rinex_filepath, std::vector<double> &iono_params);
+        bool rinex2iono_params(const std::string &rinex_filepath, std::vector<double> &iono_params);
         void rinex2ephems(const std::string &rinex_filepath, std::map<uint32_t, std::vector<EphemBasePtr>> &sat2ephem_);
         void Obsfromrinex(const std::string &rinex_filepath, std::queue<std::vector<ObsPtr>> &rinex_meas);
         int freq_idx_ = 0;
-        ObsPtr rinex_line2obs(const std::string rinex_str, const std::map<uint8_t, std::vector<std::string>> &sys2type);
-        void rinex2obs(const std::string &rinex_filepath, std::queue<std::vector<ObsPtr>> &rinex_meas);
+        ObsPtr rinex_line2obs(const RinexLine &rinex_line, const std::map<uint8_t, std::vector<RinexObsType>> &sys2type);
+        void rinex2obs(const std::string &rinex_filepath, std::vector<std::vector<ObsPtr>> &rinex_meas);
+        bool loadRinexNavCache(const std::string &rinex_filepath, std::map<uint32_t, std::vector<EphemBasePtr>> &sat2ephem_, std::vector<double> &iono_params);
+        void saveRinexNavCache(const std::string &rinex_filepath, const std::map<uint32_t, std::vector<EphemBasePtr>> &sat2ephem_, const std::vector<double> &iono_params, bool has_iono);
+        bool loadRinexObsCache(const std::string &rinex_filepath, std::vector<std::vector<ObsPtr>> &rinex_meas);
+        void saveRinexObsCache(const std::string &rinex_filepath, const std::vector<std::vector<ObsPtr>> &rinex_meas);
         // int satno_rtk(int sys, int prn);
         double gnss_psr_std_threshold = 30.0;
         double gnss_dopp_std_threshold = 30.0;
@@ -205,10 +287,18 @@ class GNSSAssignment
         // std::map<uint32_t, double> hatch_filter_noise; //
         std::map<uint32_t, double> last_cp_meas; //
         double gnss_elevation_threshold = 30;
+        std::map<double, std::map<uint32_t, SvState>> sv_state_cache; // epoch time -> sat -> state
+        const SvState &svState(const ObsPtr &obs, const EphemBasePtr &ephem);
+        void fillSvStates(const std::vector<ObsPtr> &gnss_meas, const std::vector<EphemBasePtr> &ephems);
         void processGNSSBase(const std::vector<ObsPtr> &gnss_meas, std::vector<double> &psr_meas, std::vector<ObsPtr> &valid_meas, std::vector<EphemBasePtr> &valid_ephems, bool gnss_ready, Eigen::Vector3d ecef_pos, double last_gnss_time_process);
         void delete_variables(bool nolidar, size_t frame_delete, int frame_num, size_t &id_accumulate, gtsam::FactorIndices delete_factor);
 
-        double str2double(const std::string &num_str);
-        EphemPtr rinex_line2ephem(const std::vector<std::string> &ephem_lines);
-        GloEphemPtr rinex_line2glo_ephem(const std::vector<std::string> &ephem_lines, const uint32_t gpst_leap_seconds);
+        bool fixed_lag = false; // marginalize the frames leaving the window instead of deleting their factors, needs GNSS_FIXED_LAG_SMOOTHER
+#ifdef GNSS_FIXED_LAG_SMOOTHER
+        void update_fixed_lag(int frame_num, int window);
+        std::shared_ptr<gtsam::IncrementalFixedLagSmoother> smoother;
+#endif
+
+        EphemPtr rinex_line2ephem(const RinexLine *ephem_lines);
+        GloEphemPtr rinex_line2glo_ephem(const RinexLine *ephem_lines, const uint32_t gpst_leap_seconds);
 };
\ No newline at end of file
@@ -35,6 +35,7 @@
  */
 
 #include "GNSS_Processing_fg.h"
+#include <backend_optimization/utility/Timer.h>
 
 GNSSProcess::GNSSProcess()
     : diff_t_gnss_local(0.0)
@@ -48,8 +49,7 @@ GNSSProcess::~GNSSProcess() {}
 void GNSSProcess::Reset() 
 {
   ROS_WARN("Reset GNSSProcess");
-  std::map<sat_first, std::map<uint32_t, double[6]>> empty_map_c;
-  sat2cp.swap(empty_map_c);
+  std::map<uint32_t, CpHistory>().swap(sat2cp);
   // sat2time_index.swap(empty_map_i);
   // sat2ephem.swap(empty_map_e);
   for (size_t i = 0; i < WINDOW_SIZE+1; i++)
@@ -67,6 +67,7 @@ void GNSSProcess::Reset()
   p_assign->sat_track_last_time.swap(empty_map_st);
   p_assign->hatch_filter_meas.swap(empty_map_st);
   p_assign->last_cp_meas.swap(empty_map_st);
+  std::map<double, std::map<uint32_t, SvState>>().swap(p_assign->sv_state_cache);
   p_assign->gtSAMgraph.resize(0); 
   p_assign->initialEstimate.clear();
   p_assign->isamCurrentEstimate.clear();
@@ -94,6 +95,35 @@ void GNSSProcess::Reset()
   parameters.relinearizeThreshold = 0.1;
   parameters.relinearizeSkip = 5; // may matter? improtant!
   p_assign->isam = gtsam::ISAM2(parameters);
+#ifdef GNSS_FIXED_LAG_SMOOTHER
+  p_assign->smoother.reset();
+#endif
+  opt_time_sum = 0.0;
+  opt_time_max = 0.0;
+  opt_time_num = 0;
+  sqrt_info_time_sum = 0.0;
+}
+
+void GNSSProcess::updateOptStatistics(double cost_ms)
+{
+  opt_time_sum += cost_ms;
+  opt_time_max = std::max(opt_time_max, cost_ms);
+  opt_time_num ++;
+  if (opt_time_num < opt_stat_period)  return;
+
+  printf("[gnss] frame %d: isam2 update avg %.2f ms, max %.2f ms, lidar sqrt info avg %.3f ms over %d epochs, %lu variables in the graph\n",
+         frame_num, opt_time_sum / opt_time_num, opt_time_max, sqrt_info_time_sum / opt_time_num, opt_time_num, p_assign->isamCurrentEstimate.size());
+  opt_time_sum = 0.0;
+  opt_time_max = 0.0;
+  opt_time_num = 0;
+  sqrt_info_time_sum = 0.0;
+}
+
+void GNSSProcess::setLidarCov(const Eigen::Matrix<double, 24, 24> &cov)
+{
+  Timer timer;
+  sqrt_lidar = esekfom::sqrt_information<double, 24>(cov);
+  sqrt_info_time_sum += timer.elapsedLast();
 }
 
 void GNSSProcess::inputIonoParams(double ts, const std::vector<double> &iono_params) 
@@ -229,6 +259,22 @@ void GNSSProcess::runISAM2opt(void) //
   gtsam::FactorIndices delete_factor;
   gtsam::FactorIndices().swap(delete_factor);
 
+  Timer timer;
+  // like the window of isam, the smoother only starts once the gnss is initialized
+  const bool use_smoother = p_assign->fixed_lag && gnss_ready;
+#ifdef GNSS_FIXED_LAG_SMOOTHER
+  if (use_smoother)
+  {
+    // keep frame_delete and factor_id_frame in step with the frames marginalized by the smoother
+    while (frame_num - frame_delete > delete_thred && !p_assign->factor_id_frame.empty())
+    {
+      p_assign->factor_id_frame.pop_front();
+      frame_delete ++;
+    }
+    p_assign->update_fixed_lag(frame_num, delete_thred);
+  }
+  else
+#endif
   if (gnss_ready)
   {
     bool delete_happen = false;
@@ -276,25 +322,19 @@ void GNSSProcess::runISAM2opt(void) //
     p_assign->initialEstimate.clear();
     p_assign->isam.update();
   }
-  p_assign->isamCurrentEstimate = p_assign->isam.calculateEstimate();
+  if (!use_smoother)
+  {
+    p_assign->isamCurrentEstimate = p_assign->isam.calculateEstimate();
+  }
+  updateOptStatistics(timer.elapsedLast());
   
   if (nolidar) // || invalid_lidar)
   {
     pre_integration->repropagate(p_assign->isamCurrentEstimate.at<gtsam::Vector12>(F(frame_num-1)).segment<3>(6),
                                 p_assign->isamCurrentEstimate.at<gtsam::Vector12>(F(frame_num-1)).segment<3>(9));
   }
-  std::map<sat_first, std::map<uint32_t, double[6]>>::iterator it_old;
-  if (!sat2cp.empty())
-  {
-    it_old = sat2cp.begin();
-    while (it_old->first.frame_num < frame_delete)
-    {
-      std::map<uint32_t, double[6]>().swap(it_old->second);
-      size_t del_size = sat2cp.erase(it_old->first);
-      if (sat2cp.empty()) break;
-      it_old = sat2cp.begin();
-    }
-  }
+  evictCp([this](const CpSample &sample)
+          { return sample.frame_num < frame_delete; });
 }
 
 bool GNSSProcess::GNSSLIAlign()
@@ -612,20 +652,15 @@ void GNSSProcess::GnssPsrDoppMeas(const ObsPtr &obs_, const EphemBasePtr &ephem_
 
   // 获取卫星的系统类型（如 GPS, GLONASS, Galileo等）
   uint32_t sys = satsys(obs_->sat, NULL);
-  // 计算传播时间，即从卫星到接收器的传播延时（单位：秒）
-  double tof = obs_->psr[freq_idx] / LIGHT_SPEED;
-  // 根据传播时间计算卫星的传输时间
-  gtime_t sv_tx = time_add(obs_->time, -tof);
 
+  // 卫星的位置、速度和钟差在本历元只计算一次，从缓存中读取
+  const SvState &sv_state = p_assign->svState(obs_, ephem_);
+  sv_pos = sv_state.pos;
+  sv_vel = sv_state.vel;
+  svdt = sv_state.svdt;
+  svddt = sv_state.svddt;
   if (sys == SYS_GLO)
   {
-      GloEphemPtr glo_ephem = std::dynamic_pointer_cast<GloEphem>(ephem_);
-      // 计算卫星的传播延迟（svdt），并调整传输时间
-      svdt = geph2svdt(sv_tx, glo_ephem);
-      sv_tx = time_add(sv_tx, -svdt);
-      // 计算卫星的位置和速度
-      sv_pos = geph2pos(sv_tx, glo_ephem, &svdt);
-      sv_vel = geph2vel(sv_tx, glo_ephem, &svddt);
       // GLONASS的TGD（卫星的群延迟）设为0.0（固定值）
       tgd = 0.0;
       // 根据测量标准差计算位置的误差（单位：m）
@@ -635,13 +670,6 @@ void GNSSProcess::GnssPsrDoppMeas(const ObsPtr &obs_, const EphemBasePtr &ephem_
   else
   {
       EphemPtr eph = std::dynamic_pointer_cast<Ephem>(ephem_);
-      // 计算卫星的传播延迟（svdt）
-      svdt = eph2svdt(sv_tx, eph); // 用于计算传播延迟
-      sv_tx = time_add(sv_tx, -svdt);
-      // 计算卫星的位置
-      sv_pos = eph2pos(sv_tx, eph, &svdt); // 用于计算位置
-      // 计算卫星的速度
-      sv_vel = eph2vel(sv_tx, eph, &svddt); // 用于计算速度
       // 提取卫星的群延迟（TGD），并进行修正
       tgd = eph->tgd[0];
       // 如果是 Galileo 系统，根据 URA（伪距精度）和标准差计算误差
@@ -669,37 +697,12 @@ void GNSSProcess::SvPosCals(const ObsPtr &obs_, const EphemBasePtr &ephem_)
   freq = L1_freq(obs_, &freq_idx);
   LOG_IF(FATAL, freq < 0) << "No L1 observation found.";
 
-  // 获取卫星的系统类型（GPS、GLONASS 等）
-  uint32_t sys = satsys(obs_->sat, NULL);
-  // 根据 L1 频率的伪距（`psr`）计算信号传播时间（时间偏移）
-  double tof = obs_->psr[freq_idx] / LIGHT_SPEED;
-  // 根据传播时间计算卫星的发射时间（`sv_tx`）
-  gtime_t sv_tx = time_add(obs_->time, -tof);
-
-  if (sys == SYS_GLO)
-  {
-      GloEphemPtr glo_ephem = std::dynamic_pointer_cast<GloEphem>(ephem_);
-      // 计算 GLONASS 卫星的时钟偏移（`svdt`）
-      svdt = geph2svdt(sv_tx, glo_ephem);
-      // 根据时钟偏移修正卫星的发射时间
-      sv_tx = time_add(sv_tx, -svdt);
-      // 计算卫星的位置（`sv_pos`）
-      sv_pos = geph2pos(sv_tx, glo_ephem, &svdt);
-      // 计算卫星的速度（`sv_vel`）
-      sv_vel = geph2vel(sv_tx, glo_ephem, &svddt);
-  }
-  else
-  {
-      EphemPtr eph = std::dynamic_pointer_cast<Ephem>(ephem_);
-      // 计算卫星的时钟偏移（`svdt`）
-      svdt = eph2svdt(sv_tx, eph); // used in eva
-      // 根据时钟偏移修正卫星的发射时间
-      sv_tx = time_add(sv_tx, -svdt);
-      // 计算卫星的位置（`sv_pos`）
-      sv_pos = eph2pos(sv_tx, eph, &svdt); // used in eva
-      // 计算卫星的速度（`sv_vel`）
-      sv_vel = eph2vel(sv_tx, eph, &svddt); // used in eva
-  }
+  // 卫星在发射时刻的位置（`sv_pos`）、速度（`sv_vel`）和时钟偏移（`svdt`），从缓存中读取
+  const SvState &sv_state = p_assign->svState(obs_, ephem_);
+  sv_pos = sv_state.pos;
+  sv_vel = sv_state.vel;
+  svdt = sv_state.svdt;
+  svddt = sv_state.svddt;
 }
 
 bool GNSSProcess::Evaluate(state_output &state)
@@ -802,18 +805,8 @@ bool GNSSProcess::Evaluate(state_output &state)
     state.gravity = p_assign->isamCurrentEstimate.at<gtsam::Rot3>(P(0)).matrix().transpose() * ecef2rotation(p_assign->isamCurrentEstimate.at<gtsam::Vector3>(E(0))) * gravity_init;
   }    
   last_gnss_time = time_current;
-  std::map<sat_first, std::map<uint32_t, double[6]>>::iterator it_old;
-  if (!sat2cp.empty())
-  {
-    it_old = sat2cp.begin();
-    while (time_current - it_old->first.timecur > gnss_cp_time_threshold)
-    {
-      std::map<uint32_t, double[6]>().swap(it_old->second);
-      size_t del_size = sat2cp.erase(it_old->first);
-      if (sat2cp.empty()) break;
-      it_old = sat2cp.begin();
-    }
-  }
+  evictCp([this, time_current](const CpSample &sample)
+          { return time_current - sample.time > gnss_cp_time_threshold; });
   return true;
 }
 
@@ -827,22 +820,24 @@ bool GNSSProcess::AddFactor(gtsam::Rot3 rel_rot, gtsam::Point3 rel_pos, gtsam::V
   invalid_lidar = false;
   if (!nolidar)
   {
+    int &feat_num = queued_epoch ? epoch_feat_num : p_assign->process_feat_num;
+    int &norm_num = queued_epoch ? epoch_norm_num : norm_vec_num;
     double weight_lid = 1;
-    if (p_assign->process_feat_num < 10) 
+    if (feat_num < 10) 
     {
       weight_lid = 0;
       invalid_lidar = true;
     }
     else
     {
-      if (norm_vec_num < 10)
+      if (norm_num < 10)
       {
         invalid_lidar = true;
       }
-      weight_lid = 2 * double(norm_vec_num) / double(p_assign->process_feat_num);
+      weight_lid = 2 * double(norm_num) / double(feat_num);
     }
-    norm_vec_num = 0;
-    p_assign->process_feat_num = 0;
+    norm_num = 0;
+    feat_num = 0;
     double weight_check1 =  sqrt_lidar(0, 0) < sqrt_lidar(1, 1) ? sqrt_lidar(0, 0) : sqrt_lidar(1, 1);
     weight_check1 = weight_check1 < sqrt_lidar(2, 2) ? weight_check1 : sqrt_lidar(2, 2); 
     double weight_check2 = sqrt_lidar(0, 0) > sqrt_lidar(1, 1) ? sqrt_lidar(0, 0) : sqrt_lidar(1, 1);
@@ -867,7 +862,8 @@ bool GNSSProcess::AddFactor(gtsam::Rot3 rel_rot, gtsam::Point3 rel_pos, gtsam::V
     // Reset();
     // return false;
   // }
-  if (nolidar_cur && !nolidar) nolidar_cur = false;
+  // queued epochs run in the backend thread, which must not touch nolidar_cur (written by the main thread)
+  if (!queued_epoch && nolidar_cur && !nolidar) nolidar_cur = false; // reset by GraphBackend when the epoch was queued
   rcv_ddt = p_assign->isamCurrentEstimate.at<gtsam::Vector1>(C(frame_num-1))[0];
   rcv_dt[0] = p_assign->isamCurrentEstimate.at<gtsam::Vector4>(B(frame_num-1))[0] + rcv_ddt * delta_t;
   rcv_dt[1] = p_assign->isamCurrentEstimate.at<gtsam::Vector4>(B(frame_num-1))[1] + rcv_ddt * delta_t;
@@ -878,8 +874,6 @@ bool GNSSProcess::AddFactor(gtsam::Rot3 rel_rot, gtsam::Point3 rel_pos, gtsam::V
   const std::vector<EphemBasePtr> &curr_ephem = gnss_ephem_buf[0];
 
   // find best sat in the current gnss measurements
-  std::map<sat_first, std::map<uint32_t, double[6]> >::reverse_iterator it;
-  
   std::deque<uint32_t> pair_sat_copy;
   // std::deque<uint32_t>().swap(pair_sat_copy);
 
@@ -892,7 +886,6 @@ bool GNSSProcess::AddFactor(gtsam::Rot3 rel_rot, gtsam::Point3 rel_pos, gtsam::V
   
   for (uint32_t j = 0; j < curr_obs.size(); j++) //   && j < 10
   {
-    std::map<uint32_t, double[6]>::iterator it_old; // t_old_best, 
     double meas;
     // double meas_cov;
     double meas_time;
@@ -907,29 +900,24 @@ bool GNSSProcess::AddFactor(gtsam::Rot3 rel_rot, gtsam::Point3 rel_pos, gtsam::V
       // if (curr_obs[j]->cp[freq_idx] > 10)
       {
         bool cp_found = false;
-        for (it = sat2cp.rbegin(); it != sat2cp.rend(); it++)
+        auto it = sat2cp.find(curr_obs[j]->sat); // the same satellite
+        if (it != sat2cp.end())
         {
-          it_old = it->second.find(curr_obs[j]->sat); // the same satellite
-          // it_old_best = it->second.find(curr_obs[best_sat]->sat);
-          if (it_old != it->second.end()) // && it_old_best != it->second.end())
+          // the samples before the last loss of lock can not be paired any more, front() is the oldest valid one
+          CpHistory &history = it->second;
+          const double track_time = p_assign->sat_track_time[curr_obs[j]->sat];
+          while (!history.empty() && history.front().time < track_time)
+            history.pop_front();
+          if (!history.empty() && time_current > track_time && p_assign->sat_track_status[curr_obs[j]->sat] > 0) //- p_assign->gnss_track_num_threshold)
           {
-            if (it->first.timecur >= p_assign->sat_track_time[curr_obs[j]->sat])
-            {
-            // if ((time_current - it->first.timecur) / gnss_sample_period <= p_assign->sat_track_status[curr_obs[best_sat]->sat] - p_assign->gnss_track_num_threshold &&
-            // if ((time_current - it->first.timecur) / gnss_sample_period <= p_assign->sat_track_status[curr_obs[j]->sat]) //- p_assign->gnss_track_num_threshold)
-            if (time_current > p_assign->sat_track_time[curr_obs[j]->sat] && p_assign->sat_track_status[curr_obs[j]->sat] > 0) //- p_assign->gnss_track_num_threshold)
-            {
-              cp_found = true;
-              meas = it_old->second[0]; // - it_old_best->second[1] + it_old->second[1]); it_old_best->second[0] -
-              // meas_cov = (it_old->second[2] * it_old->second[2]); // it_old_best->second[2] * it_old_best->second[2] + 
-              meas_time = it->first.timecur;
-              meas_index = it->first.frame_num;
-              RTex_sats << it->first.RTex[0], it->first.RTex[1], it->first.RTex[2];
-              meas_svpos << it_old->second[3], it_old->second[4], it_old->second[5];
-              // best_svpos << it_old_best->second[3], it_old_best->second[4], it_old_best->second[5];
-              break;
-            }
-            }
+            // paired with the latest epoch of the satellite
+            const CpSample &sample = history.back();
+            cp_found = true;
+            meas = sample.cp;
+            meas_time = sample.time;
+            meas_index = sample.frame_num;
+            RTex_sats = sample.RTex;
+            meas_svpos = sample.sv_pos;
           }
         }
       
@@ -949,7 +937,7 @@ bool GNSSProcess::AddFactor(gtsam::Rot3 rel_rot, gtsam::Point3 rel_pos, gtsam::V
     }
   }
 
-  std::map<uint32_t, double[6]> curr_cp_map;
+  std::map<uint32_t, CpSample> curr_cp_map;
   std::vector<double> meas_cp;
   // std::vector<double> cov_cp;
   std::vector<Eigen::Vector3d> sv_pos_pair, sat_svpos;
@@ -959,6 +947,10 @@ bool GNSSProcess::AddFactor(gtsam::Rot3 rel_rot, gtsam::Point3 rel_pos, gtsam::V
   M3D omg_skew;
   omg_skew << SKEW_SYM_MATRX(omg);
   Eigen::Vector3d hat_omg_T = omg_skew * Tex_imu_r;
+  p_assign->fillSvStates(curr_obs, curr_ephem);
+  ligo::GnssEpochMeas epoch_meas;
+  if (!p_assign->atmos_params || p_assign->atmos_params->iono_params != p_assign->latest_gnss_iono_params)
+    p_assign->atmos_params = std::make_shared<const ligo::AtmosParams>(ligo::AtmosParams{p_assign->latest_gnss_iono_params, p_assign->atmos_update_thres});
   for (uint32_t j = 0; j < curr_obs.size(); j++) //   && j < 10
   {
     bool balance = false;
@@ -975,11 +967,9 @@ bool GNSSProcess::AddFactor(gtsam::Rot3 rel_rot, gtsam::Point3 rel_pos, gtsam::V
     {
       if (curr_obs[j]->cp[freq_idx] * wavelength > 100)
       {
-        curr_cp_map[curr_obs[j]->sat][0] = curr_obs[j]->cp[freq_idx] * wavelength + svdt * LIGHT_SPEED - tgd * LIGHT_SPEED;
+        curr_cp_map[curr_obs[j]->sat].cp = curr_obs[j]->cp[freq_idx] * wavelength + svdt * LIGHT_SPEED - tgd * LIGHT_SPEED;
         // curr_cp_map[curr_obs[j]->sat][2] = curr_obs[j]->cp_std[freq_idx] * 0.004;
-        curr_cp_map[curr_obs[j]->sat][3] = sv_pos[0];
-        curr_cp_map[curr_obs[j]->sat][4] = sv_pos[1];
-        curr_cp_map[curr_obs[j]->sat][5] = sv_pos[2];
+        curr_cp_map[curr_obs[j]->sat].sv_pos = sv_pos;
  
         if (pair_sat_copy.size() > 0)
         {
@@ -1009,21 +999,25 @@ bool GNSSProcess::AddFactor(gtsam::Rot3 rel_rot, gtsam::Point3 rel_pos, gtsam::V
     values[0] = Tex_imu_r[0]; values[1] = Tex_imu_r[1]; values[2] = Tex_imu_r[2]; //values[3] = anc_local[0]; values[4] = anc_local[1]; values[5] = anc_local[2];
     values[3] = sv_pos[0]; values[4] = sv_pos[1]; values[5] = sv_pos[2]; values[6] = sv_vel[0]; values[7] = sv_vel[1]; values[8] = sv_vel[2];
     values[9] = svdt; values[10] = tgd; values[11] = svddt; values[12] = pr_uura; values[13] = dp_uura; values[14] = relative_sqrt_info; // psr_weight_adjust;
-    values[15] = p_assign->latest_gnss_iono_params[0]; values[16] = p_assign->latest_gnss_iono_params[1]; values[17] = p_assign->latest_gnss_iono_params[2]; values[18] = p_assign->latest_gnss_iono_params[3]; 
-    values[19] = p_assign->latest_gnss_iono_params[4]; values[20] = p_assign->latest_gnss_iono_params[5]; values[21] = p_assign->latest_gnss_iono_params[6]; values[22] = p_assign->latest_gnss_iono_params[7]; 
+    // values[15-22]: the iono params, shared by p_assign->atmos_params
     values[23] = time_current; values[24] = freq; values[25] = psr_meas_hatch_filter[j]; values[26] = curr_obs[j]->dopp[freq_idx]; //curr_obs[j]->psr[freq_idx]; 
     rcv_sys[sys_idx] = true;
     if (!nolidar)
     { 
       Eigen::Vector3d RTex = rot * Tex_imu_r;
       values[0] = RTex[0]; values[1] = RTex[1]; values[2] = RTex[2];
+      if (epoch_factor)
+      {
+        epoch_meas.push_back(values, sys_idx, balance); // one factor for the epoch, added after the loop
+        continue;
+      }
       if (frame_num < delete_thred)
       {      
-        p_assign->gtSAMgraph.add(ligo::GnssPsrDoppFactorNoR(A(frame_num), B(frame_num), C(frame_num), E(0), P(0), balance, values, sys_idx, rot * hat_omg_T, p_assign->robustpsrdoppNoise_init));
+        p_assign->gtSAMgraph.add(ligo::GnssPsrDoppFactorNoR(A(frame_num), B(frame_num), C(frame_num), E(0), P(0), balance, values, p_assign->atmos_params, sys_idx, rot * hat_omg_T, p_assign->robustpsrdoppNoise_init));
       }
       else
       {
-        p_assign->gtSAMgraph.add(ligo::GnssPsrDoppFactorNoR(A(frame_num), B(frame_num), C(frame_num), E(0), P(0), balance, values, sys_idx, rot * hat_omg_T, p_assign->robustpsrdoppNoise));
+        p_assign->gtSAMgraph.add(ligo::GnssPsrDoppFactorNoR(A(frame_num), B(frame_num), C(frame_num), E(0), P(0), balance, values, p_assign->atmos_params, sys_idx, rot * hat_omg_T, p_assign->robustpsrdoppNoise));
       }
       // p_assign->gtSAMgraph.add(ligo::GnssPsrDoppFactorNoR(A(frame_num), B(frame_num), C(frame_num), E(0), P(0), invalid_lidar, values, sys_idx, rot * hat_omg_T, p_assign->robustpsrdoppNoise));
       // p_assign->gtSAMgraph.add(ligo::GnssPsrDoppFactor(R(frame_num), A(frame_num), B(frame_num), C(frame_num), E(0), P(0), invalid_lidar, values, sys_idx, hat_omg_T, p_assign->robustpsrdoppNoise));
@@ -1033,21 +1027,30 @@ bool GNSSProcess::AddFactor(gtsam::Rot3 rel_rot, gtsam::Point3 rel_pos, gtsam::V
     {   
       if (frame_num < delete_thred)
       {
-        p_assign->gtSAMgraph.add(ligo::GnssPsrDoppFactorNolidar(R(frame_num), F(frame_num), B(frame_num), C(frame_num), values, sys_idx, hat_omg_T, p_assign->robustpsrdoppNoise_init)); // not work
+        p_assign->gtSAMgraph.add(ligo::GnssPsrDoppFactorNolidar(R(frame_num), F(frame_num), B(frame_num), C(frame_num), values, p_assign->atmos_params, sys_idx, hat_omg_T, p_assign->robustpsrdoppNoise_init)); // not work
       }
       else
       {
-        p_assign->gtSAMgraph.add(ligo::GnssPsrDoppFactorNolidar(R(frame_num), F(frame_num), B(frame_num), C(frame_num), values, sys_idx, hat_omg_T, p_assign->robustpsrdoppNoise)); // not work
+        p_assign->gtSAMgraph.add(ligo::GnssPsrDoppFactorNolidar(R(frame_num), F(frame_num), B(frame_num), C(frame_num), values, p_assign->atmos_params, sys_idx, hat_omg_T, p_assign->robustpsrdoppNoise)); // not work
       } 
     }
     factor_id_cur.push_back(id_accumulate);
     id_accumulate += 1;
   }
-  sat_first cur_key;
-  cur_key.RTex = rot * Tex_imu_r;
-  cur_key.timecur = time2sec(curr_obs[0]->time);
-  cur_key.frame_num = frame_num;
-  sat2cp[cur_key] = curr_cp_map;
+  if (!epoch_meas.empty())
+  {
+    p_assign->gtSAMgraph.add(ligo::GnssPsrDoppEpochFactorNoR(A(frame_num), B(frame_num), C(frame_num), E(0), P(0), epoch_meas, p_assign->atmos_params, rot * hat_omg_T, 
+                            frame_num < delete_thred ? p_assign->robustpsrdoppNoise_init : p_assign->robustpsrdoppNoise));
+    factor_id_cur.push_back(id_accumulate);
+    id_accumulate += 1;
+  }
+  for (auto &cp : curr_cp_map)
+  {
+    cp.second.RTex = rot * Tex_imu_r;
+    cp.second.time = time2sec(curr_obs[0]->time);
+    cp.second.frame_num = frame_num;
+    sat2cp[cp.first].push_back(cp.second);
+  }
   // if (frame_num < delete_thred)
   // {
   //   p_assign->gtSAMgraph.add(ligo::DdtSmoothFactor(C(frame_num-1), C(frame_num), p_assign->ddtNoise_init));
@@ -39,9 +39,54 @@
 #include "GNSS_Assignment.h"
 
 #include <pcl/registration/icp.h>
+#include <array>
 using namespace gnss_comm;
 
 #define WINDOW_SIZE (10) // should be 0
+#define CP_HISTORY_SIZE (64) // carrier phase samples kept per satellite
+
+// carrier phase of one satellite at one epoch
+struct CpSample
+{
+  double time;
+  int frame_num;
+  Eigen::Vector3d RTex;
+  Eigen::Vector3d sv_pos;
+  double cp; // carrier phase corrected by the satellite clock and tgd, in meters
+};
+
+// carrier phase history of one satellite, oldest first. A fixed ring, when it is full the oldest sample is dropped
+class CpHistory
+{
+ public:
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+  const CpSample &front() const { return buf_[head_]; }
+  const CpSample &back() const { return buf_[(head_ + size_ - 1) % CP_HISTORY_SIZE]; }
+
+  void push_back(const CpSample &sample)
+  {
+    // an epoch stored twice keeps the latest sample
+    if (size_ > 0 && back().time == sample.time)
+    {
+      buf_[(head_ + size_ - 1) % CP_HISTORY_SIZE] = sample;
+      return;
+    }
+    if (size_ == CP_HISTORY_SIZE) pop_front();
+    buf_[(head_ + size_) % CP_HISTORY_SIZE] = sample;
+    size_++;
+  }
+
+  void pop_front()
+  {
+    head_ = (head_ + 1) % CP_HISTORY_SIZE;
+    size_--;
+  }
+
+ private:
+  std::array<CpSample, CP_HISTORY_SIZE> buf_;
+  size_t head_ = 0, size_ = 0;
+};
 
 class GNSSProcess
 {
@@ -67,7 +112,9 @@ class GNSSProcess
   void SetLidarInit(const state_output &state, const Eigen::Vector3d &anc_ecef, const Eigen::Matrix3d &R_ecef_enu, const double &lidar_time);
   bool AddFactor(gtsam::Rot3 rel_rot_, gtsam::Point3 rel_pos_, gtsam::Vector3 rel_v_, Eigen::Vector3d state_gravity, double delta_t, double time_current,
                 Eigen::Vector3d ba, Eigen::Vector3d bg,  Eigen::Vector3d pos, Eigen::Vector3d vel, Eigen::Vector3d acc, Eigen::Vector3d omg, Eigen::Matrix3d rot);
-  std::map<sat_first, std::map<uint32_t, double[6]>> sat2cp; // 
+  std::map<uint32_t, CpHistory> sat2cp; // sat -> carrier phase history
+  template <typename Expired>
+  void evictCp(Expired expired);
   std::vector<ObsPtr> gnss_meas_buf[WINDOW_SIZE+1]; //
   std::vector<double> psr_meas_hatch_filter;
   std::vector<EphemBasePtr> gnss_ephem_buf[WINDOW_SIZE+1]; // 
@@ -105,8 +152,22 @@ class GNSSProcess
   int delete_thred = 0;
   int wind_size = WINDOW_SIZE;
   int norm_vec_num = 0;
+  // cost of runISAM2opt, printed every opt_stat_period epochs
+  int opt_stat_period = 100;
+  int opt_time_num = 0;
+  double opt_time_sum = 0.0;
+  double opt_time_max = 0.0;
+  double sqrt_info_time_sum = 0.0; // setLidarCov, over the same epochs
   bool nolidar = false;
   bool nolidar_cur = false;
+  bool epoch_factor = false; // one pseudo-range/doppler factor per epoch instead of one per satellite (lidar mode only)
+  // set by GraphBackend while it evaluates a queued epoch, AddFactor then takes the lidar statistics of the epoch
+  // instead of the counters the main thread keeps updating
+  bool queued_epoch = false;
+  int epoch_feat_num = 0;
+  int epoch_norm_num = 0;
+  bool epoch_nolidar = false;
+  double delay_noise = 0.0; // added to gnss_ekf_noise while a delayed result of GraphBackend is applied
   std::vector<Eigen::Vector3d> norm_vec_holder;
   // double para_yaw_enu_local[1];
   double para_rcv_dt[(WINDOW_SIZE+1)*4] = {0}; //
@@ -117,6 +178,8 @@ class GNSSProcess
   double yaw_enu_local = 0.0;
   
   void runISAM2opt(void);
+  void updateOptStatistics(double cost_ms);
+  void setLidarCov(const Eigen::Matrix<double, 24, 24> &cov); // sqrt_lidar from the filter covariance
   void GnssPsrDoppMeas(const ObsPtr &obs_, const EphemBasePtr &ephem_);
   void SvPosCals(const ObsPtr &obs_, const EphemBasePtr &ephem_);
   bool Evaluate(state_output &state);
@@ -147,4 +210,19 @@ class GNSSProcess
     Eigen::Matrix3d rot_pos;
 };
 
-// # endif
\ No newline at end of file
+// # endif
+
+// the samples are sorted by time in each history, so the expired ones are dropped from the front
+template <typename Expired>
+void GNSSProcess::evictCp(Expired expired)
+{
+  for (auto it = sat2cp.begin(); it != sat2cp.end();)
+  {
+    while (!it->second.empty() && expired(it->second.front()))
+      it->second.pop_front();
+    if (it->second.empty())
+      it = sat2cp.erase(it);
+    else
+      ++it;
+  }
+}
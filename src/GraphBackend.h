@@ -0,0 +1,263 @@
+/*
+ * BSD 3-Clause License
+
+ *  Copyright (c) 2025, Dongjiao He
+ *  All rights reserved.
+ *
+ *  Author: Dongjiao HE <hdj65822@connect.hku.hk>
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Universitaet Bremen nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <common_lib.h>
+#include <utils/ring_buffer.h>
+#include <backend_optimization/utility/Timer.h>
+
+#define GRAPH_BACKEND_QUEUE_SIZE (16) // epochs waiting for the backend, further epochs are dropped
+#define GRAPH_BACKEND_STAT_PERIOD (100) // results between two prints of the backend statistics
+
+/*
+ * Runs the factor graph of a GNSSProcess or NMEAProcess (preprocessing, Evaluate and the ISAM2 update) in its
+ * own thread, so that the point-by-point loop of the filter does not stall at the GNSS epochs.
+ *
+ * The main thread queues an epoch together with the filter state and covariance predicted to it, through a
+ * lock-free single-producer / single-consumer ring. The optimized state of the epoch comes back as a
+ * time-stamped pseudo-measurement, which the main thread applies at its next opportunity: the correction of
+ * the graph at the epoch is carried to the filter time (compensate) and its noise is inflated by the delay
+ * (delayNoise).
+ *
+ * Ownership of the process: the backend uses it only while an epoch is queued and no result is pending, the
+ * main thread only when the backend is idle() or a result is pending (until release()). After a result the
+ * backend waits for its release before it takes the next epoch, so the main thread can read the graph (e.g.
+ * the anchor for the trajectory output) while applying it.
+ */
+template <typename Process, typename Meas>
+class GraphBackend
+{
+public:
+    typedef std::function<void(Process &, const Meas &, state_output &)> PreprocessFunc;
+
+    struct Epoch
+    {
+        Meas meas;
+        state_output state;                // filter state predicted to the epoch
+        Eigen::Matrix<double, 24, 24> cov; // and its covariance
+        int feat_num = 0;                  // lidar statistics since the previous epoch, see AddFactor
+        int norm_num = 0;
+        bool nolidar = false;
+    };
+
+    struct Result
+    {
+        double time = 0.0;      // of the epoch
+        state_output state;     // filter state at the epoch, with the gravity of the graph
+        state_output state_opt; // rot, pos and vel optimized by the graph
+        double cost = 0.0;      // ms
+    };
+
+    GraphBackend(const std::shared_ptr<Process> &process, const PreprocessFunc &preprocess, const std::string &name)
+        : process_(process), preprocess_(preprocess), name_(name), epochs_(GRAPH_BACKEND_QUEUE_SIZE)
+    {
+        worker_ = std::thread(&GraphBackend::run, this);
+    }
+
+    ~GraphBackend()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            exit_ = true;
+        }
+        cv_.notify_all();
+        if (worker_.joinable())
+            worker_.join();
+    }
+
+    GraphBackend(const GraphBackend &) = delete;
+    GraphBackend &operator=(const GraphBackend &) = delete;
+
+    /// main thread: queue an epoch, the lidar statistics of the process are handed over with it
+    bool push(const Meas &meas, const state_output &state, const Eigen::Matrix<double, 24, 24> &cov, double time)
+    {
+        Epoch epoch;
+        epoch.meas = meas;
+        epoch.state = state;
+        epoch.cov = cov;
+        epoch.feat_num = process_->p_assign->process_feat_num;
+        epoch.norm_num = process_->norm_vec_num;
+        epoch.nolidar = process_->nolidar_cur;
+        if (!epochs_.push_back(std::move(epoch), time))
+        {
+            printf("[%s backend] epoch %f dropped, %d epochs are waiting\n", name_.c_str(), time, num_pending_.load());
+            return false;
+        }
+        process_->p_assign->process_feat_num = 0;
+        process_->norm_vec_num = 0;
+        process_->nolidar_cur = false;
+
+        num_pending_.fetch_add(1, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+    /// main thread: the pending result, nullptr if there is none
+    const Result *result() const
+    {
+        return result_ready_.load(std::memory_order_acquire) ? &result_ : nullptr;
+    }
+
+    /// main thread: done with the pending result, the backend continues with the next epoch
+    void release(double delay)
+    {
+        delay_sum_ += delay;
+        delay_max_ = std::max(delay_max_, delay);
+        cost_sum_ += result_.cost;
+        cost_max_ = std::max(cost_max_, result_.cost);
+        if (++num_results_ == GRAPH_BACKEND_STAT_PERIOD)
+        {
+            printf("[%s backend] result delay avg %.1f ms, max %.1f ms, graph cost avg %.2f ms, max %.2f ms over %d epochs, %lu dropped\n",
+                   name_.c_str(), delay_sum_ * 1000.0 / num_results_, delay_max_ * 1000.0, cost_sum_ / num_results_, cost_max_,
+                   num_results_, epochs_.num_dropped());
+            delay_sum_ = delay_max_ = cost_sum_ = cost_max_ = 0.0;
+            num_results_ = 0;
+        }
+
+        result_ready_.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+        }
+        cv_.notify_one();
+    }
+
+    /// main thread: no epoch queued and no result pending, the process may be used directly
+    bool idle() const
+    {
+        return num_pending_.load(std::memory_order_acquire) == 0 && !result_ready_.load(std::memory_order_acquire);
+    }
+
+    /// main thread: blocks until a result is pending (true) or all queued epochs are done without one (false)
+    bool waitResult()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        done_cv_.wait(lock, [this]
+                      { return result_ready_.load(std::memory_order_acquire) || num_pending_.load(std::memory_order_acquire) == 0; });
+        return result_ready_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * the optimized state of the epoch as a measurement of the filter state at a later time: the rotation
+     * correction is applied in the body frame, the position correction is moved on by the velocity correction
+     */
+    static state_output compensate(const Result &result, const state_output &state, double delay)
+    {
+        const Eigen::Vector3d vel_corr = result.state_opt.vel - result.state.vel;
+        state_output meas = state;
+        meas.rot = Eigen::Matrix3d(state.rot * (result.state.rot.transpose() * result.state_opt.rot));
+        meas.pos = state.pos + result.state_opt.pos - result.state.pos + vel_corr * delay;
+        meas.vel = state.vel + vel_corr;
+        return meas;
+    }
+
+    /// variance added to the measurement noise: the velocity uncertainty integrated over the delay
+    static double delayNoise(const Eigen::Matrix<double, 24, 24> &cov, double delay)
+    {
+        return delay * delay * cov.block<3, 3>(6, 6).trace() / 3.0;
+    }
+
+private:
+    void run()
+    {
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_.wait(lock, [this]
+                         { return exit_ || (num_pending_.load(std::memory_order_acquire) > 0 && !result_ready_.load(std::memory_order_acquire)); });
+                if (exit_)
+                    return;
+            }
+
+            Epoch &epoch = epochs_.front();
+            Timer timer;
+            process_->setLidarCov(epoch.cov);
+            process_->queued_epoch = true;
+            process_->epoch_feat_num = epoch.feat_num;
+            process_->epoch_norm_num = epoch.norm_num;
+            process_->epoch_nolidar = epoch.nolidar;
+            preprocess_(*process_, epoch.meas, epoch.state);
+            const bool updated = process_->Evaluate(epoch.state);
+            process_->queued_epoch = false;
+            if (updated)
+            {
+                result_.time = epochs_.front_stamp();
+                result_.state = epoch.state;
+                result_.state_opt = process_->state_const_;
+                result_.cost = timer.elapsedLast();
+            }
+            epochs_.pop_front();
+
+            if (updated)
+                result_ready_.store(true, std::memory_order_release);
+            num_pending_.fetch_sub(1, std::memory_order_release);
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+            }
+            done_cv_.notify_all();
+        }
+    }
+
+    std::shared_ptr<Process> process_;
+    PreprocessFunc preprocess_;
+    std::string name_;
+
+    SpscRingBuffer<Epoch> epochs_; // main thread -> backend
+    Result result_;                // backend -> main thread, valid while result_ready_
+    std::atomic<bool> result_ready_{false};
+    std::atomic<int> num_pending_{0};
+
+    // only for sleeping, the queue itself is lock-free
+    std::mutex mtx_;
+    std::condition_variable cv_;      // wakes the backend
+    std::condition_variable done_cv_; // wakes the main thread in waitResult
+    bool exit_ = false;
+    std::thread worker_;
+
+    // main thread only
+    int num_results_ = 0;
+    double delay_sum_ = 0.0, delay_max_ = 0.0;
+    double cost_sum_ = 0.0, cost_max_ = 0.0;
+};
@@ -426,18 +426,20 @@ bool NMEAProcess::AddFactor(gtsam::Rot3 rel_rot, gtsam::Point3 rel_pos, gtsam::V
   invalid_lidar = false;
   if (!nolidar)
   {
-    invalid_lidar = nolidar_cur;
+    int &feat_num = queued_epoch ? epoch_feat_num : p_assign->process_feat_num;
+    int &norm_num = queued_epoch ? epoch_norm_num : norm_vec_num;
+    invalid_lidar = queued_epoch ? epoch_nolidar : nolidar_cur;
     double weight_lid = 1;
-    if (p_assign->process_feat_num < 10) 
+    if (feat_num < 10) 
     {
       weight_lid = 0;
     }
     else
     {
-      weight_lid = 2 * double(norm_vec_num) / double(p_assign->process_feat_num);
+      weight_lid = 2 * double(norm_num) / double(feat_num);
     }
-    norm_vec_num = 0;
-    p_assign->process_feat_num = 0;
+    norm_num = 0;
+    feat_num = 0;
     double weight_check = (sqrt_lidar(0, 0) + sqrt_lidar(1, 1) + sqrt_lidar(2, 2) 
                           + sqrt_lidar(6, 6) + sqrt_lidar(7, 7) + sqrt_lidar(8, 8)) / 6; // + sqrt_lidar(3, 3) + sqrt_lidar(4, 4) + sqrt_lidar(5, 5)
     sqrt_lidar *= weight_lid / weight_check;
@@ -453,7 +455,8 @@ bool NMEAProcess::AddFactor(gtsam::Rot3 rel_rot, gtsam::Point3 rel_pos, gtsam::V
       }
     }
   }
-  if (nolidar_cur && !nolidar) nolidar_cur = false;
+  // queued epochs run in the backend thread, which must not touch nolidar_cur (written by the main thread)
+  if (!queued_epoch && nolidar_cur && !nolidar) nolidar_cur = false; // reset by GraphBackend when the epoch was queued
 
   std::vector<size_t> factor_id_cur;
   M3D omg_skew;
@@ -96,6 +96,13 @@ class NMEAProcess
   int norm_vec_num = 0;
   bool nolidar = false;
   bool nolidar_cur = false;
+  // set by GraphBackend while it evaluates a queued epoch, AddFactor then takes the lidar statistics of the epoch
+  // instead of the counters the main thread keeps updating
+  bool queued_epoch = false;
+  int epoch_feat_num = 0;
+  int epoch_norm_num = 0;
+  bool epoch_nolidar = false;
+  double delay_noise = 0.0; // added to gnss_ekf_noise while a delayed result of GraphBackend is applied
   std::vector<Eigen::Vector3d> norm_vec_holder;
   // double para_yaw_enu_local[1];
   // double para_rcv_dt[(WINDOW_SIZE+1)*4] = {0}; //
@@ -106,6 +113,7 @@ class NMEAProcess
   double yaw_enu_local = 0.0;
   
   void runISAM2opt(void);
+  void setLidarCov(const Eigen::Matrix<double, 24, 24> &cov) { sqrt_lidar = esekfom::sqrt_information<double, 24>(cov); } // sqrt_lidar from the filter covariance
   // void GnssPsrDoppMeas(const ObsPtr &obs_, const EphemBasePtr &ephem_);
   // void SvPosCals(const ObsPtr &obs_, const EphemBasePtr &ephem_);
   bool Evaluate(state_output &state);
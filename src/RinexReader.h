@@ -0,0 +1,203 @@
+/*
+ * BSD 3-Clause License
+
+ *  Copyright (c) 2025, Dongjiao He
+ *  All rights reserved.
+ *
+ *  Author: Dongjiao HE <hdj65822@connect.hku.hk>
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Universitaet Bremen nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+#include <utils/mapped_file.h>
+
+/*
+ * One line of a mapped RINEX file (without the line break). RINEX records are fixed-column, so
+ * the fields are parsed in place, columns beyond the end of the line read as blanks.
+ */
+struct RinexLine
+{
+    const char *ptr = nullptr;
+    size_t len = 0;
+
+    char at(size_t pos) const { return pos < len ? ptr[pos] : ' '; }
+
+    bool contains(const char *str) const
+    {
+        return memmem(ptr, len, str, strlen(str)) != nullptr;
+    }
+
+    bool blank(size_t pos, size_t n) const
+    {
+        for (size_t i = pos; i < std::min(pos + n, len); ++i)
+            if (ptr[i] != ' ')
+                return false;
+        return true;
+    }
+
+    // the fortran exponent 'D' of the navigation files is accepted
+    double toDouble(size_t pos, size_t n) const
+    {
+        char buf[32];
+        n = std::min({n, pos < len ? len - pos : 0, sizeof(buf) - 1});
+        for (size_t i = 0; i < n; ++i)
+        {
+            const char c = ptr[pos + i];
+            buf[i] = (c == 'D' || c == 'd') ? 'e' : c;
+        }
+        buf[n] = '\0';
+        return std::strtod(buf, nullptr);
+    }
+
+    int toInt(size_t pos, size_t n) const
+    {
+        char buf[32];
+        n = std::min({n, pos < len ? len - pos : 0, sizeof(buf) - 1});
+        memcpy(buf, ptr + pos, n);
+        buf[n] = '\0';
+        return static_cast<int>(std::strtol(buf, nullptr, 10));
+    }
+};
+
+class RinexLineReader
+{
+public:
+    explicit RinexLineReader(const MappedFile &file)
+        : cur_(file.data()), end_(file.data() + file.size())
+    {
+    }
+
+    bool next(RinexLine &line)
+    {
+        if (cur_ >= end_)
+            return false;
+        const char *eol = static_cast<const char *>(memchr(cur_, '\n', end_ - cur_));
+        if (eol == nullptr)
+            eol = end_;
+        line.ptr = cur_;
+        line.len = eol - cur_;
+        if (line.len > 0 && line.ptr[line.len - 1] == '\r')
+            --line.len;
+        cur_ = eol + 1;
+        return true;
+    }
+
+private:
+    const char *cur_;
+    const char *end_;
+};
+
+// observation type of the header, e.g. "C1C": measurement kind 'C' on the frequency of band '1'
+struct RinexObsType
+{
+    char kind;
+    double freq; // < 0 if the band is unknown
+};
+
+/*
+ * Layout of the binary sidecar "<rinex file>.bin" (native endianness):
+ *   navigation file:  [RinexCacheHeader][double iono_params[8]]
+ *                     [num_records x (uint32 type, RinexEphemRecord or RinexGloEphemRecord)]
+ *   observation file: [RinexCacheHeader][num_records x epoch:
+ *                     (int64 time, double sec, uint32 num_obs, num_obs x
+ *                     (uint32 sat, uint32 num_freqs, RINEX_OBS_FIELDS x num_freqs double))]
+ * The sidecar is only used while the size and mtime of the rinex file match the header.
+ */
+#define RINEX_CACHE_VERSION (1)
+#define RINEX_OBS_FIELDS (11)
+
+struct RinexCacheHeader
+{
+    char magic[4];          // "RNXN" navigation, "RNXO" observation
+    uint32_t version;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t num_records;
+    uint32_t has_iono;      // navigation only, the GPSA and GPSB records were found
+    uint32_t reserved;
+};
+
+struct RinexEphemRecord // GPS, Galileo and BeiDou
+{
+    uint32_t sat;
+    uint32_t week;
+    uint32_t health;
+    uint32_t reserved;
+    int64_t toc, toe, ttr;
+    double toc_sec, toe_sec, ttr_sec;
+    double iode, iodc, toe_tow, ura, tgd[2];
+    double A, e, i0, omg, OMG0, M0, delta_n, OMG_dot, i_dot;
+    double cuc, cus, crc, crs, cic, cis;
+    double af0, af1, af2;
+};
+
+struct RinexGloEphemRecord
+{
+    uint32_t sat;
+    uint32_t health;
+    uint32_t age;
+    int32_t freqo;
+    int64_t toe;
+    double toe_sec;
+    double tau_n, gamma;
+    double pos[3], vel[3], acc[3];
+};
+
+// bounds-checked sequential reads from a mapped sidecar, records are not aligned
+class RinexCacheReader
+{
+public:
+    explicit RinexCacheReader(const MappedFile &file)
+        : cur_(file.data()), end_(file.data() + file.size())
+    {
+    }
+
+    template <typename T>
+    bool read(T *values, size_t num = 1)
+    {
+        if (static_cast<size_t>(end_ - cur_) < num * sizeof(T))
+            return false;
+        memcpy(values, cur_, num * sizeof(T));
+        cur_ += num * sizeof(T);
+        return true;
+    }
+
+    bool end() const { return cur_ == end_; }
+
+private:
+    const char *cur_;
+    const char *end_;
+};
@@ -47,12 +47,14 @@
 #include <tf/transform_broadcaster.h>
 #include <geometry_msgs/PoseWithCovarianceStamped.h>
 #include "li_initialization.h"
+#include "GraphBackend.h"
 #include <malloc.h>
 // #include <cv_bridge/cv_bridge.h>
 #include <opencv2/opencv.hpp>
 #include "chi-square.h"
 // #include <ros/console.h>
 #include "backend_optimization/global_localization/Relocalization.hpp"
+#include "backend_optimization/global_localization/TileMapServer.hpp"
 
 
 #define PUBFRAME_PERIOD     (20)
@@ -78,6 +80,11 @@ PointCloudXYZI::Ptr init_feats_world(new PointCloudXYZI());
 std::deque<PointCloudXYZI::Ptr> depth_feats_world;
 pcl::VoxelGrid<PointType> downSizeFilterSurf;
 shared_ptr<Relocalization> relocalization;
+shared_ptr<TileMapServer> map_server;
+typedef GraphBackend<GNSSProcess, std::vector<ObsPtr>> GNSSBackend;
+typedef GraphBackend<NMEAProcess, nav_msgs::OdometryPtr> NMEABackend;
+std::unique_ptr<GNSSBackend> gnss_backend; // factor graph in its own thread, if graph_async_backend
+std::unique_ptr<NMEABackend> nmea_backend;
 
 V3D euler_cur;
 
@@ -139,6 +146,8 @@ void MapIncremental() {
         }
     }
     ivox_->AddPoints(points_to_add);
+    for (auto &level : ivox_levels_)
+        level->AddPoints(points_to_add);
 }
 
 void publish_init_map(const ros::Publisher & pubLaserCloudFullRes)
@@ -389,23 +398,73 @@ bool run_relocalization(PointCloudType::Ptr scan, const double &lidar_beg_time)
     return system_state_vaild;
 }
 
-void init_global_map(PointCloudType::Ptr &submap)
+void save_ivox_snapshot(const string &snapshot_path, const struct stat &map_stat)
 {
-    if (!ivox_->grids_map_.empty())
+    Timer timer;
+    if (!ivox_->Save(snapshot_path, map_stat.st_size, map_stat.st_mtime))
+    {
+        LOG_ERROR("Save the map ivox to %s failed!", snapshot_path.c_str());
+        return;
+    }
+    LOG_WARN("Save the map ivox to %s. Cost time %fms.", snapshot_path.c_str(), timer.elapsedLast());
+}
+
+void init_global_map(PointCloudType::Ptr &submap, const string &globalmap_path)
+{
+    if (ivox_->NumValidGrids() != 0)
     {
         LOG_ERROR("Error, ivox not null when initializing the map!");
         std::exit(100);
     }
-    ivox_->AddPoints(submap->points);
+
+    // the snapshot of a previous start is used while globalmap.pcd is unchanged
+    const string snapshot_path = globalmap_path + ".ivox";
+    struct stat map_stat;
+    const bool use_snapshot = ivox_snapshot_en && stat(globalmap_path.c_str(), &map_stat) == 0;
+    Timer timer;
+    const bool loaded = use_snapshot && ivox_->Load(snapshot_path, map_stat.st_size, map_stat.st_mtime);
+    if (loaded)
+    {
+        LOG_WARN("Load the map ivox from %s, %lu voxels. Cost time %fms.", snapshot_path.c_str(), ivox_->NumValidGrids(), timer.elapsedLast());
+    }
+    else
+    {
+        ivox_->AddPoints(submap->points);
+        LOG_WARN("Build the map ivox, %lu voxels. Cost time %fms.", ivox_->NumValidGrids(), timer.elapsedLast());
+    }
+    // a loaded snapshot keeps the voxel order it was saved in
+    if (ivox_compact && !loaded)
+    {
+        timer.record();
+        ivox_->Compact();
+        LOG_WARN("Compact the map ivox in morton order. Cost time %fms.", timer.elapsedLast());
+    }
+    // after the compaction, so the flat ivox writes its voxels in morton order
+    if (use_snapshot && !loaded)
+        save_ivox_snapshot(snapshot_path, map_stat);
+    ivox_last_->SnapshotFrom(*ivox_);
+    for (size_t l = 0; l < ivox_levels_.size(); l++)
+    {
+        timer.record();
+        ivox_levels_[l]->AddPoints(submap->points);
+        if (ivox_compact)
+            ivox_levels_[l]->Compact();
+        ivox_levels_last_[l]->SnapshotFrom(*ivox_levels_[l]);
+        LOG_WARN("Build the coarse map ivox, %lu voxels. Cost time %fms.", ivox_levels_[l]->NumValidGrids(), timer.elapsedLast());
+    }
+
+    if (plane_cache_resolution > 0)
+    {
+        timer.record();
+        plane_cache_ = std::make_shared<PlaneCacheType>(plane_cache_resolution, NUM_MATCH_POINTS, plane_thr);
+        plane_cache_->Build(submap->points);
+        LOG_WARN("Fit %lu planes of the map, %lu of them within plane_thr. Cost time %fms.", plane_cache_->NumPlanes(),
+                 plane_cache_->NumValidPlanes(), timer.elapsedLast());
+    }
 }
 
-void init_system_mode()
+void load_global_map(const string &globalmap_path)
 {
-    string globalmap_path = PCD_FILE_DIR("globalmap.pcd");
-    string trajectory_path = PCD_FILE_DIR("trajectory.pcd");
-    string scd_path = PCD_FILE_DIR("scancontext/");
-
-    /*** init localization mode ***/
     if (access(globalmap_path.c_str(), F_OK) != 0)
     {
         LOG_ERROR("File not exist! Please check the \"globalmap_path\".");
@@ -421,11 +480,64 @@ void init_system_mode()
         std::exit(100);
     }
     LOG_WARN("Load pcd successfully! There are %lu points in map. Cost time %fms.", global_map->points.size(), timer.elapsedLast());
+}
+
+void init_tile_map_server(const string &globalmap_path, const string &tile_path)
+{
+    if (!TileMapIndex::exists(tile_path))
+    {
+        // split the global map once, later starts only read the tiles in range
+        load_global_map(globalmap_path);
+        Timer timer;
+        if (!TileMapIndex::build(global_map, map_tile_size, tile_path))
+        {
+            LOG_ERROR("Build map tiles failed! path = %s", tile_path.c_str());
+            std::exit(100);
+        }
+        LOG_WARN("Build map tiles successfully! tile_size = %.1fm, cost time %fms.", map_tile_size, timer.elapsedLast());
+        global_map.reset();
+    }
 
-    if (!relocalization->load_prior_map(global_map))
+    if (plane_cache_resolution > 0)
+        LOG_WARN("The plane cache needs the whole map at load, disabled for map tiles.");
+    if (!ivox_levels_.empty())
     {
+        LOG_WARN("The coarse ivox levels need the whole map at load, disabled for map tiles.");
+        ivox_levels_.clear();
+        ivox_levels_last_.clear();
+    }
+
+    map_server = std::make_shared<TileMapServer>(tile_path, map_load_radius);
+    if (!map_server->init())
+    {
+        LOG_ERROR("Load map tile index failed! path = %s", tile_path.c_str());
         std::exit(100);
     }
+    relocalization->prior_map_radius = map_load_radius;
+    relocalization->prior_map_loader = [](const Pose &pose)
+    { return map_server->loadTilesNear(pose.x, pose.y, map_load_radius); };
+}
+
+void init_system_mode()
+{
+    string globalmap_path = PCD_FILE_DIR("globalmap.pcd");
+    string trajectory_path = PCD_FILE_DIR("trajectory.pcd");
+    string scd_path = PCD_FILE_DIR("scancontext/");
+    string tile_path = PCD_FILE_DIR("tiles/");
+
+    /*** init localization mode ***/
+    if (map_tile_size > 0)
+    {
+        init_tile_map_server(globalmap_path, tile_path);
+    }
+    else
+    {
+        load_global_map(globalmap_path);
+        if (!relocalization->load_prior_map(global_map))
+        {
+            std::exit(100);
+        }
+    }
 
     pcl::io::loadPCDFile(trajectory_path, *relocalization->trajectory_poses);
     if (relocalization->trajectory_poses->points.size() < 10)
@@ -441,15 +553,16 @@ void init_system_mode()
         LOG_ERROR("Load keyframe descriptor failed, set algorithm_type to manually_set!");
     }
     else
-        LOG_WARN("Load keyframe descriptor successfully! There are %lu descriptors.", relocalization->sc_manager->polarcontexts_.size());
+        LOG_WARN("Load keyframe descriptor successfully! There are %lu descriptors.", relocalization->sc_manager->numDescriptors());
 
-    /*** initialize the map ivox ***/
-    init_global_map(global_map);
+    /*** initialize the map ivox, tiles are paged in by the map server ***/
+    if (!map_server)
+        init_global_map(global_map, globalmap_path);
 }
 
 void publish_global_map(const ros::TimerEvent &)
 {
-    if (pubGlobalMap.getNumSubscribers() != 0)
+    if (global_map && pubGlobalMap.getNumSubscribers() != 0)
     {
         sensor_msgs::PointCloud2 cloud_msg;
         pcl::toROSMsg(*global_map, cloud_msg);
@@ -478,6 +591,102 @@ void initialPoseCallback(const geometry_msgs::PoseWithCovarianceStamped::ConstPt
     relocalization->set_init_pose(init_pose);
 }
 
+// moves the map along the trajectory corrected by the gnss update, out_state is the filter state before the update
+void update_map_after_gnss(const state_output &out_state, double stamp)
+{
+    if ((out_state.pos - kf_output.x_.pos).norm() > 0.1 && pose_graph_key_pose.size() > 4)
+    {
+        curvefitter::PoseData pose_data;
+        pose_data.timestamp = stamp;
+        map_time = pose_data.timestamp;
+        pose_data.orientation = Sophus::SO3d(Eigen::Quaterniond(kf_output.x_.rot).normalized().toRotationMatrix());
+        pose_data.position = kf_output.x_.pos;
+        if (map_time > pose_graph_key_pose.back().timestamp) // + 1e-9)
+        {
+            pose_time_vector.push_back(pose_data.timestamp);
+            pose_graph_key_pose.emplace_back(pose_data);
+        }
+        else
+        {
+            pose_data.timestamp = pose_graph_key_pose.back().timestamp;
+            pose_graph_key_pose.back() = pose_data;
+        }
+        traj_manager->SetTrajectory(std::make_shared<curvefitter::Trajectory<4> >(0.025));
+        traj_manager->FitCurve(pose_graph_key_pose[0].orientation.unit_quaternion(), pose_graph_key_pose[0].position, pose_time_vector[0], pose_time_vector.back(), pose_graph_key_pose);
+        updatedmap.resize(points_num);
+        updatedmap = traj_manager->GetUpdatedMapPoints(pose_time_vector, LiDAR_points);
+        ivox_last_->AddPoints(updatedmap);
+        ivox_->SnapshotFrom(*ivox_last_);
+        // the levels drop the uncorrected points of the window like ivox_
+        for (size_t l = 0; l < ivox_levels_.size(); l++)
+        {
+            ivox_levels_last_[l]->AddPoints(updatedmap);
+            ivox_levels_[l]->SnapshotFrom(*ivox_levels_last_[l]);
+        }
+        if (plane_cache_)
+            plane_cache_->Invalidate(updatedmap);
+        reset_match_cache();
+    }
+    else
+    {
+        ivox_last_->SnapshotFrom(*ivox_);
+        for (size_t l = 0; l < ivox_levels_.size(); l++)
+            ivox_levels_last_[l]->SnapshotFrom(*ivox_levels_[l]);
+    }
+    traj_manager->ResetTrajectory(pose_graph_key_pose, pose_time_vector, LiDAR_points, points_num);
+}
+
+/*** results of the graph backends, applied to the filter at the current filter time ***/
+void apply_gnss_backend_result()
+{
+    const GNSSBackend::Result *result = gnss_backend->result();
+    if (result == nullptr)
+        return;
+
+    const double delay = time_predict_last_const - result->time;
+    p_gnss->state_const_ = GNSSBackend::compensate(*result, kf_output.x_, delay);
+    p_gnss->delay_noise = GNSSBackend::delayNoise(kf_output.P_, delay);
+    kf_output.x_.gravity = result->state.gravity;
+    state_output out_state = kf_output.x_;
+    kf_output.update_iterated_dyn_share_GNSS();
+    p_gnss->delay_noise = 0.0;
+    Eigen::Vector3d pos_enu;
+    if (!runtime_pos_log) cout_state_to_file(pos_enu);
+    update_map_after_gnss(out_state, time_predict_last_const);
+    gnss_backend->release(delay);
+}
+
+void apply_nmea_backend_result()
+{
+    const NMEABackend::Result *result = nmea_backend->result();
+    if (result == nullptr)
+        return;
+
+    const double delay = time_predict_last_const - result->time;
+    p_nmea->state_const_ = NMEABackend::compensate(*result, kf_output.x_, delay);
+    p_nmea->delay_noise = NMEABackend::delayNoise(kf_output.P_, delay);
+    kf_output.x_.gravity = result->state.gravity;
+    kf_output.update_iterated_dyn_share_NMEA();
+    p_nmea->delay_noise = 0.0;
+    if (!runtime_pos_log) cout_state_to_file_nmea();
+    nmea_backend->release(delay);
+}
+
+void apply_graph_backend_results()
+{
+    if (gnss_backend) apply_gnss_backend_result();
+    if (nmea_backend) apply_nmea_backend_result();
+}
+
+// waits until the backends are idle, before the main thread uses the processes itself
+void flush_graph_backends()
+{
+    while (gnss_backend && gnss_backend->waitResult())
+        apply_gnss_backend_result();
+    while (nmea_backend && nmea_backend->waitResult())
+        apply_nmea_backend_result();
+}
+
 int main(int argc, char** argv)
 {
     ros::init(argc, argv, "laserMapping");
@@ -488,6 +697,16 @@ int main(int argc, char** argv)
     cout<<"lidar_type: "<<lidar_type<<endl;
     ivox_ = std::make_shared<IVoxType>(ivox_options_);
     ivox_last_ = std::make_shared<IVoxType>(ivox_options_); //(*ivox_);
+    for (int l = 1; l <= ivox_coarse_levels; l++)
+    {
+        // written and snapshotted like ivox_
+        IVoxType::Options options = ivox_options_;
+        options.resolution_ = ivox_options_.resolution_ * (1 << l);
+        ivox_levels_.push_back(std::make_shared<IVoxType>(options));
+        ivox_levels_last_.push_back(std::make_shared<IVoxType>(options));
+    }
+    level_hits.assign(ivox_levels_.size() + 1, 0);
+    level_misses.assign(ivox_levels_.size() + 1, 0);
 #if 1
     load_parameters();
     init_system_mode();
@@ -531,6 +750,15 @@ int main(int argc, char** argv)
         p_nmea->nolidar = nolidar; // edit
         p_nmea->pre_integration->setnoise();
     }
+    if (graph_async_backend && !nolidar)
+    {
+        if (GNSS_ENABLE)
+            gnss_backend.reset(new GNSSBackend(p_gnss, [](GNSSProcess &process, const std::vector<ObsPtr> &meas, state_output &state)
+                                               { process.processGNSS(meas, state); }, "gnss"));
+        if (NMEA_ENABLE)
+            nmea_backend.reset(new NMEABackend(p_nmea, [](NMEAProcess &process, const nav_msgs::OdometryPtr &meas, state_output &state)
+                                               { process.processNMEA(meas, state); }, "nmea"));
+    }
     if (NMEA_ENABLE)
     {
         kf_output.init_dyn_share_modified_3h(get_f_output, df_dx_output, h_model_output, h_model_IMU_output, h_model_NMEA_output);
@@ -539,6 +767,7 @@ int main(int argc, char** argv)
     {
         kf_output.init_dyn_share_modified_3h(get_f_output, df_dx_output, h_model_output, h_model_IMU_output, h_model_GNSS_output);
     }
+    kf_output.init_cov_propagation(propagate_cov_output);
     Eigen::Matrix<double, 24, 24> P_init_output; // = MD(24, 24)::Identity() * 0.01;
     reset_cov_output(P_init_output);
     kf_output.change_P(P_init_output);
@@ -701,6 +930,9 @@ int main(int argc, char** argv)
                 }
             }
 #endif
+            if (map_server)
+                map_server->update(kf_output.x_.pos, {ivox_.get(), ivox_last_.get()});
+
             Timer timer;
 
             if (flg_first_scan)
@@ -843,6 +1075,7 @@ int main(int argc, char** argv)
                     {p_nmea->p_assign->process_feat_num += time_seq.size();
                     p_nmea->nolidar_cur = false;}
                 double pcl_beg_time = Measures.lidar_beg_time;
+                batch_match_scan(pcl_beg_time, time_predict_last_const);
                 idx = -1;
                 for (k = 0; k < time_seq.size(); k++)
                 {
@@ -889,7 +1122,7 @@ int main(int argc, char** argv)
                     }
                     if(imu_en && !imu_deque.empty())
                     {
-                        bool last_imu = imu_next.header.stamp.toSec() == imu_deque.front()->header.stamp.toSec();
+                        bool last_imu = imu_next.header.stamp.toSec() == imu_deque.front_stamp();
                         while (imu_next.header.stamp.toSec() < time_predict_last_const && !imu_deque.empty())
                         {
                             if (!last_imu)
@@ -910,6 +1143,7 @@ int main(int argc, char** argv)
                         bool imu_comes = time_current >= imu_next.header.stamp.toSec();
                         while (imu_comes) 
                         {
+                            apply_graph_backend_results();
                             if (!p_gnss->gnss_msg.empty() && GNSS_ENABLE)
                             {   
                                 gnss_cur = p_gnss->gnss_msg.front();
@@ -943,10 +1177,18 @@ int main(int argc, char** argv)
                                         // p_gnss->processIMUOutput(dt, kf_output.x_.acc, kf_output.x_.omg);
                                         time_predict_last_const = time2sec(gnss_cur[0]->time) - time_diff_gnss_local;
                                         time_update_last = time_predict_last_const;
-                                        p_gnss->processGNSS(gnss_cur, kf_output.x_);
-                                        p_gnss->sqrt_lidar = Eigen::LLT<Eigen::Matrix<double, 24, 24>>(kf_output.P_.inverse()).matrixL().transpose();
-                                        // p_gnss->sqrt_lidar *= 0.002;
-                                        update_gnss = p_gnss->Evaluate(kf_output.x_);
+                                        if (gnss_backend)
+                                        {
+                                            gnss_backend->push(gnss_cur, kf_output.x_, kf_output.P_, time_predict_last_const);
+                                            update_gnss = false;
+                                        }
+                                        else
+                                        {
+                                            p_gnss->processGNSS(gnss_cur, kf_output.x_);
+                                            p_gnss->setLidarCov(kf_output.P_);
+                                            // p_gnss->sqrt_lidar *= 0.002;
+                                            update_gnss = p_gnss->Evaluate(kf_output.x_);
+                                        }
                                         if (!p_gnss->gnss_ready)
                                         {
                                             flg_reset = true;
@@ -971,44 +1213,7 @@ int main(int argc, char** argv)
                                             // gnss_lla_msg.longitude = pos_enu(1);
                                             // gnss_lla_msg.altitude = pos_enu(2);
                                             // pub_gnss_lla.publish(gnss_lla_msg);
-                                            if ((out_state.pos - kf_output.x_.pos).norm() > 0.1 && pose_graph_key_pose.size() > 4)
-                                            {                                                
-                                                curvefitter::PoseData pose_data;
-                                                pose_data.timestamp = time2sec(gnss_cur[0]->time) - time_diff_gnss_local;
-                                                map_time = pose_data.timestamp;
-                                                pose_data.orientation = Sophus::SO3d(Eigen::Quaterniond(kf_output.x_.rot).normalized().toRotationMatrix());
-                                                pose_data.position = kf_output.x_.pos;
-                                                if (map_time > pose_graph_key_pose.back().timestamp) // + 1e-9)
-                                                {
-                                                    pose_time_vector.push_back(pose_data.timestamp);
-                                                    pose_graph_key_pose.emplace_back(pose_data);
-                                                }
-                                                else
-                                                // else if (map_time == pose_time_vector.back())
-                                                {
-                                                    pose_data.timestamp = pose_graph_key_pose.back().timestamp;
-                                                    pose_graph_key_pose.back() = pose_data;
-                                                }
-                                                // curvefitter::Trajectory<4> traj(0.1);
-                                                // std::shared_ptr<curvefitter::Trajectory<4> > Traj_ptr = std::make_shared<curvefitter::Trajectory<4> >(traj);  
-                                                traj_manager->SetTrajectory(std::make_shared<curvefitter::Trajectory<4> >(0.025));
-                                                traj_manager->FitCurve(pose_graph_key_pose[0].orientation.unit_quaternion(), pose_graph_key_pose[0].position, pose_time_vector[0], pose_time_vector.back(), pose_graph_key_pose);
-                                                updatedmap.resize(points_num);
-                                                updatedmap = traj_manager->GetUpdatedMapPoints(pose_time_vector, LiDAR_points);
-                                                ivox_last_->AddPoints(updatedmap);
-                                                ivox_->grids_map_ = ivox_last_->grids_map_;
-                                                // for (auto &t : ivox_last_->grids_map_)
-                                                // {
-                                                    // ivox_->grids_map_[t.first] = (t.second);
-                                                // }
-                                                // ivox_ = std::make_shared<IVoxType>(*ivox_last_);
-                                            }
-                                            else
-                                            {
-                                                ivox_last_->grids_map_ = ivox_->grids_map_;
-                                            }
-                                            // reset_cov_output(kf_output.P_);
-                                            traj_manager->ResetTrajectory(pose_graph_key_pose, pose_time_vector, LiDAR_points, points_num);
+                                            update_map_after_gnss(out_state, time2sec(gnss_cur[0]->time) - time_diff_gnss_local);
                                         }
                                     }
                                     else
@@ -1083,10 +1288,18 @@ int main(int argc, char** argv)
                                         kf_output.predict(dt, Q_output, input_in, true, false);
                                         time_predict_last_const = nmea_cur->header.stamp.toSec() - time_diff_nmea_local;
                                         time_update_last = time_predict_last_const;
-                                        p_nmea->processNMEA(nmea_cur, kf_output.x_);
-                                        p_nmea->sqrt_lidar = Eigen::LLT<Eigen::Matrix<double, 24, 24>>(kf_output.P_.inverse()).matrixL().transpose();
-                                        // p_gnss->sqrt_lidar *= 0.002;
-                                        update_nmea = p_nmea->Evaluate(kf_output.x_);
+                                        if (nmea_backend)
+                                        {
+                                            nmea_backend->push(nmea_cur, kf_output.x_, kf_output.P_, time_predict_last_const);
+                                            update_nmea = false;
+                                        }
+                                        else
+                                        {
+                                            p_nmea->processNMEA(nmea_cur, kf_output.x_);
+                                            p_nmea->setLidarCov(kf_output.P_);
+                                            // p_gnss->sqrt_lidar *= 0.002;
+                                            update_nmea = p_nmea->Evaluate(kf_output.x_);
+                                        }
                                         if (!p_nmea->nmea_ready)
                                         {
                                             flg_reset = true;
@@ -1163,6 +1376,7 @@ int main(int argc, char** argv)
                     {
                         break;
                     }
+                    apply_graph_backend_results();
                     if (!p_gnss->gnss_msg.empty() && GNSS_ENABLE)
                     {
                         gnss_cur = p_gnss->gnss_msg.front();
@@ -1198,10 +1412,18 @@ int main(int argc, char** argv)
 
                                 time_predict_last_const = time2sec(gnss_cur[0]->time) - time_diff_gnss_local;
                                 time_update_last = time_predict_last_const;
-                                p_gnss->processGNSS(gnss_cur, kf_output.x_);
-                                p_gnss->sqrt_lidar = Eigen::LLT<Eigen::Matrix<double, 24, 24>>(kf_output.P_.inverse()).matrixL().transpose();
-                                // p_gnss->sqrt_lidar *= 0.002;
-                                update_gnss = p_gnss->Evaluate(kf_output.x_);
+                                if (gnss_backend)
+                                {
+                                    gnss_backend->push(gnss_cur, kf_output.x_, kf_output.P_, time_predict_last_const);
+                                    update_gnss = false;
+                                }
+                                else
+                                {
+                                    p_gnss->processGNSS(gnss_cur, kf_output.x_);
+                                    p_gnss->setLidarCov(kf_output.P_);
+                                    // p_gnss->sqrt_lidar *= 0.002;
+                                    update_gnss = p_gnss->Evaluate(kf_output.x_);
+                                }
                                 if (!p_gnss->gnss_ready)
                                 {
                                     flg_reset = true;
@@ -1227,38 +1449,7 @@ int main(int argc, char** argv)
                                     // gnss_lla_msg.longitude = pos_enu(1);
                                     // gnss_lla_msg.altitude = pos_enu(2);
                                     // pub_gnss_lla.publish(gnss_lla_msg);
-                                    if ((out_state.pos - kf_output.x_.pos).norm() > 0.1 && pose_graph_key_pose.size() > 4)
-                                    {                                         
-                                        curvefitter::PoseData pose_data;
-                                        pose_data.timestamp = time2sec(gnss_cur[0]->time) - time_diff_gnss_local;
-                                        map_time = pose_data.timestamp;
-                                        // pose_time_vector.push_back(pose_data.timestamp);
-                                        pose_data.orientation = Sophus::SO3d(Eigen::Quaterniond(kf_output.x_.rot).normalized().toRotationMatrix());
-                                        pose_data.position = kf_output.x_.pos;
-                                        if (map_time > pose_graph_key_pose.back().timestamp) // + 1e-9)
-                                        {
-                                            pose_time_vector.push_back(pose_data.timestamp);
-                                            pose_graph_key_pose.emplace_back(pose_data);
-                                        }
-                                        else
-                                        // else if (map_time == pose_time_vector.back())
-                                        {
-                                            pose_data.timestamp = pose_graph_key_pose.back().timestamp;
-                                            pose_graph_key_pose.back() = pose_data;
-                                        }
-                                        // pose_graph_key_pose.emplace_back(pose_data);
-                                        traj_manager->SetTrajectory(std::make_shared<curvefitter::Trajectory<4> >(0.025));
-                                        traj_manager->FitCurve(pose_graph_key_pose[0].orientation.unit_quaternion(), pose_graph_key_pose[0].position, pose_time_vector[0], pose_time_vector.back(), pose_graph_key_pose);
-                                        updatedmap.resize(points_num);
-                                        updatedmap = traj_manager->GetUpdatedMapPoints(pose_time_vector, LiDAR_points);
-                                        ivox_last_->AddPoints(updatedmap);
-                                        ivox_->grids_map_ = ivox_last_->grids_map_;
-                                    }
-                                    else
-                                    {
-                                        ivox_last_->grids_map_ = ivox_->grids_map_;
-                                    }
-                                    traj_manager->ResetTrajectory(pose_graph_key_pose, pose_time_vector, LiDAR_points, points_num);
+                                    update_map_after_gnss(out_state, time2sec(gnss_cur[0]->time) - time_diff_gnss_local);
                                 }
                             }
                             else
@@ -1331,10 +1522,18 @@ int main(int argc, char** argv)
 
                                 time_predict_last_const = nmea_cur->header.stamp.toSec() - time_diff_nmea_local;
                                 time_update_last = time_predict_last_const;
-                                p_nmea->processNMEA(nmea_cur, kf_output.x_);
-                                p_nmea->sqrt_lidar = Eigen::LLT<Eigen::Matrix<double, 24, 24>>(kf_output.P_.inverse()).matrixL().transpose();
-                                // p_gnss->sqrt_lidar *= 0.002;
-                                update_nmea = p_nmea->Evaluate(kf_output.x_);
+                                if (nmea_backend)
+                                {
+                                    nmea_backend->push(nmea_cur, kf_output.x_, kf_output.P_, time_predict_last_const);
+                                    update_nmea = false;
+                                }
+                                else
+                                {
+                                    p_nmea->processNMEA(nmea_cur, kf_output.x_);
+                                    p_nmea->setLidarCov(kf_output.P_);
+                                    // p_gnss->sqrt_lidar *= 0.002;
+                                    update_nmea = p_nmea->Evaluate(kf_output.x_);
+                                }
                                 if (!p_nmea->nmea_ready)
                                 {
                                     flg_reset = true;
@@ -1447,6 +1646,7 @@ int main(int argc, char** argv)
                 // lidar退化,此时使用pre_integration积分得到需要的相对位姿变换
                 else
                 {
+                    flush_graph_backends(); // the graph is updated in this thread without lidar
                     if (GNSS_ENABLE)  p_gnss->nolidar_cur = true;
                     if (NMEA_ENABLE)  p_nmea->nolidar_cur = true;
                     if (!imu_deque.empty())
@@ -1585,7 +1785,7 @@ int main(int argc, char** argv)
                                 p_gnss->processGNSS(gnss_cur, kf_output.x_);
                                 if (!nolidar)
                                 {
-                                    p_gnss->sqrt_lidar = Eigen::LLT<Eigen::Matrix<double, 24, 24>>(kf_output.P_.inverse()).matrixL().transpose();
+                                    p_gnss->setLidarCov(kf_output.P_);
                                 }
                                 update_gnss = p_gnss->Evaluate(kf_output.x_); 
                                 if (!p_gnss->gnss_ready)
@@ -1605,45 +1805,7 @@ int main(int argc, char** argv)
                                         state_output out_state = kf_output.x_;
                                         kf_output.update_iterated_dyn_share_GNSS();
                                         // reset_cov_output(kf_output.P_);
-                                        if ((out_state.pos - kf_output.x_.pos).norm() > 0.1 && pose_graph_key_pose.size() > 4)
-                                        {                                    
-                                            curvefitter::PoseData pose_data;
-                                            pose_data.timestamp = time2sec(gnss_cur[0]->time) - time_diff_gnss_local;
-                                            map_time = pose_data.timestamp;
-                                            // pose_time_vector.push_back(pose_data.timestamp);
-                                            pose_data.orientation = Sophus::SO3d(Eigen::Quaterniond(kf_output.x_.rot).normalized().toRotationMatrix());
-                                            pose_data.position = kf_output.x_.pos;
-                                            if (map_time > pose_graph_key_pose.back().timestamp) // + 1e-9)
-                                            {
-                                                pose_time_vector.push_back(pose_data.timestamp);
-                                                pose_graph_key_pose.emplace_back(pose_data);
-                                            }
-                                            // else if (map_time == pose_time_vector.back())
-                                            else
-                                            {
-                                                pose_data.timestamp = pose_graph_key_pose.back().timestamp;
-                                                pose_graph_key_pose.back() = pose_data;
-                                            }
-                                            // pose_graph_key_pose.emplace_back(pose_data);
-                                            // curvefitter::Trajectory<4> traj(0.1);
-                                            // std::shared_ptr<curvefitter::Trajectory<4> > Traj_ptr = std::make_shared<curvefitter::Trajectory<4> >(traj);  
-                                            traj_manager->SetTrajectory(std::make_shared<curvefitter::Trajectory<4> >(0.025));
-                                            traj_manager->FitCurve(pose_graph_key_pose[0].orientation.unit_quaternion(), pose_graph_key_pose[0].position, pose_time_vector[0], pose_time_vector.back(), pose_graph_key_pose);
-                                            updatedmap.resize(points_num);
-                                            updatedmap = traj_manager->GetUpdatedMapPoints(pose_time_vector, LiDAR_points);
-                                            ivox_last_->AddPoints(updatedmap);
-                                            ivox_->grids_map_ = ivox_last_->grids_map_;
-                                            // for (auto &t : ivox_last_->grids_map_)
-                                            // {
-                                                // (ivox_->grids_map_[t.first]) = (t.second);
-                                            // }
-                                            // ivox_ = std::make_shared<IVoxType>(*ivox_last_);
-                                        }
-                                        else
-                                        {
-                                            ivox_last_->grids_map_ = ivox_->grids_map_;
-                                        }
-                                        traj_manager->ResetTrajectory(pose_graph_key_pose, pose_time_vector, LiDAR_points, points_num);
+                                        update_map_after_gnss(out_state, time2sec(gnss_cur[0]->time) - time_diff_gnss_local);
                                     }
                                     Eigen::Vector3d pos_enu;
                                     if (!runtime_pos_log) cout_state_to_file(pos_enu);
@@ -1741,7 +1903,7 @@ int main(int argc, char** argv)
                                 p_nmea->processNMEA(nmea_cur, kf_output.x_);
                                 if (!nolidar)
                                 {
-                                    p_nmea->sqrt_lidar = Eigen::LLT<Eigen::Matrix<double, 24, 24>>(kf_output.P_.inverse()).matrixL().transpose();
+                                    p_nmea->setLidarCov(kf_output.P_);
                                 }
                                 update_nmea = p_nmea->Evaluate(kf_output.x_); 
                                 if (!p_nmea->nmea_ready)
@@ -1853,12 +2015,20 @@ int main(int argc, char** argv)
 
 #if 1
             LOG_INFO("location valid. feats_down = %lu, cost time = %.1fms.", feats_down_world->size(), timer.elapsedLast());
+            for (size_t l = 0; !ivox_levels_.empty() && l <= ivox_levels_.size(); l++)
+            {
+                LOG_INFO("ivox level %lu: planes found = %d, missed = %d.", l, level_hits[l], level_misses[l]);
+                level_hits[l] = 0;
+                level_misses[l] = 0;
+            }
             std::cout << std::fixed << std::setprecision(10);
             std::cout << "pos = " << kf_output.x_.pos << std::endl;
             printf("rot = %f, %f, %f, %f, %f, %f, %f, %f, %f\n",
                    kf_output.x_.rot(0, 0), kf_output.x_.rot(0, 1), kf_output.x_.rot(0, 2),
                    kf_output.x_.rot(1, 0), kf_output.x_.rot(1, 1), kf_output.x_.rot(1, 2),
                    kf_output.x_.rot(2, 0), kf_output.x_.rot(2, 1), kf_output.x_.rot(2, 2));
+            if (!gnss_backend || gnss_backend->idle()) // the graph is not read while the backend updates it
+            {
             Eigen::Vector3d anc_cur;
             Eigen::Matrix3d R_enu_local_;
             anc_cur = p_gnss->p_assign->isamCurrentEstimate.at<gtsam::Vector3>(E(0));
@@ -1868,6 +2038,7 @@ int main(int argc, char** argv)
                    R_enu_local_(0, 0), R_enu_local_(0, 1), R_enu_local_(0, 2),
                    R_enu_local_(1, 0), R_enu_local_(1, 1), R_enu_local_(1, 2),
                    R_enu_local_(2, 0), R_enu_local_(2, 1), R_enu_local_(2, 2));
+            }
 #endif
             t5 = omp_get_wtime();
             /******* Publish points *******/
@@ -1878,6 +2049,7 @@ int main(int argc, char** argv)
         status = ros::ok();
         loop_rate.sleep();
     }
+    print_buffer_status();
     
     return 0;
 }
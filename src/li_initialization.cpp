@@ -58,11 +58,11 @@ int scan_count_point = 0;
 int frame_ct = 0, wait_num = 0;
 std::mutex m_time;
 bool lidar_pushed = false, imu_pushed = false;
-std::deque<PointCloudXYZI::Ptr>  lidar_buffer;
-std::deque<double>               time_buffer;
-std::deque<sensor_msgs::Imu::Ptr> imu_deque;
-std::queue<std::vector<ObsPtr>> gnss_meas_buf;
-std::queue<nav_msgs::OdometryPtr> nmea_meas_buf;
+// single producer (sensor callback) / single consumer (main loop), no lock needed
+SpscRingBuffer<PointCloudXYZI::Ptr>    lidar_buffer(LIDAR_BUFFER_SIZE);
+SpscRingBuffer<sensor_msgs::Imu::Ptr>  imu_deque(IMU_BUFFER_SIZE);
+SpscRingBuffer<std::vector<ObsPtr>>    gnss_meas_buf(GNSS_BUFFER_SIZE);
+SpscRingBuffer<nav_msgs::OdometryPtr>  nmea_meas_buf(NMEA_BUFFER_SIZE);
 
 void gnss_ephem_callback(const GnssEphemMsgConstPtr &ephem_msg)
 {
@@ -107,10 +107,10 @@ void gnss_meas_callback(const GnssMeasMsgConstPtr &meas_msg)
     // cerr << "gnss ts is " << std::setprecision(20) << time2sec(gnss_meas[0]->time) << endl;
     if (!time_diff_valid)   return;
 
-    // mtx_buffer.lock();
-    gnss_meas_buf.push(std::move(gnss_meas)); // ?
-    // mtx_buffer.unlock();
-    // sig_buffer.notify_all(); // notify_one()?
+    if (!gnss_meas_buf.push_back(std::move(gnss_meas), latest_gnss_time))
+    {
+        ROS_WARN_THROTTLE(1.0, "gnss buffer rejects measurement, dropped %lu, out of order %lu", gnss_meas_buf.num_dropped(), gnss_meas_buf.num_out_of_order());
+    }
 }
 
 void gnss_meas_callback_urbannav(const nlosExclusion::GNSS_Raw_ArrayConstPtr &meas_msg)
@@ -122,7 +122,10 @@ void nmea_meas_callback(const nav_msgs::OdometryConstPtr &meas_msg)
 {    
     nav_msgs::OdometryPtr nmea_meas(new nav_msgs::Odometry(*meas_msg));
     last_nmea_time = nmea_meas->header.stamp.toSec();
-    nmea_meas_buf.push(std::move(nmea_meas)); // ?
+    if (!nmea_meas_buf.push_back(std::move(nmea_meas), last_nmea_time))
+    {
+        ROS_WARN_THROTTLE(1.0, "nmea buffer rejects measurement, dropped %lu, out of order %lu", nmea_meas_buf.num_dropped(), nmea_meas_buf.num_out_of_order());
+    }
 }
 
 void gpsHandler(const sensor_msgs::NavSatFixConstPtr& gpsMsg)
@@ -150,7 +153,7 @@ void gpsHandler(const sensor_msgs::NavSatFixConstPtr& gpsMsg)
     // gps_odom->pose.pose.orientation = tf::createQuaternionMsgFromRollPitchYaw(0.0, 0.0, 0.0);
     // pubGpsOdom.publish(gps_odom);
     // gpsQueue.push_back(gps_odom);
-    nmea_meas_buf.push(nav_msgs::OdometryPtr(new nav_msgs::Odometry(gps_odom)));
+    nmea_meas_buf.push_back(nav_msgs::OdometryPtr(new nav_msgs::Odometry(gps_odom)), gps_odom.header.stamp.toSec());
 }
 
 void local_trigger_info_callback(const ligo::LocalSensorExternalTriggerConstPtr &trigger_msg) // pps time sync
@@ -189,6 +192,14 @@ void gnss_tp_info_callback(const GnssTimePulseInfoMsgConstPtr &tp_msg) // time s
     next_pulse_time_valid = true;
 }
 
+void push_lidar(const PointCloudXYZI::Ptr &ptr, double stamp)
+{
+    if (!lidar_buffer.push_back(ptr, stamp))
+    {
+        ROS_WARN_THROTTLE(1.0, "lidar buffer rejects scan, dropped %lu, out of order %lu", lidar_buffer.num_dropped(), lidar_buffer.num_out_of_order());
+    }
+}
+
 void standard_pcl_cbk(const sensor_msgs::PointCloud2::ConstPtr &msg) 
 {
     // mtx_buffer.lock();
@@ -225,9 +236,7 @@ void standard_pcl_cbk(const sensor_msgs::PointCloud2::ConstPtr &msg)
             PointCloudXYZI::Ptr  ptr_con_i(new PointCloudXYZI(10000,1));
             // cout << "ptr div num:" << ptr_div->size() << endl;
             *ptr_con_i = *ptr_con;
-            lidar_buffer.push_back(ptr_con_i);
-            double time_con_i = time_con;
-            time_buffer.push_back(time_con_i);
+            push_lidar(ptr_con_i, time_con);
             ptr_con->clear();
             frame_ct = 0;
         }
@@ -236,8 +245,7 @@ void standard_pcl_cbk(const sensor_msgs::PointCloud2::ConstPtr &msg)
     { 
         if (ptr->points.size() > 0)
         {
-            lidar_buffer.emplace_back(ptr);
-            time_buffer.emplace_back(msg->header.stamp.toSec());
+            push_lidar(ptr, msg->header.stamp.toSec());
         }
     }
     }
@@ -285,9 +293,7 @@ void livox_pcl_cbk(const livox_ros_driver::CustomMsg::ConstPtr &msg)
         {
             PointCloudXYZI::Ptr  ptr_con_i(new PointCloudXYZI(10000,1));
             *ptr_con_i = *ptr_con;
-            double time_con_i = time_con;
-            lidar_buffer.push_back(ptr_con_i);
-            time_buffer.push_back(time_con_i);
+            push_lidar(ptr_con_i, time_con);
             ptr_con->clear();
             frame_ct = 0;
         }
@@ -296,8 +302,7 @@ void livox_pcl_cbk(const livox_ros_driver::CustomMsg::ConstPtr &msg)
     {
         if (ptr->points.size() > 0)
         {
-            lidar_buffer.emplace_back(ptr);
-            time_buffer.emplace_back(msg->header.stamp.toSec());
+            push_lidar(ptr, msg->header.stamp.toSec());
         }
     }
     }
@@ -330,7 +335,11 @@ void imu_cbk(const sensor_msgs::Imu::ConstPtr &msg_in)
         return;
     }
 
-    imu_deque.emplace_back(msg);
+    if (!imu_deque.push_back(msg, timestamp))
+    {
+        ROS_WARN_THROTTLE(1.0, "imu buffer rejects message, dropped %lu, out of order %lu", imu_deque.num_dropped(), imu_deque.num_out_of_order());
+        return;
+    }
     last_timestamp_imu = timestamp;
     // mtx_buffer.unlock();
     // sig_buffer.notify_all();
@@ -349,8 +358,8 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
             }
             else
             {
-                // double imu_time = imu_deque.front()->header.stamp.toSec();
-                // double front_gnss_ts = time2sec(gnss_meas_buf.front()[0]->time); // take time
+                // double imu_time = imu_deque.front_stamp();
+                // double front_gnss_ts = gnss_meas_buf.front_stamp(); // take time
                 // if (last_timestamp_imu < front_gnss_ts - time_diff_gnss_local)
                 // {
                     // return false;
@@ -360,14 +369,11 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
                     // imu_last = *(imu_deque.front());
                     // imu_deque.pop_front();
                     // if(imu_deque.empty()) break;
-                    // imu_time = imu_deque.front()->header.stamp.toSec(); // can be changed
+                    // imu_time = imu_deque.front_stamp(); // can be changed
                     // imu_next = *(imu_deque.front());
                 // }
                 // else
-                while (!imu_deque.empty())
-                {
-                    imu_deque.pop_front();
-                }
+                imu_deque.clear();
                 {
                     is_first_gnss = false;
                 }
@@ -382,10 +388,7 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
             }
             else
             {
-                while (!imu_deque.empty())
-                {
-                    imu_deque.pop_front();
-                }
+                imu_deque.clear();
                 {
                     is_first_nmea = false;
                 }
@@ -398,7 +401,7 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
             return false;
         }
         
-        imu_first_time = imu_deque.front()->header.stamp.toSec(); // 
+        imu_first_time = imu_deque.front_stamp(); // 
 
         if ((latest_gnss_time < time_diff_gnss_local + imu_first_time + lidar_time_inte) && GNSS_ENABLE)
         {
@@ -423,10 +426,10 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
 
         if (!imu_pushed)
         { 
-            double imu_time = imu_deque.front()->header.stamp.toSec();
+            double imu_time = imu_deque.front_stamp();
             // imu_first_time = imu_time;
 
-            double imu_last_time = imu_deque.back()->header.stamp.toSec();
+            double imu_last_time = imu_deque.back_stamp();
             if (imu_last_time - imu_first_time < lidar_time_inte)
             {
                 return false;
@@ -442,17 +445,17 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
                     imu_last = imu_next;
                     imu_deque.pop_front();
                     if(imu_deque.empty()) break;
-                    imu_time = imu_deque.front()->header.stamp.toSec(); // can be changed
+                    imu_time = imu_deque.front_stamp(); // can be changed
                     imu_next = *(imu_deque.front());
                 }
                 if (!gnss_meas_buf.empty())
                 {
-                    double front_gnss_ts = time2sec(gnss_meas_buf.front()[0]->time); // take time
+                    double front_gnss_ts = gnss_meas_buf.front_stamp(); // take time
                     while (front_gnss_ts < imu_first_time + lidar_time_inte + time_diff_gnss_local)
                     {
-                        gnss_meas_buf.pop();
+                        gnss_meas_buf.pop_front();
                         if(gnss_meas_buf.empty()) break;
-                        front_gnss_ts = time2sec(gnss_meas_buf.front()[0]->time); // take time
+                        front_gnss_ts = gnss_meas_buf.front_stamp(); // take time
                     }
                     if (meas.imu.empty())
                     {
@@ -461,12 +464,12 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
                 }
                 if (!nmea_meas_buf.empty())
                 {
-                    double front_nmea_ts = nmea_meas_buf.front()->header.stamp.toSec(); // take time
+                    double front_nmea_ts = nmea_meas_buf.front_stamp(); // take time
                     while (front_nmea_ts < imu_first_time + lidar_time_inte + time_diff_nmea_local)
                     {
-                        nmea_meas_buf.pop();
+                        nmea_meas_buf.pop_front();
                         if(nmea_meas_buf.empty()) break;
-                        front_nmea_ts = nmea_meas_buf.front()->header.stamp.toSec(); // take time
+                        front_nmea_ts = nmea_meas_buf.front_stamp(); // take time
                     }
                     if (meas.imu.empty())
                     {
@@ -487,13 +490,13 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
                 // {
                 //     return false;
                 // }
-                double front_gnss_ts = time2sec(gnss_meas_buf.front()[0]->time); // take time
+                double front_gnss_ts = gnss_meas_buf.front_stamp(); // take time
                 while (front_gnss_ts - imu_first_time < time_diff_gnss_local + lidar_time_inte) 
                 {
-                    gnss_msg.push(gnss_meas_buf.front());
-                    gnss_meas_buf.pop();
+                    gnss_msg.push(std::move(gnss_meas_buf.front()));
+                    gnss_meas_buf.pop_front();
                     if (gnss_meas_buf.empty()) break;
-                    front_gnss_ts = time2sec(gnss_meas_buf.front()[0]->time);
+                    front_gnss_ts = gnss_meas_buf.front_stamp();
                 }
 
                 if (!gnss_msg.empty())
@@ -520,13 +523,13 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
         {
             if (!nmea_meas_buf.empty()) // or can wait for a short time?
             {
-                double front_nmea_ts = nmea_meas_buf.front()->header.stamp.toSec(); // take time
+                double front_nmea_ts = nmea_meas_buf.front_stamp(); // take time
                 while (front_nmea_ts - imu_first_time < time_diff_nmea_local + lidar_time_inte) 
                 {
-                    nmea_msg.push(nmea_meas_buf.front());
-                    nmea_meas_buf.pop();
+                    nmea_msg.push(std::move(nmea_meas_buf.front()));
+                    nmea_meas_buf.pop_front();
                     if (nmea_meas_buf.empty()) break;
-                    front_nmea_ts = nmea_meas_buf.front()->header.stamp.toSec();
+                    front_nmea_ts = nmea_meas_buf.front_stamp();
                 }
 
                 if (!nmea_msg.empty())
@@ -551,10 +554,7 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
             }
             else
             {
-                while (!lidar_buffer.empty())
-                {
-                    lidar_buffer.pop_front();
-                }
+                lidar_buffer.clear();
             }
         }
         if (!lidar_buffer.empty())
@@ -562,7 +562,7 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
             if (!lidar_pushed)
             {
                 meas.lidar = lidar_buffer.front();
-                meas.lidar_beg_time = time_buffer.front();
+                meas.lidar_beg_time = lidar_buffer.front_stamp();
                 lose_lid = false;
                 if(meas.lidar->points.size() < 1) 
                 {
@@ -590,26 +590,25 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
             {
                 if (!gnss_meas_buf.empty()) // or can wait for a short time?
                 {
-                    double front_gnss_ts = time2sec(gnss_meas_buf.front()[0]->time);
+                    double front_gnss_ts = gnss_meas_buf.front_stamp();
                     while (front_gnss_ts < meas.lidar_beg_time + time_diff_gnss_local) // 0.05
                     {
                         ROS_WARN("throw gnss, only should happen at the beginning 542");
-                        gnss_meas_buf.pop();
+                        gnss_meas_buf.pop_front();
                         if (gnss_meas_buf.empty()) break;
-                        front_gnss_ts = time2sec(gnss_meas_buf.front()[0]->time);
+                        front_gnss_ts = gnss_meas_buf.front_stamp();
                     }
                     if (!gnss_meas_buf.empty())
                     {
                     while ((!lose_lid && (front_gnss_ts <= lidar_end_time + time_diff_gnss_local)) || (lose_lid && (front_gnss_ts <= meas.lidar_beg_time + time_diff_gnss_local + lidar_time_inte) ))
                     {
-                        gnss_msg.push(gnss_meas_buf.front());
-                        gnss_meas_buf.pop();
+                        gnss_msg.push(std::move(gnss_meas_buf.front()));
+                        gnss_meas_buf.pop_front();
                         if (gnss_meas_buf.empty()) break;
-                        front_gnss_ts = time2sec(gnss_meas_buf.front()[0]->time);
+                        front_gnss_ts = gnss_meas_buf.front_stamp();
                     }
                     if (!gnss_msg.empty())
                     {
-                        time_buffer.pop_front();
                         lidar_buffer.pop_front();
                         lidar_pushed = false;
                         return true;
@@ -634,26 +633,25 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
             {
                 if (!nmea_meas_buf.empty()) // or can wait for a short time?
                 {
-                    double front_nmea_ts = nmea_meas_buf.front()->header.stamp.toSec();
+                    double front_nmea_ts = nmea_meas_buf.front_stamp();
                     while (front_nmea_ts < meas.lidar_beg_time + time_diff_nmea_local) // 0.05
                     {
                         ROS_WARN("throw nmea, only should happen at the beginning 542");
-                        nmea_meas_buf.pop();
+                        nmea_meas_buf.pop_front();
                         if (nmea_meas_buf.empty()) break;
-                        front_nmea_ts = nmea_meas_buf.front()->header.stamp.toSec();
+                        front_nmea_ts = nmea_meas_buf.front_stamp();
                     }
                     if (!nmea_meas_buf.empty())
                     {
                     while ((!lose_lid && (front_nmea_ts <= lidar_end_time + time_diff_nmea_local)) || (lose_lid && (front_nmea_ts <= meas.lidar_beg_time + time_diff_nmea_local + lidar_time_inte) ))
                     {
-                        nmea_msg.push(nmea_meas_buf.front());
-                        nmea_meas_buf.pop();
+                        nmea_msg.push(std::move(nmea_meas_buf.front()));
+                        nmea_meas_buf.pop_front();
                         if (nmea_meas_buf.empty()) break;
-                        front_nmea_ts = nmea_meas_buf.front()->header.stamp.toSec();
+                        front_nmea_ts = nmea_meas_buf.front_stamp();
                     }
                     if (!nmea_msg.empty())
                     {
-                        time_buffer.pop_front();
                         lidar_buffer.pop_front();
                         lidar_pushed = false;
                         return true;
@@ -661,7 +659,6 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
                     }
                 }
             }
-            time_buffer.pop_front();
             lidar_buffer.pop_front();
             lidar_pushed = false;
             if (!lose_lid)
@@ -684,15 +681,9 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
         }
         else
         {
-            while (!lidar_buffer.empty())
-            {
-                lidar_buffer.pop_front();
-            }
+            lidar_buffer.clear();
             is_first_gnss = false;
-            while (!imu_deque.empty())
-            {
-                imu_deque.pop_front();
-            }
+            imu_deque.clear();
         }
     }
 
@@ -705,7 +696,7 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
     {
         lose_lid = false;
         meas.lidar = lidar_buffer.front();
-        meas.lidar_beg_time = time_buffer.front();
+        meas.lidar_beg_time = lidar_buffer.front_stamp();
         if(meas.lidar->points.size() < 1) 
         {
             cout << "lose lidar" << endl;
@@ -747,7 +738,7 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
         /*** push imu data, and pop from imu buffer ***/
         if (p_imu->imu_need_init_)
         {
-            double imu_time = imu_deque.front()->header.stamp.toSec();
+            double imu_time = imu_deque.front_stamp();
             imu_next = *(imu_deque.front());
             meas.imu.shrink_to_fit();
             while (imu_time < lidar_end_time)
@@ -756,19 +747,19 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
                 imu_last = imu_next;
                 imu_deque.pop_front();
                 if(imu_deque.empty()) break;
-                imu_time = imu_deque.front()->header.stamp.toSec(); // can be changed
+                imu_time = imu_deque.front_stamp(); // can be changed
                 imu_next = *(imu_deque.front());
             }
             if (GNSS_ENABLE)
             {
                 if (!gnss_meas_buf.empty())
                 {
-                    double front_gnss_ts = time2sec(gnss_meas_buf.front()[0]->time); // take timedouble front_gnss_ts = time2sec(gnss_meas_buf.front()[0]->time);
+                    double front_gnss_ts = gnss_meas_buf.front_stamp(); // take timedouble front_gnss_ts = gnss_meas_buf.front_stamp();
                     while (front_gnss_ts < lidar_end_time + time_diff_gnss_local)
                     {
-                        gnss_meas_buf.pop();
+                        gnss_meas_buf.pop_front();
                         if(gnss_meas_buf.empty()) break;
-                        front_gnss_ts = time2sec(gnss_meas_buf.front()[0]->time); // take time
+                        front_gnss_ts = gnss_meas_buf.front_stamp(); // take time
                     }
                 }
             }
@@ -776,12 +767,12 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
             {
                 if (!nmea_meas_buf.empty())
                 {
-                    double front_nmea_ts = nmea_meas_buf.front()->header.stamp.toSec(); 
+                    double front_nmea_ts = nmea_meas_buf.front_stamp(); 
                     while (front_nmea_ts < lidar_end_time + time_diff_nmea_local)
                     {
-                        nmea_meas_buf.pop();
+                        nmea_meas_buf.pop_front();
                         if(nmea_meas_buf.empty()) break;
-                        front_nmea_ts = nmea_meas_buf.front()->header.stamp.toSec(); // take time
+                        front_nmea_ts = nmea_meas_buf.front_stamp(); // take time
                     }
                 }
             }
@@ -794,7 +785,7 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
         /*** push imu data, and pop from imu buffer ***/
         if (p_imu->imu_need_init_)
         {
-            double imu_time = imu_deque.front()->header.stamp.toSec();
+            double imu_time = imu_deque.front_stamp();
             meas.imu.shrink_to_fit();
 
             imu_next = *(imu_deque.front());
@@ -804,7 +795,7 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
                 imu_last = imu_next;
                 imu_deque.pop_front();
                 if(imu_deque.empty()) break;
-                imu_time = imu_deque.front()->header.stamp.toSec(); // can be changed
+                imu_time = imu_deque.front_stamp(); // can be changed
                 imu_next = *(imu_deque.front());
             }
 
@@ -812,12 +803,12 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
             {
                 if (!gnss_meas_buf.empty())
                 {
-                    double front_gnss_ts = time2sec(gnss_meas_buf.front()[0]->time); // take time
+                    double front_gnss_ts = gnss_meas_buf.front_stamp(); // take time
                     while (front_gnss_ts < meas.lidar_beg_time + lidar_time_inte + time_diff_gnss_local)
                     {
-                        gnss_meas_buf.pop();
+                        gnss_meas_buf.pop_front();
                         if(gnss_meas_buf.empty()) break;
-                        front_gnss_ts = time2sec(gnss_meas_buf.front()[0]->time); // take time
+                        front_gnss_ts = gnss_meas_buf.front_stamp(); // take time
                     }
                 }
             }
@@ -826,12 +817,12 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
             {
                 if (!nmea_meas_buf.empty())
                 {
-                    double front_nmea_ts = nmea_meas_buf.front()->header.stamp.toSec(); // take time
+                    double front_nmea_ts = nmea_meas_buf.front_stamp(); // take time
                     while (front_nmea_ts < meas.lidar_beg_time + lidar_time_inte + time_diff_nmea_local)
                     {
-                        nmea_meas_buf.pop();
+                        nmea_meas_buf.pop_front();
                         if(nmea_meas_buf.empty()) break;
-                        front_nmea_ts = nmea_meas_buf.front()->header.stamp.toSec(); // take time
+                        front_nmea_ts = nmea_meas_buf.front_stamp(); // take time
                     }
                 }
             }
@@ -844,17 +835,16 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
     {
         if (!gnss_meas_buf.empty()) // or can wait for a short time?
         {
-            double front_gnss_ts = time2sec(gnss_meas_buf.front()[0]->time); // take time
+            double front_gnss_ts = gnss_meas_buf.front_stamp(); // take time
             while ((!lose_lid && (front_gnss_ts < lidar_end_time + time_diff_gnss_local)) || (lose_lid && (front_gnss_ts < meas.lidar_beg_time + time_diff_gnss_local + lidar_time_inte) )) // (front_gnss_ts >= meas.lidar_beg_time + time_diff_gnss_local) && 
             {
-                gnss_msg.push(gnss_meas_buf.front());
-                gnss_meas_buf.pop();
+                gnss_msg.push(std::move(gnss_meas_buf.front()));
+                gnss_meas_buf.pop_front();
                 if (gnss_meas_buf.empty()) break;
-                front_gnss_ts = time2sec(gnss_meas_buf.front()[0]->time);
+                front_gnss_ts = gnss_meas_buf.front_stamp();
             }
             if (!gnss_msg.empty())
             {
-                time_buffer.pop_front();
                 lidar_buffer.pop_front();
                 lidar_pushed = false;
                 imu_pushed = false;
@@ -866,17 +856,16 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
     {
         if (!nmea_meas_buf.empty()) // or can wait for a short time?
         {
-            double front_nmea_ts = nmea_meas_buf.front()->header.stamp.toSec(); // take time
+            double front_nmea_ts = nmea_meas_buf.front_stamp(); // take time
             while ((!lose_lid && (front_nmea_ts < lidar_end_time + time_diff_nmea_local)) || (lose_lid && (front_nmea_ts < meas.lidar_beg_time + time_diff_nmea_local + lidar_time_inte) )) 
             {
-                nmea_msg.push(nmea_meas_buf.front());
-                nmea_meas_buf.pop();
+                nmea_msg.push(std::move(nmea_meas_buf.front()));
+                nmea_meas_buf.pop_front();
                 if (nmea_meas_buf.empty()) break;
-                front_nmea_ts = nmea_meas_buf.front()->header.stamp.toSec();
+                front_nmea_ts = nmea_meas_buf.front_stamp();
             }
             if (!nmea_msg.empty())
             {
-                time_buffer.pop_front();
                 lidar_buffer.pop_front();
                 lidar_pushed = false;
                 imu_pushed = false;
@@ -886,10 +875,18 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
     }
 
     lidar_buffer.pop_front();
-    time_buffer.pop_front();
     lidar_pushed = false;
     imu_pushed = false;
     return true;
     }
 }
 
+
+void print_buffer_status()
+{
+    printf("buffer (size/high/dropped/out of order): lidar %lu/%lu/%lu/%lu, imu %lu/%lu/%lu/%lu, gnss %lu/%lu/%lu/%lu, nmea %lu/%lu/%lu/%lu\n",
+           lidar_buffer.size(), lidar_buffer.high_watermark(), lidar_buffer.num_dropped(), lidar_buffer.num_out_of_order(),
+           imu_deque.size(), imu_deque.high_watermark(), imu_deque.num_dropped(), imu_deque.num_out_of_order(),
+           gnss_meas_buf.size(), gnss_meas_buf.high_watermark(), gnss_meas_buf.num_dropped(), gnss_meas_buf.num_out_of_order(),
+           nmea_meas_buf.size(), nmea_meas_buf.high_watermark(), nmea_meas_buf.num_dropped(), nmea_meas_buf.num_out_of_order());
+}
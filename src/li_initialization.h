@@ -38,7 +38,12 @@
 
 #include <common_lib.h>
 #include "Estimator.h"
+#include <utils/ring_buffer.h>
 #define MAXN                (720000)
+#define LIDAR_BUFFER_SIZE   (1000)
+#define IMU_BUFFER_SIZE     (200000)
+#define GNSS_BUFFER_SIZE    (10000)
+#define NMEA_BUFFER_SIZE    (10000)
 
 extern bool data_accum_finished, data_accum_start, online_calib_finish, refine_print;
 extern int frame_num_init;
@@ -52,11 +57,10 @@ extern condition_variable sig_buffer;
 extern int loop_count;
 extern int scan_count_point;
 extern int frame_ct, wait_num;
-extern std::deque<PointCloudXYZI::Ptr>  lidar_buffer;
-extern std::deque<double>               time_buffer;
-extern std::deque<sensor_msgs::Imu::Ptr> imu_deque;
-extern std::queue<std::vector<ObsPtr>> gnss_meas_buf;
-extern std::queue<nav_msgs::OdometryPtr> nmea_meas_buf;
+extern SpscRingBuffer<PointCloudXYZI::Ptr>    lidar_buffer;
+extern SpscRingBuffer<sensor_msgs::Imu::Ptr>  imu_deque;
+extern SpscRingBuffer<std::vector<ObsPtr>>    gnss_meas_buf;
+extern SpscRingBuffer<nav_msgs::OdometryPtr>  nmea_meas_buf;
 extern std::mutex m_time;
 extern bool lidar_pushed, imu_pushed;
 extern double imu_first_time;
@@ -87,5 +91,6 @@ bool sync_packages(MeasureGroup &meas, queue<std::vector<ObsPtr>> &gnss_msg, que
 // bool sync_packages_nmea(MeasureGroup &meas, queue<nav_msgs::Odometry> &nmea_msg);
 void nmea_meas_callback(const nav_msgs::OdometryConstPtr &meas_msg);
 void gpsHandler(const sensor_msgs::NavSatFixConstPtr& gpsMsg);
+void print_buffer_status();
 
 // #endif
\ No newline at end of file
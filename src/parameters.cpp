@@ -47,6 +47,10 @@ double last_timestamp_lidar = -1.0, last_timestamp_imu = -1.0;
 int pcd_index = 0;
 IVoxType::Options ivox_options_;
 int ivox_nearby_type = 6;
+double map_tile_size = 0, map_load_radius = 150;
+bool ivox_snapshot_en = false;
+int ivox_coarse_levels = 0;
+bool ivox_compact = false;
 
 std::vector<curvefitter::PoseData> pose_graph_key_pose;
 std::vector<double> pose_time_vector;
@@ -60,12 +64,15 @@ bool space_down_sample = true, publish_odometry_without_downsample = false;
 int  init_map_size = 10, con_frame_num = 1;
 double match_s = 81, satu_acc, satu_gyro;
 float  plane_thr = 0.1f;
+double match_reuse_dist = 0.0;
+double plane_cache_resolution = 0.0;
 double filter_size_surf_min = 0.5, filter_size_map_min = 0.5, fov_deg = 180;
 // double cube_len = 2000; 
 float  DET_RANGE = 450;
 bool   imu_en = true;
 bool   init_with_imu = true;
 double imu_time_inte = 0.005, gnss_ekf_noise = 0.01;
+bool   graph_async_backend = false;
 double laser_point_cov = 0.01, acc_norm;
 double vel_cov, acc_cov_input, gyr_cov_input;
 double gyr_cov_output, acc_cov_output, b_gyr_cov, b_acc_cov;
@@ -159,6 +166,8 @@ void readParameters(ros::NodeHandle &nh)
   nh.param<int>("preprocess/scan_rate", p_pre->SCAN_RATE, 10);
   nh.param<int>("preprocess/timestamp_unit", p_pre->time_unit, 1);
   nh.param<double>("mapping/match_s", match_s, 81);
+  nh.param<double>("mapping/match_reuse_dist", match_reuse_dist, 0.0);
+  nh.param<double>("mapping/plane_cache_resolution", plane_cache_resolution, 0.0);
   nh.param<std::vector<double>>("mapping/gravity", gravity, std::vector<double>());
   nh.param<std::vector<double>>("mapping/gravity_init", gravity_init, std::vector<double>());
   nh.param<std::vector<double>>("mapping/extrinsic_T", extrinT, std::vector<double>());
@@ -178,10 +187,20 @@ void readParameters(ros::NodeHandle &nh)
   nh.param<double>("mapping/dyn_filter_resolution",dyn_filter_resolution,0.1);
   // nh.param<double>("gnss/odo_weight",p_gnss->odo_weight, 0.1);
   nh.param<double>("gnss/gnss_ekf_noise",gnss_ekf_noise,0.01);
+  nh.param<bool>("gnss/graph_async_backend",graph_async_backend,false);
   nh.param<vector<double>>("gnss/gnss_extrinsic_T", extrinT_gnss, vector<double>());
   nh.param<vector<double>>("gnss/gnss_extrinsic_R", extrinR_gnss, vector<double>());
 
   nh.param<float>("mapping/ivox_grid_resolution", ivox_options_.resolution_, 0.2);
+  nh.param<bool>("mapping/ivox_copy_on_write", ivox_options_.copy_on_write_, true);
+  int ivox_capacity;
+  nh.param<int>("mapping/ivox_capacity", ivox_capacity, 1000000);
+  ivox_options_.capacity_ = ivox_capacity;
+  nh.param<bool>("mapping/ivox_snapshot", ivox_snapshot_en, false);
+  nh.param<int>("mapping/ivox_coarse_levels", ivox_coarse_levels, 0);
+  nh.param<bool>("mapping/ivox_compact", ivox_compact, false);
+  nh.param<double>("mapping/map_tile_size", map_tile_size, 0);
+  nh.param<double>("mapping/map_load_radius", map_load_radius, 150);
   nh.param<int>("ivox_nearby_type", ivox_nearby_type, 18);
   if (ivox_nearby_type == 0) {
     ivox_options_.nearby_type_ = IVoxType::NearbyType::CENTER;
@@ -226,6 +245,7 @@ void readParameters(ros::NodeHandle &nh)
             time_diff_gnss_local = gnss_local_time_diff;
         }
         nh.param<double>("gnss/gnss_elevation_thres",p_gnss->p_assign->gnss_elevation_threshold, 30.0);
+        nh.param<double>("gnss/atmos_update_thres",p_gnss->p_assign->atmos_update_thres, 0.1);
         nh.param<double>("gnss/prior_noise",p_gnss->p_assign->prior_noise, 0.010);
         nh.param<double>("gnss/marg_noise",p_gnss->p_assign->marg_noise, 0.010);
         nh.param<double>("gnss/b_acc_noise",p_gnss->pre_integration->acc_w, 0.10);
@@ -245,12 +265,22 @@ void readParameters(ros::NodeHandle &nh)
         nh.param<double>("gnss/gnss_cp_time_thres",p_gnss->gnss_cp_time_threshold, 2.0);
         nh.param<int>("gnss/gtsam_variable_thres",p_gnss->delete_thred, 200);
         nh.param<int>("gnss/gtsam_marg_variable_thres",p_gnss->p_assign->marg_thred, 1);
+        nh.param<bool>("gnss/gtsam_fixed_lag",p_gnss->p_assign->fixed_lag, false);
+#ifndef GNSS_FIXED_LAG_SMOOTHER
+        if (p_gnss->p_assign->fixed_lag)
+        {
+            LOG(ERROR) << "gnss/gtsam_fixed_lag needs the fixed-lag smoother of gtsam, which was not found at build time, deleting the factors out of the window instead";
+            p_gnss->p_assign->fixed_lag = false;
+        }
+#endif
+        nh.param<bool>("gnss/gtsam_epoch_factor",p_gnss->epoch_factor, false);
         nh.param<double>("gnss/outlier_thres",p_gnss->p_assign->outlier_thres, 0.1);
         nh.param<double>("gnss/outlier_thres_init",p_gnss->p_assign->outlier_thres_init, 0.1);
         nh.param<double>("gnss/gnss_sample_period",p_gnss->gnss_sample_period, 0.1);
         nh.param<bool>("gnss/nolidar",nolidar, false); // not ready yet. only for information. when this value is true, ligo becomes a system fusing only IMU and GNSS
         nh.param<bool>("gnss/ephem_from_rinex",p_gnss->p_assign->ephem_from_rinex, false);
         nh.param<bool>("gnss/obs_from_rinex",p_gnss->p_assign->obs_from_rinex, false);
+        nh.param<bool>("gnss/rinex_cache",p_gnss->p_assign->rinex_cache, false);
         nh.param<bool>("gnss/pvt_is_gt",p_gnss->p_assign->pvt_is_gt, false);
         nh.param<int>("gnss/window_size",p_gnss->wind_size, 2);
         p_gnss->p_assign->initNoises();
@@ -56,6 +56,7 @@
 #include <csignal>
 #include <unistd.h>
 #include <ivox/ivox3d.h>
+#include <ivox/ivox3d_plane_cache.h>
 #include <Python.h>
 #include <condition_variable>
 #include <sensor_msgs/Imu.h>
@@ -67,7 +68,12 @@
 #include "backend_optimization/Header.h"
 #endif
 
+#ifdef IVOX_NODE_TYPE_FLAT
+using IVoxType = faster_lio::IVox<3, faster_lio::IVoxNodeType::FLAT, PointType>;
+#else
 using IVoxType = faster_lio::IVox<3, faster_lio::IVoxNodeType::DEFAULT, PointType>;
+#endif
+using PlaneCacheType = faster_lio::IVoxPlaneCache<PointType>;
 
 extern std::vector<curvefitter::PoseData> pose_graph_key_pose;
 extern std::vector<double> pose_time_vector;
@@ -81,6 +87,10 @@ extern double last_timestamp_lidar, last_timestamp_imu;
 extern int pcd_index;
 extern IVoxType::Options ivox_options_;
 extern int ivox_nearby_type;
+extern double map_tile_size, map_load_radius;
+extern bool ivox_snapshot_en;
+extern int ivox_coarse_levels;
+extern bool ivox_compact;
 extern state_output state_out;
 extern std::string lid_topic, imu_topic;
 extern bool prop_at_freq_of_imu, check_satu, con_frame;
@@ -89,6 +99,8 @@ extern bool publish_odometry_without_downsample;
 extern int  init_map_size, con_frame_num;
 extern double match_s, satu_acc, satu_gyro;
 extern float  plane_thr;
+extern double match_reuse_dist;
+extern double plane_cache_resolution;
 extern double filter_size_surf_min, filter_size_map_min, fov_deg;
 extern float  DET_RANGE;
 extern bool   imu_en, init_with_imu;
@@ -119,6 +131,7 @@ extern std::string gnss_tp_info_topic, local_trigger_info_topic, rtk_pvt_topic,
 extern std::string nmea_meas_topic;
 extern std::vector<double> default_gnss_iono_params;
 extern double gnss_local_time_diff, gnss_ekf_noise;
+extern bool graph_async_backend;
 extern bool next_pulse_time_valid, update_gnss, update_nmea;
 extern bool time_diff_valid, is_first_gnss, is_first_nmea;
 extern double latest_gnss_time, next_pulse_time, last_nmea_time; 
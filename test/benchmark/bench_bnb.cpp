@@ -0,0 +1,111 @@
+// Candidates per second of the bnb occupancy scoring: flat occupancy grid and SoA scan kernel of
+// BranchAndBoundMatcher3D against the former per-candidate transformPointCloud + octree probes.
+//
+// usage: bench_bnb [map.pcd] [num_candidates]
+// without a map a synthetic one (ground, walls and pillars) is used.
+
+#include <random>
+#include <pcl/common/transforms.h>
+#include <pcl/octree/octree.h>
+#include <backend_optimization/global_localization/bnb3d.h>
+
+static PointCloudType::Ptr syntheticMap()
+{
+    PointCloudType::Ptr map(new PointCloudType);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> u(0, 1);
+    auto add = [&map](float x, float y, float z) {
+        PointType p;
+        p.x = x;
+        p.y = y;
+        p.z = z;
+        map->push_back(p);
+    };
+    for (int i = 0; i < 400000; ++i)
+        add(100 * u(rng), 100 * u(rng), 0.02f * u(rng));
+    for (int wall = 0; wall <= 100; wall += 20)
+    {
+        for (int i = 0; i < 40000; ++i)
+        {
+            add(wall, 100 * u(rng), 5 * u(rng));
+            add(100 * u(rng), wall, 5 * u(rng));
+        }
+    }
+    for (int i = 0; i < 100000; ++i)
+    {
+        const float angle = 2 * M_PI * u(rng);
+        add(50 + 0.5f * std::cos(angle) + 10 * std::floor(5 * u(rng)), 50 + 0.5f * std::sin(angle), 5 * u(rng));
+    }
+    return map;
+}
+
+int main(int argc, char **argv)
+{
+    PointCloudType::Ptr map(new PointCloudType);
+    if (argc > 1)
+        pcl::io::loadPCDFile(argv[1], *map);
+    else
+        map = syntheticMap();
+    const int num_candidates = argc > 2 ? atoi(argv[2]) : 2000;
+
+    BnbOptions options;
+    BranchAndBoundMatcher3D matcher(map, options);
+
+    // scan: map points within 30m of the true pose, in the lidar frame
+    Eigen::Vector3f center = Eigen::Vector3f::Zero();
+    for (const auto &p : map->points)
+        center += p.getVector3fMap();
+    center /= map->size();
+    Pose truth(center.x(), center.y(), center.z() + 1.5, 0, 0, 0.3);
+    const Eigen::Matrix4d truth_mat = truth.toMatrix4d();
+    PointCloudType::Ptr scan_world(new PointCloudType), scan(new PointCloudType);
+    for (const auto &p : map->points)
+        if ((p.getVector3fMap() - center).head<2>().norm() < 30)
+            scan_world->push_back(p);
+    pcl::transformPointCloud(*scan_world, *scan, Eigen::Matrix4d(truth_mat.inverse()));
+    const PointCloudType::Ptr filter_scan = matcher.filterScan(scan, options);
+    const ScanSoA scan_soa(filter_scan);
+
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> u(-1, 1);
+    std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> poses;
+    for (int i = 0; i < num_candidates; ++i)
+    {
+        Pose pose(truth.x + options.linear_xy_window_size * u(rng), truth.y + options.linear_xy_window_size * u(rng),
+                  truth.z + options.linear_z_window_size * u(rng), 0, 0, truth.yaw + options.angular_search_window * u(rng));
+        poses.push_back(pose.toMatrix4d());
+    }
+    printf("map points = %lu, scan points = %d, candidates = %d\n", map->size(), scan_soa.size(), num_candidates);
+
+    for (int depth = 0; depth < options.bnb_depth; ++depth)
+    {
+        pcl::octree::OctreePointCloudSearch<PointType> octree(options.pc_resolutions[depth]);
+        octree.setInputCloud(map);
+        octree.addPointsFromInputCloud();
+
+        std::vector<float> score_octree(num_candidates), score_grid(num_candidates);
+        Timer timer;
+        for (int i = 0; i < num_candidates; ++i)
+        {
+            PointCloudType::Ptr trans_pc(new PointCloudType(filter_scan->points.size(), 1));
+            pcl::transformPointCloud(*filter_scan, *trans_pc, poses[i]);
+            int score = 0;
+            for (const auto &point : trans_pc->points)
+                score += octree.isVoxelOccupiedAtPoint(point);
+            score_octree[i] = static_cast<float>(score) / trans_pc->size();
+        }
+        const double octree_time = timer.elapsedLast();
+        for (int i = 0; i < num_candidates; ++i)
+            score_grid[i] = matcher.calculateOccupancyScore(depth, scan_soa, poses[i]);
+        const double grid_time = timer.elapsedLast();
+
+        // points on voxel borders may round differently in the two kernels
+        double score_diff = 0;
+        for (int i = 0; i < num_candidates; ++i)
+            score_diff = std::max(score_diff, (double)std::fabs(score_octree[i] - score_grid[i]));
+        printf("resolution %.2f: octree %.0f candidates/s, grid %.0f candidates/s (x%.1f), max score difference %.3f\n",
+               options.pc_resolutions[depth], num_candidates / octree_time * 1000, num_candidates / grid_time * 1000,
+               octree_time / grid_time, score_diff);
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+// ns per plane fit: the former QR fit, esti_plane and esti_plane_batch, on the neighbourhoods of the tests.
+//
+// usage: bench_esti_plane [num_fits]
+
+#include <chrono>
+#include <memory>
+#include "../plane_reference.h"
+
+int main(int argc, char **argv)
+{
+    const int num_fits = argc > 1 ? atoi(argv[1]) : 200000;
+    const float threshold = 0.1f;
+    const std::vector<PointVector> neighbourhoods = random_neighbourhoods(num_fits);
+
+    std::vector<Eigen::Vector4d> qr(num_fits);
+    std::vector<Eigen::Vector4f> single(num_fits), batch(num_fits);
+    std::unique_ptr<bool[]> qr_valid(new bool[num_fits]), single_valid(new bool[num_fits]), batch_valid(new bool[num_fits]);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_fits; i++)
+        qr_valid[i] = esti_plane_qr(qr[i], neighbourhoods[i], threshold);
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_fits; i++)
+        single_valid[i] = esti_plane(single[i], neighbourhoods[i], threshold);
+    auto t2 = std::chrono::steady_clock::now();
+    for (int start = 0; start < num_fits; start += PLANE_BATCH_SIZE)
+    {
+        const int num = std::min(PLANE_BATCH_SIZE, num_fits - start);
+        const PointVector *points[PLANE_BATCH_SIZE];
+        for (int l = 0; l < num; l++)
+            points[l] = &neighbourhoods[start + l];
+        esti_plane_batch(&batch[start], &batch_valid[start], points, num, threshold);
+    }
+    auto t3 = std::chrono::steady_clock::now();
+
+    int num_mismatch = 0;
+    double max_diff = 0;
+    for (int i = 0; i < num_fits; i++)
+    {
+        num_mismatch += qr_valid[i] != single_valid[i] || qr_valid[i] != batch_valid[i];
+        if (qr_valid[i] && single_valid[i] && batch_valid[i])
+            max_diff = std::max({max_diff, (qr[i] - single[i].cast<double>()).cwiseAbs().maxCoeff(),
+                                 (qr[i] - batch[i].cast<double>()).cwiseAbs().maxCoeff()});
+    }
+
+    auto ns = [num_fits](std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b)
+    { return std::chrono::duration<double, std::nano>(b - a).count() / num_fits; };
+    printf("%d fits: qr %.1f ns, esti_plane %.1f ns, esti_plane_batch %.1f ns per fit\n", num_fits, ns(t0, t1), ns(t1, t2), ns(t2, t3));
+    printf("against qr: %d different decisions, max parameter difference %g\n", num_mismatch, max_diff);
+    return 0;
+}
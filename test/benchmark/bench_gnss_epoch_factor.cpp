@@ -0,0 +1,144 @@
+// ms per ISAM2 update of a window of synthetic GNSS epochs, with a GnssPsrDoppFactorNoR per satellite against one
+// GnssPsrDoppEpochFactorNoR per epoch (gnss/gtsam_epoch_factor). Both modes see the same measurements, the epochs are
+// chained by between factors on their states and share the extrinsics like in the node.
+//
+// usage: bench_gnss_epoch_factor [num_epochs] [num_satellites]
+
+#include <chrono>
+#include <random>
+#include <gnss_comm/gnss_constant.hpp>
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/nonlinear/ISAM2.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+#include <gnss_factor/gnss_psr_dopp_factor_nor.hpp>
+#include <gnss_factor/gnss_psr_dopp_epoch_factor.hpp>
+
+using gtsam::symbol_shorthand::A;
+using gtsam::symbol_shorthand::B;
+using gtsam::symbol_shorthand::C;
+using gtsam::symbol_shorthand::E;
+using gtsam::symbol_shorthand::P;
+
+namespace
+{
+struct Epoch
+{
+    gtsam::NonlinearFactorGraph single, epoch; // the gnss factors of each mode
+    gtsam::NonlinearFactorGraph common;        // priors and between factors
+    gtsam::Values values;
+};
+
+const gtsam::Rot3 ext_R = gtsam::Rot3::RzRyRx(0.3, -0.7, 1.1);
+const gtsam::Vector3 ext_p(-2.42e6, 5.38e6, 2.41e6);
+
+// the satellites of epoch k around a receiver moving along x, the pseudo-ranges of some of them are off by 100m
+Epoch make_epoch(int k, int num, std::mt19937 &rng, const gtsam::SharedNoiseModel &noise)
+{
+    std::uniform_real_distribution<double> u(-1, 1);
+
+    Epoch epoch;
+    gtsam::Vector6 pos_vel_bias;
+    pos_vel_bias << 12.0 + 0.1 * k, -3.0, 1.5, 2.0, 0.5, -0.1;
+    const gtsam::Vector4 dt(35.0 + 0.01 * k, 40.0, 32.0, 38.0);
+    const gtsam::Vector1 ddt(0.2);
+    epoch.values.insert(A(k), pos_vel_bias);
+    epoch.values.insert(B(k), dt);
+    epoch.values.insert(C(k), ddt);
+    if (k == 0)
+    {
+        epoch.values.insert(E(0), ext_p);
+        epoch.values.insert(P(0), ext_R);
+        epoch.common.add(gtsam::PriorFactor<gtsam::Vector3>(E(0), ext_p, gtsam::noiseModel::Isotropic::Sigma(3, 1.0)));
+        epoch.common.add(gtsam::PriorFactor<gtsam::Rot3>(P(0), ext_R, gtsam::noiseModel::Isotropic::Sigma(3, 0.01)));
+        epoch.common.add(gtsam::PriorFactor<gtsam::Vector6>(A(0), pos_vel_bias, gtsam::noiseModel::Isotropic::Sigma(6, 0.1)));
+        epoch.common.add(gtsam::PriorFactor<gtsam::Vector4>(B(0), dt, gtsam::noiseModel::Isotropic::Sigma(4, 10.0)));
+        epoch.common.add(gtsam::PriorFactor<gtsam::Vector1>(C(0), ddt, gtsam::noiseModel::Isotropic::Sigma(1, 1.0)));
+    }
+    else
+    {
+        gtsam::Vector6 odo;
+        odo << 0.1, 0.0, 0.0, 0.0, 0.0, 0.0;
+        gtsam::Vector4 ddt4;
+        ddt4 << 0.01, 0.0, 0.0, 0.0;
+        epoch.common.add(gtsam::BetweenFactor<gtsam::Vector6>(A(k - 1), A(k), odo, gtsam::noiseModel::Isotropic::Sigma(6, 0.05)));
+        epoch.common.add(gtsam::BetweenFactor<gtsam::Vector4>(B(k - 1), B(k), ddt4, gtsam::noiseModel::Isotropic::Sigma(4, 0.1)));
+        epoch.common.add(gtsam::BetweenFactor<gtsam::Vector1>(C(k - 1), C(k), gtsam::Vector1(0.0), gtsam::noiseModel::Isotropic::Sigma(1, 0.1)));
+    }
+
+    auto atmos_params = std::make_shared<const ligo::AtmosParams>(ligo::AtmosParams{std::vector<double>(8, 0.0), 1.0});
+    const Eigen::Vector3d hat_omg_T(0.01, -0.02, 0.005);
+    const Eigen::Vector3d receiver = ext_R.matrix() * pos_vel_bias.head<3>() + ext_p;
+    ligo::GnssEpochMeas meas;
+    for (int i = 0; i < num; i++)
+    {
+        const Eigen::Vector3d sv_pos = receiver.normalized() * 2.0e7 + Eigen::Vector3d(u(rng), u(rng), u(rng)) * 1.2e7;
+        const int sys_idx = i % 4;
+        double values[27] = {0};
+        values[0] = 0.1; values[1] = -0.2; values[2] = 0.3;
+        values[3] = sv_pos[0]; values[4] = sv_pos[1]; values[5] = sv_pos[2];
+        values[6] = 1500 * u(rng); values[7] = 1500 * u(rng); values[8] = 1500 * u(rng);
+        values[9] = 1e-5 * u(rng); values[10] = 1e-9; values[11] = 1e-10;
+        values[12] = 1.0 + 0.5 * u(rng); values[13] = 1.0 + 0.5 * u(rng); values[14] = 1.0;
+        values[23] = 1.2e9; values[24] = 1.57542e9;
+        values[25] = (sv_pos - receiver).norm() + dt[sys_idx] + 3 * u(rng) + (u(rng) > 0.9 ? 100 : 0);
+        values[26] = u(rng);
+        epoch.single.add(ligo::GnssPsrDoppFactorNoR(A(k), B(k), C(k), E(0), P(0), false, values, atmos_params, sys_idx, hat_omg_T, noise));
+        meas.push_back(values, sys_idx, false);
+    }
+    epoch.epoch.add(ligo::GnssPsrDoppEpochFactorNoR(A(k), B(k), C(k), E(0), P(0), meas, atmos_params, hat_omg_T, noise));
+    return epoch;
+}
+
+void bench(const char *name, const std::vector<Epoch> &epochs, bool epoch_factor)
+{
+    // the parameters of the node's isam
+    gtsam::ISAM2Params parameters;
+    parameters.relinearizeThreshold = 0.1;
+    parameters.relinearizeSkip = 5;
+    gtsam::ISAM2 isam(parameters);
+
+    double total_ms = 0.0, max_ms = 0.0;
+    for (const Epoch &epoch : epochs)
+    {
+        gtsam::NonlinearFactorGraph graph = epoch.common;
+        graph.push_back(epoch_factor ? epoch.epoch : epoch.single);
+        auto t0 = std::chrono::steady_clock::now();
+        isam.update(graph, epoch.values);
+        isam.update();
+        auto t1 = std::chrono::steady_clock::now();
+        const double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        total_ms += ms;
+        max_ms = std::max(max_ms, ms);
+    }
+    const gtsam::Values estimate = isam.calculateEstimate();
+    const gtsam::Key last = A(epochs.size() - 1);
+    printf("%s: %lu factors, %.3f ms per epoch update (max %.3f), last position error %.3f m\n", name,
+           isam.getFactorsUnsafe().size(), total_ms / epochs.size(), max_ms,
+           (estimate.at<gtsam::Vector6>(last) - epochs.back().values.at<gtsam::Vector6>(last)).head<3>().norm());
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const int num_epochs = argc > 1 ? atoi(argv[1]) : 200;
+    const int num_satellites = argc > 2 ? atoi(argv[2]) : 20;
+    if (num_epochs < 1 || num_satellites < 1)
+    {
+        printf("usage: %s [num_epochs] [num_satellites]\n", argv[0]);
+        return 1;
+    }
+
+    // the robust noise of the node's psr/dopp factors
+    auto noise = gtsam::noiseModel::Robust::Create(gtsam::noiseModel::mEstimator::Cauchy::Create(1.0),
+                                                   gtsam::noiseModel::Diagonal::Variances(gtsam::Vector2(0.5, 0.1)));
+    std::mt19937 rng(3);
+    std::vector<Epoch> epochs;
+    for (int k = 0; k < num_epochs; k++)
+        epochs.push_back(make_epoch(k, num_satellites, rng, noise));
+
+    printf("%d epochs of %d satellites\n", num_epochs, num_satellites);
+    bench("factor per satellite", epochs, false);
+    bench("factor per epoch", epochs, true);
+    return 0;
+}
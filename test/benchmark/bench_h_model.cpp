@@ -0,0 +1,100 @@
+// us per correspondence of h_model_output in localization mode: the plane of the point's voxel from IVoxPlaneCache,
+// falling back to the knn search when the voxel has none, against the knn search and esti_plane for every point.
+//
+// usage: bench_h_model map.pcd scan.pcd [ivox_resolution] [plane_cache_resolution] [plane_thr] [num_runs]
+// the scan is given in the map frame, e.g. a registered scan of the node.
+
+#include <chrono>
+#include <pcl/io/pcd_io.h>
+#include <common_lib.h>
+#include <ivox/ivox3d.h>
+#include <ivox/ivox3d_plane_cache.h>
+
+using IVoxType = faster_lio::IVox<3, faster_lio::IVoxNodeType::DEFAULT, PointType>;
+using PlaneCacheType = faster_lio::IVoxPlaneCache<PointType>;
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        printf("usage: %s map.pcd scan.pcd [ivox_resolution] [plane_cache_resolution] [plane_thr] [num_runs]\n", argv[0]);
+        return 1;
+    }
+    const float ivox_resolution = argc > 3 ? atof(argv[3]) : 0.5f;
+    const float plane_cache_resolution = argc > 4 ? atof(argv[4]) : 0.5f;
+    const float plane_thr = argc > 5 ? atof(argv[5]) : 0.1f;
+    const int num_runs = argc > 6 ? atoi(argv[6]) : 10;
+
+    PointCloudXYZI::Ptr map(new PointCloudXYZI), scan(new PointCloudXYZI);
+    if (pcl::io::loadPCDFile(argv[1], *map) != 0 || pcl::io::loadPCDFile(argv[2], *scan) != 0)
+        return 1;
+
+    IVoxType::Options options;
+    options.resolution_ = ivox_resolution;
+    options.inv_resolution_ = 1.0f / ivox_resolution;
+    options.capacity_ = map->size();
+    IVoxType ivox(options);
+    ivox.AddPoints(map->points);
+    PlaneCacheType plane_cache(plane_cache_resolution, NUM_MATCH_POINTS, plane_thr);
+    auto t0 = std::chrono::steady_clock::now();
+    plane_cache.Build(map->points);
+    auto t1 = std::chrono::steady_clock::now();
+    printf("map %lu points, %lu voxels, %lu planes (%lu within plane_thr) fitted in %.1f ms\n", map->size(), ivox.NumValidGrids(),
+           plane_cache.NumPlanes(), plane_cache.NumValidPlanes(), std::chrono::duration<double, std::milli>(t1 - t0).count());
+
+    const int num_points = scan->size();
+    std::vector<Eigen::Vector4f> knn_planes(num_points), cached_planes(num_points);
+    std::vector<char> knn_valid(num_points), cached_valid(num_points);
+    PointVector points_near;
+    int num_hits = 0;
+
+    t0 = std::chrono::steady_clock::now();
+    for (int run = 0; run < num_runs; run++)
+    {
+        for (int i = 0; i < num_points; i++)
+        {
+            ivox.GetClosestPoint(scan->points[i], points_near, NUM_MATCH_POINTS);
+            knn_valid[i] = points_near.size() >= NUM_MATCH_POINTS && esti_plane(knn_planes[i], points_near, plane_thr);
+        }
+    }
+    t1 = std::chrono::steady_clock::now();
+    for (int run = 0; run < num_runs; run++)
+    {
+        num_hits = 0;
+        for (int i = 0; i < num_points; i++)
+        {
+            const PlaneCacheType::Plane *plane = plane_cache.Find(scan->points[i]);
+            if (plane != nullptr)
+            {
+                cached_planes[i] = plane->abcd;
+                cached_valid[i] = true;
+                num_hits++;
+                continue;
+            }
+            ivox.GetClosestPoint(scan->points[i], points_near, NUM_MATCH_POINTS);
+            cached_valid[i] = points_near.size() >= NUM_MATCH_POINTS && esti_plane(cached_planes[i], points_near, plane_thr);
+        }
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    // agreement of the planes both paths found, by the angle between their normals
+    int num_both = 0, num_only_knn = 0, num_only_cache = 0, num_within_10deg = 0;
+    for (int i = 0; i < num_points; i++)
+    {
+        num_only_knn += knn_valid[i] && !cached_valid[i];
+        num_only_cache += !knn_valid[i] && cached_valid[i];
+        if (knn_valid[i] && cached_valid[i])
+        {
+            num_both++;
+            num_within_10deg += std::fabs(knn_planes[i].head<3>().dot(cached_planes[i].head<3>())) > std::cos(10.0 * M_PI / 180.0);
+        }
+    }
+
+    auto us = [num_points, num_runs](std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b)
+    { return std::chrono::duration<double, std::micro>(b - a).count() / (num_points * num_runs); };
+    printf("scan %d points, %.1f%% from the plane cache: knn + esti_plane %.3f us, plane cache %.3f us per point\n", num_points,
+           100.0 * num_hits / std::max(num_points, 1), us(t0, t1), us(t1, t2));
+    printf("planes found by both %d (%d within 10 deg), only by knn %d, only by the cache %d\n", num_both, num_within_10deg,
+           num_only_knn, num_only_cache);
+    return 0;
+}
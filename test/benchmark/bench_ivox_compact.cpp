@@ -0,0 +1,139 @@
+// knn queries per second and cache misses per query of the map ivox before and after IVox::Compact, for the default
+// and the flat storage. The queries are every 20th map point, searched in morton order of their voxels in
+// KNN_BATCH_SIZE chunks like batch_match_scan does. The neighbours must not change with the compaction.
+//
+// usage: bench_ivox_compact map.pcd [ivox_resolution]
+// the cache misses are read with perf_event_open and reported as -1 where it is not permitted.
+
+#include <chrono>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <pcl/io/pcd_io.h>
+#include <common_lib.h>
+#include <ivox/ivox3d.h>
+
+namespace
+{
+// hardware cache misses of this thread while it is alive
+class CacheMissCounter
+{
+public:
+    CacheMissCounter()
+    {
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd_ >= 0)
+        {
+            ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    ~CacheMissCounter()
+    {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    // -1 if the counter is not available
+    long long Read() const
+    {
+        long long count = -1;
+        if (fd_ < 0 || read(fd_, &count, sizeof(count)) != sizeof(count))
+            return -1;
+        return count;
+    }
+
+private:
+    int fd_;
+};
+
+struct QueryStats
+{
+    double rate;          // queries per second
+    double misses;        // cache misses per query, -1 if not available
+    PointVector neighbours;
+};
+
+template <typename IVoxType>
+QueryStats run_queries(IVoxType &ivox, const PointVector &queries)
+{
+    QueryStats stats;
+    stats.neighbours.resize(queries.size() * NUM_MATCH_POINTS);
+    std::vector<int> num_neighbours(KNN_BATCH_SIZE);
+    PointVector neighbours(KNN_BATCH_SIZE * NUM_MATCH_POINTS);
+    CacheMissCounter counter;
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t start = 0; start < queries.size(); start += KNN_BATCH_SIZE)
+    {
+        const int num = std::min<size_t>(KNN_BATCH_SIZE, queries.size() - start);
+        ivox.GetClosestPoints(&queries[start], num, neighbours.data(), num_neighbours.data(), NUM_MATCH_POINTS);
+        for (int n = 0; n < num; n++)
+            std::copy(neighbours.begin() + n * NUM_MATCH_POINTS, neighbours.begin() + n * NUM_MATCH_POINTS + num_neighbours[n],
+                      stats.neighbours.begin() + (start + n) * NUM_MATCH_POINTS);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    const long long misses = counter.Read();
+    stats.rate = queries.size() / std::chrono::duration<double>(t1 - t0).count();
+    stats.misses = misses < 0 ? -1.0 : double(misses) / queries.size();
+    return stats;
+}
+
+template <faster_lio::IVoxNodeType node_type>
+void bench(const char *name, const PointCloudXYZI &map, float resolution)
+{
+    using IVoxType = faster_lio::IVox<3, node_type, PointType>;
+    typename IVoxType::Options options;
+    options.resolution_ = resolution;
+    options.inv_resolution_ = 1.0f / resolution;
+    options.capacity_ = map.size();
+    IVoxType ivox(options);
+    ivox.AddPoints(map.points);
+
+    PointVector queries;
+    for (size_t i = 0; i < map.size(); i += 20)
+        queries.push_back(map.points[i]);
+    std::sort(queries.begin(), queries.end(), [&ivox](const PointType &a, const PointType &b) {
+        return faster_lio::morton_code(ivox.Pos2Grid(a.getVector3fMap())) < faster_lio::morton_code(ivox.Pos2Grid(b.getVector3fMap()));
+    });
+
+    const QueryStats before = run_queries(ivox, queries);
+    auto t0 = std::chrono::steady_clock::now();
+    ivox.Compact();
+    auto t1 = std::chrono::steady_clock::now();
+    const QueryStats after = run_queries(ivox, queries);
+
+    size_t num_mismatch = 0;
+    for (size_t i = 0; i < before.neighbours.size(); i++)
+        num_mismatch += before.neighbours[i].getVector3fMap() != after.neighbours[i].getVector3fMap();
+    printf("%s: %lu voxels compacted in %.1f ms, %lu queries: %.0f/s, %.1f cache misses per query before, "
+           "%.0f/s, %.1f after, %lu neighbours differ\n",
+           name, ivox.NumValidGrids(), std::chrono::duration<double, std::milli>(t1 - t0).count(), queries.size(), before.rate,
+           before.misses, after.rate, after.misses, num_mismatch);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("usage: %s map.pcd [ivox_resolution]\n", argv[0]);
+        return 1;
+    }
+    const float resolution = argc > 2 ? atof(argv[2]) : 0.5f;
+    PointCloudXYZI::Ptr map(new PointCloudXYZI);
+    if (pcl::io::loadPCDFile(argv[1], *map) != 0)
+        return 1;
+
+    bench<faster_lio::IVoxNodeType::DEFAULT>("default", *map, resolution);
+    bench<faster_lio::IVoxNodeType::FLAT>("flat", *map, resolution);
+    return 0;
+}
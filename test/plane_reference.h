@@ -0,0 +1,54 @@
+#pragma once
+// The QR plane fit esti_plane used before the closed form, in double as the reference of the tests and
+// benchmarks. Also returns the largest point to plane distance, to recognize fits on the threshold.
+
+#include <common_lib.h>
+
+inline bool esti_plane_qr(Eigen::Vector4d &pca_result, const PointVector &point, double threshold, double *max_dist = nullptr)
+{
+    Eigen::Matrix<double, NUM_MATCH_POINTS, 3> A;
+    Eigen::Matrix<double, NUM_MATCH_POINTS, 1> b;
+    b.setConstant(-1.0);
+    for (int j = 0; j < NUM_MATCH_POINTS; j++)
+    {
+        A(j, 0) = point[j].x;
+        A(j, 1) = point[j].y;
+        A(j, 2) = point[j].z;
+    }
+
+    Eigen::Vector3d normvec = A.colPivHouseholderQr().solve(b);
+    double n = normvec.norm();
+    pca_result << normvec / n, 1.0 / n;
+
+    double dist = 0;
+    for (int j = 0; j < NUM_MATCH_POINTS; j++)
+        dist = std::max(dist, std::fabs(pca_result.head<3>().dot(A.row(j).transpose()) + pca_result(3)));
+    if (max_dist != nullptr)
+        *max_dist = dist;
+    return dist <= threshold;
+}
+
+/// num neighbourhoods of NUM_MATCH_POINTS points on small patches far from the origin, a quarter of them too noisy
+inline std::vector<PointVector> random_neighbourhoods(int num, unsigned seed = 1)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> u(-1, 1);
+    std::vector<PointVector> neighbourhoods(num);
+    for (auto &points : neighbourhoods)
+    {
+        Eigen::Vector3d center(200 * u(rng), 200 * u(rng), 20 * u(rng));
+        Eigen::Vector3d normal = Eigen::Vector3d(u(rng), u(rng), u(rng)).normalized();
+        Eigen::Vector3d e1 = normal.unitOrthogonal(), e2 = normal.cross(e1);
+        double noise = rng() % 4 == 0 ? 0.2 : 0.01;
+        for (int j = 0; j < NUM_MATCH_POINTS; j++)
+        {
+            Eigen::Vector3d p = center + 0.5 * u(rng) * e1 + 0.5 * u(rng) * e2 + noise * u(rng) * normal;
+            PointType point;
+            point.x = p.x();
+            point.y = p.y();
+            point.z = p.z();
+            points.push_back(point);
+        }
+    }
+    return neighbourhoods;
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "../src/Estimator.h"
+
+// propagate_cov_output against the dense F * P * F^T with F from df_dx_output
+
+namespace
+{
+typedef Eigen::Matrix<double, 24, 24> Cov24;
+
+V3D random_vector(std::mt19937 &gen, double scale)
+{
+    std::uniform_real_distribution<double> uniform(-scale, scale);
+    return V3D(uniform(gen), uniform(gen), uniform(gen));
+}
+
+state_output random_state(std::mt19937 &gen)
+{
+    state_output s;
+    s.pos = random_vector(gen, 100.0);
+    s.rot = Exp(random_vector(gen, M_PI));
+    s.vel = random_vector(gen, 10.0);
+    s.omg = random_vector(gen, 2.0);
+    s.acc = random_vector(gen, 2.0) + V3D(0.0, 0.0, 9.81);
+    s.gravity = V3D(0.0, 0.0, -9.81);
+    s.bg = random_vector(gen, 0.01);
+    s.ba = random_vector(gen, 0.1);
+    return s;
+}
+
+Cov24 random_cov(std::mt19937 &gen)
+{
+    std::normal_distribution<double> normal;
+    Cov24 A;
+    for (int i = 0; i < A.size(); i++)
+        A(i) = normal(gen);
+    return A * A.transpose() + Cov24::Identity();
+}
+
+double relative_deviation(const Cov24 &expected, const Cov24 &actual)
+{
+    return (expected - actual).cwiseAbs().maxCoeff() / expected.cwiseAbs().maxCoeff();
+}
+} // namespace
+
+TEST(CovPropagation, MatchesDenseProduct)
+{
+    std::mt19937 gen(42);
+    for (double dt : {0.0, 0.001, 0.005, 0.1})
+    {
+        for (int i = 0; i < 20; i++)
+        {
+            state_output s = random_state(gen);
+            const Cov24 P = random_cov(gen);
+            const Cov24 F = df_dx_output(s, input_in, dt);
+            const Cov24 expected = F * P * F.transpose();
+            Cov24 actual = P;
+            propagate_cov_output(s, input_in, dt, actual);
+            EXPECT_LT(relative_deviation(expected, actual), 1e-12) << "dt " << dt << ", state " << i;
+        }
+    }
+}
+
+TEST(CovPropagation, MatchesDenseProductOverManySteps)
+{
+    // the blocks F leaves alone must stay untouched as P grows over a sequence of predictions
+    std::mt19937 gen(7);
+    for (double dt : {0.001, 0.005})
+    {
+        state_output s = random_state(gen);
+        Cov24 expected = random_cov(gen), actual = expected;
+        for (int step = 0; step < 200; step++)
+        {
+            const Cov24 F = df_dx_output(s, input_in, dt);
+            expected = F * expected * F.transpose();
+            propagate_cov_output(s, input_in, dt, actual);
+        }
+        EXPECT_LT(relative_deviation(expected, actual), 1e-9) << "dt " << dt;
+        EXPECT_LT((actual - actual.transpose()).cwiseAbs().maxCoeff() / actual.cwiseAbs().maxCoeff(), 1e-12);
+    }
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include "plane_reference.h"
+
+// esti_plane and esti_plane_batch against the QR fit they replace
+
+namespace
+{
+const float kThreshold = 0.1f;
+const int kNumFits = 20000;
+
+void expect_same_plane(const Eigen::Vector4d &expected, const Eigen::Vector4f &actual)
+{
+    EXPECT_LT((expected - actual.cast<double>()).cwiseAbs().maxCoeff(), 1e-4);
+}
+} // namespace
+
+TEST(EstiPlane, AgreesWithQr)
+{
+    const std::vector<PointVector> neighbourhoods = random_neighbourhoods(kNumFits);
+    int num_valid = 0;
+    for (const auto &points : neighbourhoods)
+    {
+        Eigen::Vector4d expected;
+        double max_dist;
+        const bool expected_valid = esti_plane_qr(expected, points, kThreshold, &max_dist);
+        Eigen::Vector4f actual;
+        const bool valid = esti_plane(actual, points, kThreshold);
+        // fits on the threshold may go either way in float
+        if (std::fabs(max_dist - kThreshold) > 1e-4)
+            EXPECT_EQ(expected_valid, valid);
+        if (expected_valid && valid)
+        {
+            expect_same_plane(expected, actual);
+            num_valid++;
+        }
+    }
+    // both outcomes are covered
+    EXPECT_GT(num_valid, kNumFits / 2);
+    EXPECT_LT(num_valid, kNumFits);
+}
+
+TEST(EstiPlane, BatchAgreesWithSingle)
+{
+    const std::vector<PointVector> neighbourhoods = random_neighbourhoods(kNumFits, 2);
+    // batches of 1 to PLANE_BATCH_SIZE neighbourhoods
+    for (int start = 0, size = 1; start < kNumFits; start += size, size = size % PLANE_BATCH_SIZE + 1)
+    {
+        const int num = std::min(size, kNumFits - start);
+        const PointVector *points[PLANE_BATCH_SIZE];
+        for (int l = 0; l < num; l++)
+            points[l] = &neighbourhoods[start + l];
+        Eigen::Vector4f batch[PLANE_BATCH_SIZE];
+        bool batch_valid[PLANE_BATCH_SIZE];
+        esti_plane_batch(batch, batch_valid, points, num, kThreshold);
+
+        for (int l = 0; l < num; l++)
+        {
+            Eigen::Vector4f single;
+            const bool single_valid = esti_plane(single, *points[l], kThreshold);
+            ASSERT_EQ(single_valid, batch_valid[l]);
+            if (single_valid)
+                EXPECT_LT((single - batch[l]).cwiseAbs().maxCoeff(), 1e-6);
+        }
+    }
+}
+
+TEST(EstiPlane, BatchRejectsDegenerateNeighbourhoods)
+{
+    PointVector collinear, too_few;
+    for (int j = 0; j < NUM_MATCH_POINTS; j++)
+    {
+        PointType point;
+        point.x = 10 + j;
+        point.y = 2 * j;
+        point.z = 5;
+        collinear.push_back(point);
+        if (j < NUM_MATCH_POINTS - 1)
+            too_few.push_back(point);
+    }
+    const PointVector *points[2] = {&collinear, &too_few};
+    Eigen::Vector4f result[2];
+    bool valid[2];
+    esti_plane_batch(result, valid, points, 2, kThreshold);
+    EXPECT_FALSE(valid[0]);
+    EXPECT_FALSE(valid[1]);
+}
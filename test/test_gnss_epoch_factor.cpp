@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <gnss_comm/gnss_constant.hpp>
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/linear/GaussianFactorGraph.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gnss_factor/gnss_psr_dopp_factor_nor.hpp>
+#include <gnss_factor/gnss_psr_dopp_epoch_factor.hpp>
+
+// one GnssPsrDoppEpochFactorNoR against the GnssPsrDoppFactorNoR of every satellite of the epoch
+
+using gtsam::symbol_shorthand::A;
+using gtsam::symbol_shorthand::B;
+using gtsam::symbol_shorthand::C;
+using gtsam::symbol_shorthand::E;
+using gtsam::symbol_shorthand::P;
+
+namespace
+{
+struct Epoch
+{
+    gtsam::NonlinearFactorGraph single, epoch;
+    gtsam::Values values;
+};
+
+// num satellites around a receiver, the pseudo-ranges of num_outliers of them are off by 100m
+Epoch make_epoch(int num, int num_outliers, const gtsam::SharedNoiseModel &noise)
+{
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> u(-1, 1);
+
+    Epoch epoch;
+    const gtsam::Rot3 ext_R = gtsam::Rot3::RzRyRx(0.3, -0.7, 1.1);
+    const gtsam::Vector3 ext_p(-2.42e6, 5.38e6, 2.41e6);
+    gtsam::Vector6 pos_vel_bias;
+    pos_vel_bias << 12.0, -3.0, 1.5, 2.0, 0.5, -0.1;
+    const gtsam::Vector4 dt(35.0, 40.0, 32.0, 38.0);
+    const gtsam::Vector1 ddt(0.2);
+    epoch.values.insert(A(0), pos_vel_bias);
+    epoch.values.insert(B(0), dt);
+    epoch.values.insert(C(0), ddt);
+    epoch.values.insert(E(0), ext_p);
+    epoch.values.insert(P(0), ext_R);
+
+    auto atmos_params = std::make_shared<const ligo::AtmosParams>(ligo::AtmosParams{std::vector<double>(8, 0.0), 1.0});
+    const Eigen::Vector3d hat_omg_T(0.01, -0.02, 0.005);
+    const Eigen::Vector3d receiver = ext_R.matrix() * pos_vel_bias.head<3>() + ext_p;
+    ligo::GnssEpochMeas meas;
+    for (int i = 0; i < num; i++)
+    {
+        const Eigen::Vector3d sv_pos = receiver.normalized() * 2.0e7 + Eigen::Vector3d(u(rng), u(rng), u(rng)) * 1.2e7;
+        const int sys_idx = i % 4;
+        const bool invalid_lidar = i == 1;
+        double values[27] = {0};
+        values[0] = 0.1; values[1] = -0.2; values[2] = 0.3;
+        values[3] = sv_pos[0]; values[4] = sv_pos[1]; values[5] = sv_pos[2];
+        values[6] = 1500 * u(rng); values[7] = 1500 * u(rng); values[8] = 1500 * u(rng);
+        values[9] = 1e-5 * u(rng); values[10] = 1e-9; values[11] = 1e-10;
+        values[12] = 1.0 + 0.5 * u(rng); values[13] = 1.0 + 0.5 * u(rng); values[14] = 1.0;
+        values[23] = 1.2e9; values[24] = 1.57542e9;
+        values[25] = (sv_pos - receiver).norm() + dt[sys_idx] + 3 * u(rng) + (i < num_outliers ? 100 : 0);
+        values[26] = u(rng);
+        epoch.single.add(ligo::GnssPsrDoppFactorNoR(A(0), B(0), C(0), E(0), P(0), invalid_lidar, values, atmos_params, sys_idx, hat_omg_T, noise));
+        meas.push_back(values, sys_idx, invalid_lidar);
+    }
+    epoch.epoch.add(ligo::GnssPsrDoppEpochFactorNoR(A(0), B(0), C(0), E(0), P(0), meas, atmos_params, hat_omg_T, noise));
+    return epoch;
+}
+
+void expect_same_cost_and_linearization(const Epoch &epoch)
+{
+    const double single_error = epoch.single.error(epoch.values);
+    EXPECT_NEAR(epoch.epoch.error(epoch.values), single_error, 1e-9 * single_error);
+
+    gtsam::Ordering ordering;
+    for (gtsam::Key key : {A(0), B(0), C(0), E(0), P(0)})
+        ordering.push_back(key);
+    const gtsam::Matrix single_hessian = epoch.single.linearize(epoch.values)->augmentedHessian(ordering);
+    const gtsam::Matrix epoch_hessian = epoch.epoch.linearize(epoch.values)->augmentedHessian(ordering);
+    EXPECT_LT((single_hessian - epoch_hessian).cwiseAbs().maxCoeff(), 1e-9 * single_hessian.cwiseAbs().maxCoeff());
+}
+} // namespace
+
+TEST(GnssPsrDoppEpochFactor, GaussianCostMatchesSingleFactors)
+{
+    expect_same_cost_and_linearization(make_epoch(12, 0, gtsam::noiseModel::Diagonal::Variances(gtsam::Vector2(0.5, 0.1))));
+}
+
+TEST(GnssPsrDoppEpochFactor, RobustCostMatchesSingleFactors)
+{
+    auto noise = gtsam::noiseModel::Robust::Create(gtsam::noiseModel::mEstimator::Cauchy::Create(1.0),
+                                                   gtsam::noiseModel::Diagonal::Variances(gtsam::Vector2(0.5, 0.1)));
+    const Epoch epoch = make_epoch(12, 3, noise);
+    expect_same_cost_and_linearization(epoch);
+
+    // the outliers are bounded by the kernel, the squared reweighted residual would not be the cost
+    const gtsam::Vector whitened = boost::dynamic_pointer_cast<gtsam::NoiseModelFactor>(epoch.epoch[0])->unwhitenedError(epoch.values);
+    EXPECT_GT(std::fabs(0.5 * whitened.squaredNorm() - epoch.epoch.error(epoch.values)), 1e-6);
+}
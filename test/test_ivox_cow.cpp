@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <common_lib.h>
+#include <ivox/ivox3d.h>
+
+// the copy on write storage of the ivox: snapshots that do not see later writes, and the capacity bound
+
+namespace
+{
+typedef faster_lio::IVox<3, faster_lio::IVoxNodeType::DEFAULT, PointType> IVoxType;
+
+IVoxType::Options cow_options(size_t capacity)
+{
+    IVoxType::Options options;
+    options.resolution_ = 1.0;
+    options.inv_resolution_ = 1.0;
+    options.capacity_ = capacity;
+    options.copy_on_write_ = true;
+    return options;
+}
+
+PointType make_point(float x, float y, float z)
+{
+    PointType p;
+    p.x = x;
+    p.y = y;
+    p.z = z;
+    return p;
+}
+
+// one point in the middle of each voxel of a row along x
+IVoxType::PointVector row_of_voxels(int begin, int end, float y = 0.5f)
+{
+    IVoxType::PointVector points;
+    for (int x = begin; x < end; x++)
+        points.push_back(make_point(x + 0.5f, y, 0.5f));
+    return points;
+}
+} // namespace
+
+TEST(IVoxCopyOnWrite, SnapshotDoesNotSeeLaterWrites)
+{
+    IVoxType map(cow_options(1000000)), snapshot(cow_options(1000000));
+    map.AddPoints(row_of_voxels(0, 100));
+    snapshot.SnapshotFrom(map);
+    // into existing voxels and new ones
+    map.AddPoints(row_of_voxels(50, 150, 0.25f));
+
+    EXPECT_EQ(snapshot.NumValidGrids(), 100u);
+    EXPECT_EQ(map.NumValidGrids(), 150u);
+    EXPECT_FALSE(snapshot.HasGrid(make_point(120.5f, 0.5f, 0.5f)));
+    IVoxType::PointVector near;
+    snapshot.GetClosestPoint(make_point(60.5f, 0.3f, 0.5f), near, 5);
+    for (const auto &p : near)
+        EXPECT_EQ(p.y, 0.5f);
+    map.GetClosestPoint(make_point(60.5f, 0.3f, 0.5f), near, 1);
+    ASSERT_EQ(near.size(), 1u);
+    EXPECT_EQ(near[0].y, 0.25f);
+}
+
+TEST(IVoxCopyOnWrite, EvictsLeastRecentlyWrittenVoxels)
+{
+    const size_t capacity = 800;
+    IVoxType map(cow_options(capacity)), snapshot(cow_options(capacity));
+    for (int start = 0; start < 10000; start += 100)
+    {
+        map.AddPoints(row_of_voxels(start, start + 100));
+        // keep the first voxel recently written
+        map.AddPoints(row_of_voxels(0, 1));
+        snapshot.SnapshotFrom(map);
+        EXPECT_LT(map.NumValidGrids(), capacity);
+    }
+    EXPECT_GE(map.NumValidGrids(), capacity - capacity / 8);
+    EXPECT_TRUE(map.HasGrid(make_point(0.5f, 0.5f, 0.5f)));
+    EXPECT_TRUE(map.HasGrid(make_point(9999.5f, 0.5f, 0.5f)));
+    EXPECT_FALSE(map.HasGrid(make_point(1.5f, 0.5f, 0.5f)));
+    // every remaining voxel holds its point once
+    EXPECT_EQ(map.StatGridPoints()[0], map.NumValidGrids());
+}
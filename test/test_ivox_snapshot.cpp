@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <random>
+#include <sys/stat.h>
+#include <pcl/io/pcd_io.h>
+#include <common_lib.h>
+#include <ivox/ivox3d.h>
+
+// an ivox loaded from its snapshot against the one built from the map pcd, for every storage of the voxels
+
+namespace
+{
+// ground, walls and scattered points of a map, written to a pcd like the globalmap of the node
+std::string write_map(const std::string &name)
+{
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    PointCloudXYZI map;
+    for (int i = 0; i < 200000; i++)
+    {
+        PointType p;
+        p.x = 100 * uniform(gen) - 50;
+        p.y = 100 * uniform(gen) - 50;
+        p.z = i % 4 == 0 ? 6 * uniform(gen) - 3 : 0.05f * uniform(gen);
+        if (i % 4 == 1)
+            p.x = std::round(p.x / 10) * 10;
+        map.push_back(p);
+    }
+    const std::string path = ::testing::TempDir() + name;
+    pcl::io::savePCDFileBinary(path, map);
+    return path;
+}
+
+template <faster_lio::IVoxNodeType node_type>
+void expect_snapshot_matches_map(bool copy_on_write, const std::string &name)
+{
+    using IVoxType = faster_lio::IVox<3, node_type, PointType>;
+    typename IVoxType::Options options;
+    options.resolution_ = 0.5;
+    options.inv_resolution_ = 2.0;
+    options.nearby_type_ = IVoxType::NearbyType::NEARBY18;
+    options.copy_on_write_ = copy_on_write;
+
+    const std::string map_path = write_map(name + ".pcd");
+    const std::string snapshot_path = map_path + ".ivox";
+    struct stat map_stat;
+    ASSERT_EQ(stat(map_path.c_str(), &map_stat), 0);
+    PointCloudXYZI::Ptr map(new PointCloudXYZI);
+    ASSERT_EQ(pcl::io::loadPCDFile(map_path, *map), 0);
+
+    // built and compacted like init_global_map does before it saves the snapshot
+    IVoxType built(options);
+    built.AddPoints(map->points);
+    built.Compact();
+    ASSERT_TRUE(built.Save(snapshot_path, map_stat.st_size, map_stat.st_mtime));
+
+    IVoxType loaded(options);
+    ASSERT_TRUE(loaded.Load(snapshot_path, map_stat.st_size, map_stat.st_mtime));
+    EXPECT_EQ(built.NumValidGrids(), loaded.NumValidGrids());
+    // voxels holding points and points per voxel
+    EXPECT_EQ(built.StatGridPoints()[0], loaded.StatGridPoints()[0]);
+    EXPECT_EQ(built.StatGridPoints()[1], loaded.StatGridPoints()[1]);
+
+    // map points and queries off the map, with voxels out of the map and partly filled neighbourhoods
+    typename IVoxType::PointVector queries;
+    for (size_t i = 0; i < map->size(); i += 50)
+        queries.push_back(map->points[i]);
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<float> uniform(-60.0f, 60.0f);
+    for (int i = 0; i < 2000; i++)
+    {
+        PointType p;
+        p.x = uniform(gen);
+        p.y = uniform(gen);
+        p.z = uniform(gen) / 10;
+        queries.push_back(p);
+    }
+
+    typename IVoxType::PointVector expected, actual;
+    int num_mismatch = 0;
+    for (const auto &q : queries)
+    {
+        built.GetClosestPoint(q, expected, NUM_MATCH_POINTS);
+        loaded.GetClosestPoint(q, actual, NUM_MATCH_POINTS);
+        bool same = expected.size() == actual.size();
+        for (size_t j = 0; j < expected.size() && same; j++)
+            same = expected[j].getVector3fMap() == actual[j].getVector3fMap();
+        num_mismatch += !same;
+    }
+    EXPECT_EQ(num_mismatch, 0);
+
+    // a snapshot of another version of the map is not loaded
+    IVoxType stale(options);
+    EXPECT_FALSE(stale.Load(snapshot_path, map_stat.st_size + 1, map_stat.st_mtime));
+    EXPECT_FALSE(stale.Load(snapshot_path, map_stat.st_size, map_stat.st_mtime + 1));
+
+    // nor one whose voxels do not own exactly the stored points
+    {
+        std::fstream file(snapshot_path, std::ios::in | std::ios::out | std::ios::binary);
+        faster_lio::IVoxSnapshotGrid grid;
+        file.seekg(sizeof(faster_lio::IVoxSnapshotHeader));
+        file.read(reinterpret_cast<char *>(&grid), sizeof(grid));
+        grid.num_points++;
+        file.seekp(sizeof(faster_lio::IVoxSnapshotHeader));
+        file.write(reinterpret_cast<const char *>(&grid), sizeof(grid));
+    }
+    IVoxType corrupt(options);
+    EXPECT_FALSE(corrupt.Load(snapshot_path, map_stat.st_size, map_stat.st_mtime));
+
+    remove(snapshot_path.c_str());
+    remove(map_path.c_str());
+}
+} // namespace
+
+TEST(IVoxSnapshot, DefaultMatchesMap)
+{
+    expect_snapshot_matches_map<faster_lio::IVoxNodeType::DEFAULT>(false, "ivox_snapshot_default");
+}
+
+TEST(IVoxSnapshot, CopyOnWriteMatchesMap)
+{
+    expect_snapshot_matches_map<faster_lio::IVoxNodeType::DEFAULT>(true, "ivox_snapshot_cow");
+}
+
+TEST(IVoxSnapshot, FlatMatchesMap)
+{
+    expect_snapshot_matches_map<faster_lio::IVoxNodeType::FLAT>(false, "ivox_snapshot_flat");
+}